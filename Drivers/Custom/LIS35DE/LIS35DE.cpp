@@ -5,12 +5,20 @@
  *      Author: Adrian
  */
 
-#include "spi.h"
+#include "spi_bus.h"
 #include "i2c.h"
-#include "gpio.h"
 #include "config.h"
+#include "FreeRTOS.h"
+#include "task.h"
 #include "LIS35DE.h"
 
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// descriptor of accelerometer on SPI bus - SPC is idle high, data is captured on rising edge
+static SpiDevice _spiDevice = {SPIx_SSB_GPIO, SPIx_SSB_PIN, SPIx_BOUDRATE, SPI_MODE_3, nullptr};
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | global functions' definitions
 +---------------------------------------------------------------------------------------------------------------------*/
@@ -51,82 +59,57 @@ static void LIS35DE_SPI_Reboot()
 	tx[0] = LIS35DE_SPI_WRITE | LIS35DE_SPI_ADDRESS_UNCHAGED | LIS35DE_CTRL_REG2;   // 33
 	tx[1] = LIS35DE_CTRL_REG2_BOOT;   // 64
 
-	// Writing 0 to CS pin - starting transmission
-	SPIx_SSB_bb = SPIx_SSB_START;
-
-	spiWrite(tx,2);
-
-	// Writing 1 to CS pin - transmission stopped
-	SPIx_SSB_bb = SPIx_SSB_END;
+	const SpiTransfer transfer = {tx, nullptr, sizeof(tx)};
+	spiBusTransaction(&_spiDevice, &transfer, 1, portMAX_DELAY);
 }
 
 static uint8_t LIS35DE_SPI_Init()
 {
 	uint8_t tx[2];
+	uint8_t rx;
 
-	spiInitialize();
+	if (spiBusInitialize() != ERROR_NONE)
+		return LIS35DE_INITIALIZE_ERROR;
 
-	spiSetBaudRate(SPIx_BOUDRATE);
-
-	gpioConfigurePin(SPIx_SSB_GPIO, SPIx_SSB_PIN, SPIx_SSB_CONFIGURATION);   // Configuring CS pin
-
-	for(int i=0;i<1000000;i++);  // waiting for SPI initialize end
-
-	SPIx_SSB_bb = SPIx_SSB_START;  // sending random byte, because first byte can't be sent properly
-	tx[0]=123;
-	spiWrite(tx,1);
-	SPIx_SSB_bb = SPIx_SSB_END;
+	spiBusDeviceInitialize(&_spiDevice);
 
 	LIS35DE_SPI_Reboot();  // Calibrating accelerometer to fabric settings
 
-	for(int i=0;i<1000000;i++);  // waiting for accelerometer reset
-
-	SPIx_SSB_bb = SPIx_SSB_START;  // Writing 0 to CS pin - starting transmission
+	vTaskDelay(LIS35DE_BOOT_TIME_ms / portTICK_RATE_MS);  // waiting for accelerometer reset
 
 	tx[0] = LIS35DE_SPI_WRITE | LIS35DE_SPI_ADDRESS_UNCHAGED | LIS35DE_CTRL_REG1;  // 32
 	tx[1] = LIS35DE_CTRL_REG1_PD | LIS35DE_CTRL_REG1_ZEN | LIS35DE_CTRL_REG1_YEN | LIS35DE_CTRL_REG1_XEN;   // 71
 
-	spiWrite(tx,1);
-	spiWrite(&tx[1],1);
-
-	SPIx_SSB_bb = SPIx_SSB_END;  // Writing 1 to CS pin - transmission stopped
+	const SpiTransfer write = {tx, nullptr, sizeof(tx)};
+	spiBusTransaction(&_spiDevice, &write, 1, portMAX_DELAY);
 
 	// Checking whether power is set
 	tx[0] = LIS35DE_SPI_READ | LIS35DE_SPI_ADDRESS_UNCHAGED | LIS35DE_CTRL_REG1;  // 160
 
-	SPIx_SSB_bb = SPIx_SSB_START;
-
-	spiWrite(tx,1);
-	spiRead(tx,1);
+	const SpiTransfer read[] = {{tx, nullptr, 1}, {nullptr, &rx, 1}};
+	if (spiBusTransaction(&_spiDevice, read, sizeof(read) / sizeof(read[0]), portMAX_DELAY) != ERROR_NONE)
+		return LIS35DE_INITIALIZE_ERROR;
 
-	SPIx_SSB_bb = SPIx_SSB_END;
-
-	if(tx[0]==tx[1]) return 0;
+	if(rx==tx[1]) return 0;
 	else return 1;
 }
 
 static void LIS35DE_SPI_Read(int8_t *x, int8_t *y, int8_t *z)
 {
-	SPIx_SSB_bb = SPIx_SSB_START;
-
-	uint8_t tx = LIS35DE_SPI_READ | LIS35DE_SPI_ADDRESS_INCREMENTED | LIS35DE_OUT_X;  // 233
-
-	spiWrite(&tx,1);
-
-	spiRead(&tx,1);  // reading x
-	*x=(int8_t)tx;
-
-	spiRead(&tx,1);
+	const uint8_t tx = LIS35DE_SPI_READ | LIS35DE_SPI_ADDRESS_INCREMENTED | LIS35DE_OUT_X;  // 233
+	uint8_t rx[5];
 
-	spiRead(&tx,1);	 // reading y
-	*y=(int8_t)tx;
+	const SpiTransfer transfers[] = {{&tx, nullptr, 1}, {nullptr, rx, sizeof(rx)}};
+	spiBusTransaction(&_spiDevice, transfers, sizeof(transfers) / sizeof(transfers[0]), portMAX_DELAY);
 
-	spiRead(&tx,1);
+	// reading x
+	*x=(int8_t)rx[0];
 
-	spiRead(&tx,1);  // reading z
-	*z=(int8_t)tx;
+	// reading y
+	*y=(int8_t)rx[2];
 
-	SPIx_SSB_bb = SPIx_SSB_END;
+	// reading z
+	*z=(int8_t)rx[4];
 }
 
 static uint8_t LIS35DE_I2C_Init()
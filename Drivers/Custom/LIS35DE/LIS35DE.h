@@ -14,6 +14,8 @@
 
 #define LIS35DE_INITIALIZE_ERROR			1
 
+#define LIS35DE_BOOT_TIME_ms				10
+
 /******************  definition for i2c communication  ***************/
 #define LIS35DE_I2C_SLAVE_ADDRESS			0b00011100
 
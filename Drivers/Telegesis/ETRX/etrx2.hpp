@@ -90,6 +90,9 @@ public:
 
 	int establishNetwork(uint8_t * const channel, uint16_t * const pid, uint64_t * const epid);
 
+	/// \brief returns currently registered event callback, nullptr if none
+	EventCallback getEventCallback() const { return eventCallback_; };
+
 	int getModuleInfo(char * const device_name, const size_t device_name_size, char * const firmware_revision,
 			const size_t firmware_revision_size, uint64_t * const eui64);
 
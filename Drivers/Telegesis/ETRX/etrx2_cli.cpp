@@ -10,15 +10,86 @@
 #include "etrx2_cli.hpp"
 
 #include "etrx2.hpp"
+#include "etrx2_event.hpp"
 #include "command.hpp"
+#include "command_arguments.hpp"
+
+#include "task.h"
 
 #include <cerrno>
 #include <cstring>
 #include <cstdlib>
+#include <cstddef>
 
 namespace
 {
 
+/*---------------------------------------------------------------------------------------------------------------------+
+| private types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// arguments of "etrx2_sregister" command
+struct Etrx2SregisterArguments
+{
+	/// S-Register
+	uint8_t sRegister;
+
+	/// data to be written, nullptr to read S-Register
+	const char *data;
+
+	/// password for write access, nullptr if not required
+	const char *password;
+};
+
+/// arguments of "transmit_broadcast" command
+struct TransmitBroadcastArguments
+{
+	/// number of hops, 0 - entire network
+	uint8_t hops;
+
+	/// data to transmit
+	const char *data;
+};
+
+/// arguments of "transmit_unicast" command
+struct TransmitUnicastArguments
+{
+	/// address of destination
+	uint64_t address;
+
+	/// data to transmit
+	const char *data;
+};
+
+/// arguments of "zb_bench" command
+struct ZbBenchArguments
+{
+	/// number of messages to send
+	uint32_t count;
+
+	/// size of single message, bytes
+	uint32_t size;
+
+	/// EUI64 of destination
+	uint64_t address;
+
+	/// messages per second, 0 - as fast as possible
+	uint32_t rate;
+
+	/// number of hops for broadcast, 0 - entire network
+	uint8_t hops;
+
+	/// true if round-trip time should be measured
+	bool roundTrip;
+};
+
+/// arguments of "zb_bench_responder" command
+struct ZbBenchResponderArguments
+{
+	/// "on" or "off", nullptr to only display status
+	const char *state;
+};
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | private functions' declarations
 +---------------------------------------------------------------------------------------------------------------------*/
@@ -27,12 +98,19 @@ int energyScanHandler_(const char **, uint32_t, FILE * const output_stream);
 int etrx2InfoHandler_(const char **, uint32_t, FILE * const output_stream);
 int etrx2SregisterHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream);
 int etrx2StatsHandler_(const char **, uint32_t, FILE * const output_stream);
+int etrx2StatsStructuredHandler_(const char **, uint32_t, void * const buffer, const size_t size);
 int networkConnectEstablishHandler_(const char **arguments_array, uint32_t, FILE *output_stream);
 int networkDisconnectHandler_(const char **, uint32_t, FILE * const output_stream);
 int networkInfoHandler_(const char **, uint32_t, FILE * const output_stream);
 int networkSearchHandler_(const char **, uint32_t, FILE * const output_stream);
 int transmitBroadcastHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream);
 int transmitUnicastHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream);
+bool zbBenchEventCallback_(std::unique_ptr<const Etrx2Event> event);
+int zbBenchHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream);
+int zbBenchInitialize_();
+int zbBenchResponderHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream);
+void zbBenchResponderTask_(void *parameters);
+bool zbBenchWaitForReply_(const uint32_t sequence_number);
 
 /*---------------------------------------------------------------------------------------------------------------------+
 | private variables
@@ -45,6 +123,7 @@ const CommandDefinition energyScanCommandDefinition_ =
 		0,						// maximum number of arguments
 		energyScanHandler_,		// handler function
 		"energy_scan: scan energy on all channels\n",	// string displayed by help function
+		nullptr,				// structured handler function
 };
 
 /// definition of "etrx2_info" command
@@ -54,8 +133,25 @@ const CommandDefinition etrx2InfoCommandDefinition_ =
 		0,						// maximum number of arguments
 		etrx2InfoHandler_,		// handler function
 		"etrx2_info: displays info about connected ETRX2 module\n",	// string displayed by help function
+		nullptr,				// structured handler function
+};
+
+/// fields of "etrx2_sregister" command's arguments
+const CommandArgumentField etrx2SregisterArgumentFields_[] =
+{
+		{"s_register", CommandArgumentType::UINT8,
+				CommandArgumentField::POSITIONAL | CommandArgumentField::REQUIRED,
+				offsetof(Etrx2SregisterArguments, sRegister)},
+		{"data", CommandArgumentType::STRING, CommandArgumentField::POSITIONAL,
+				offsetof(Etrx2SregisterArguments, data)},
+		{"password", CommandArgumentType::STRING, CommandArgumentField::POSITIONAL,
+				offsetof(Etrx2SregisterArguments, password)},
 };
 
+/// schema of "etrx2_sregister" command's arguments
+constexpr CommandArgumentsSchema<Etrx2SregisterArguments> etrx2SregisterArgumentsSchema_ =
+		commandArgumentsSchema<Etrx2SregisterArguments>(etrx2SregisterArgumentFields_);
+
 /// definition of "etrx2_sregister" command
 const CommandDefinition etrx2SregisterCommandDefinition_ =
 {
@@ -66,6 +162,7 @@ const CommandDefinition etrx2SregisterCommandDefinition_ =
 		"\ts_register - decimal, hexadecimal (\"0x\" or \"0X\" prefix) or octal (\"0\" prefix),\n"
 		"\tdata - data to be written,\n"
 		"\tpassword - password for write access, if required\n",	// string displayed by help function
+		nullptr,				// structured handler function
 };
 
 /// definition of "etrx2_stats" command
@@ -75,6 +172,7 @@ const CommandDefinition etrx2StatsCommandDefinition_ =
 		0,						// maximum number of arguments
 		etrx2StatsHandler_,		// handler function
 		"etrx2_stats: displays ETRX2 statistics\n",	// string displayed by help function
+		etrx2StatsStructuredHandler_,	// structured handler function
 };
 
 /// definition of "network_connect" command
@@ -84,6 +182,7 @@ const CommandDefinition networkConnectCommandDefinition_ =
 		0,						// maximum number of arguments
 		networkConnectEstablishHandler_,	// handler function
 		"network_connect: connect local node to any network\n",	// string displayed by help function
+		nullptr,				// structured handler function
 };
 
 /// definition of "network_disconnect" command
@@ -93,6 +192,7 @@ const CommandDefinition networkDisconnectCommandDefinition_ =
 		0,						// maximum number of arguments
 		networkDisconnectHandler_,	// handler function
 		"network_disconnect: disconnect local node from network\n",	// string displayed by help function
+		nullptr,				// structured handler function
 };
 
 /// definition of "network_establish" command
@@ -102,6 +202,7 @@ const CommandDefinition networkEstablishCommandDefinition_ =
 		0,						// maximum number of arguments
 		networkConnectEstablishHandler_,	// handler function
 		"network_establish: establish network\n",	// string displayed by help function
+		nullptr,				// structured handler function
 };
 
 /// definition of "network_info" command
@@ -111,6 +212,7 @@ const CommandDefinition networkInfoCommandDefinition_ =
 		0,						// maximum number of arguments
 		networkInfoHandler_,	// handler function
 		"network_info: displays info about current ZigBee network\n",	// string displayed by help function
+		nullptr,				// structured handler function
 };
 
 /// definition of "network_search" command
@@ -120,8 +222,22 @@ const CommandDefinition networkSearchCommandDefinition_ =
 		0,						// maximum number of arguments
 		networkSearchHandler_,	// handler function
 		"network_search: searches for active networks\n",	// string displayed by help function
+		nullptr,				// structured handler function
 };
 
+/// fields of "transmit_broadcast" command's arguments
+const CommandArgumentField transmitBroadcastArgumentFields_[] =
+{
+		{"hops", CommandArgumentType::UINT8, CommandArgumentField::POSITIONAL,
+				offsetof(TransmitBroadcastArguments, hops)},
+		{"data", CommandArgumentType::STRING, CommandArgumentField::POSITIONAL | CommandArgumentField::REQUIRED,
+				offsetof(TransmitBroadcastArguments, data)},
+};
+
+/// schema of "transmit_broadcast" command's arguments
+constexpr CommandArgumentsSchema<TransmitBroadcastArguments> transmitBroadcastArgumentsSchema_ =
+		commandArgumentsSchema<TransmitBroadcastArguments>(transmitBroadcastArgumentFields_);
+
 /// definition of "transmit_broadcast" command
 const CommandDefinition transmitBroadcastCommandDefinition_ =
 {
@@ -132,8 +248,22 @@ const CommandDefinition transmitBroadcastCommandDefinition_ =
 		"\thops - decimal, hexadecimal (\"0x\" or \"0X\" prefix) or octal (\"0\" prefix),\n"
 		"\tdefault = 0 (entire network)\n"
 		"\tdata - no whitespace allowed\n",	// string displayed by help function
+		nullptr,				// structured handler function
 };
 
+/// fields of "transmit_unicast" command's arguments
+const CommandArgumentField transmitUnicastArgumentFields_[] =
+{
+		{"address", CommandArgumentType::UINT64, CommandArgumentField::POSITIONAL | CommandArgumentField::REQUIRED,
+				offsetof(TransmitUnicastArguments, address)},
+		{"data", CommandArgumentType::STRING, CommandArgumentField::POSITIONAL | CommandArgumentField::REQUIRED,
+				offsetof(TransmitUnicastArguments, data)},
+};
+
+/// schema of "transmit_unicast" command's arguments
+constexpr CommandArgumentsSchema<TransmitUnicastArguments> transmitUnicastArgumentsSchema_ =
+		commandArgumentsSchema<TransmitUnicastArguments>(transmitUnicastArgumentFields_);
+
 /// definition of "transmit_unicast" command
 const CommandDefinition transmitUnicastCommandDefinition_ =
 {
@@ -143,6 +273,66 @@ const CommandDefinition transmitUnicastCommandDefinition_ =
 		"transmit_unicast address data: transmit unicast\n"
 		"\taddress - decimal, hexadecimal (\"0x\" or \"0X\" prefix) or octal (\"0\" prefix)\n"
 		"\tdata - no whitespace allowed\n",	// string displayed by help function
+		nullptr,				// structured handler function
+};
+
+/// index of "address" field in zbBenchArgumentFields_[]
+constexpr size_t zbBenchAddressFieldIndex_ = 2;
+
+/// fields of "zb_bench" command's arguments
+const CommandArgumentField zbBenchArgumentFields_[] =
+{
+		{"count", CommandArgumentType::UINT32, CommandArgumentField::REQUIRED, offsetof(ZbBenchArguments, count)},
+		{"size", CommandArgumentType::UINT32, CommandArgumentField::OPTIONAL, offsetof(ZbBenchArguments, size)},
+		{"address", CommandArgumentType::UINT64, CommandArgumentField::OPTIONAL,
+				offsetof(ZbBenchArguments, address)},	// zbBenchAddressFieldIndex_
+		{"rate", CommandArgumentType::UINT32, CommandArgumentField::OPTIONAL, offsetof(ZbBenchArguments, rate)},
+		{"hops", CommandArgumentType::UINT8, CommandArgumentField::OPTIONAL, offsetof(ZbBenchArguments, hops)},
+		{"rtt", CommandArgumentType::FLAG, CommandArgumentField::OPTIONAL, offsetof(ZbBenchArguments, roundTrip)},
+};
+
+/// schema of "zb_bench" command's arguments
+constexpr CommandArgumentsSchema<ZbBenchArguments> zbBenchArgumentsSchema_ =
+		commandArgumentsSchema<ZbBenchArguments>(zbBenchArgumentFields_);
+
+/// definition of "zb_bench" command
+const CommandDefinition zbBenchCommandDefinition_ =
+{
+		"zb_bench",				// command string
+		11,						// maximum number of arguments
+		zbBenchHandler_,		// handler function
+		"zb_bench --count count [--size size] [--address address] [--rate rate] [--hops hops] [--rtt]: ZigBee "
+		"throughput benchmark\n"
+		"\tcount - number of messages to send,\n"
+		"\tsize - size of single message in bytes, [13; 64], default = 16,\n"
+		"\taddress - EUI64 of destination, broadcast is sent if not given,\n"
+		"\trate - messages per second, [0; 1000] (tick rate), default = 0 (as fast as possible),\n"
+		"\thops - number of hops for broadcast, default = 0 (entire network),\n"
+		"\trtt - wait for the reply from \"zb_bench_responder\" on remote node after each message\n",
+		// string displayed by help function
+		nullptr,				// structured handler function
+};
+
+/// fields of "zb_bench_responder" command's arguments
+const CommandArgumentField zbBenchResponderArgumentFields_[] =
+{
+		{"state", CommandArgumentType::STRING, CommandArgumentField::POSITIONAL,
+				offsetof(ZbBenchResponderArguments, state)},
+};
+
+/// schema of "zb_bench_responder" command's arguments
+constexpr CommandArgumentsSchema<ZbBenchResponderArguments> zbBenchResponderArgumentsSchema_ =
+		commandArgumentsSchema<ZbBenchResponderArguments>(zbBenchResponderArgumentFields_);
+
+/// definition of "zb_bench_responder" command
+const CommandDefinition zbBenchResponderCommandDefinition_ =
+{
+		"zb_bench_responder",	// command string
+		1,						// maximum number of arguments
+		zbBenchResponderHandler_,	// handler function
+		"zb_bench_responder [on|off]: enables/disables replies to \"zb_bench --rtt\" of remote nodes, displays "
+		"responder status\n",	// string displayed by help function
+		nullptr,				// structured handler function
 };
 
 /// all commands for Etrx2 command-line interface
@@ -159,11 +349,40 @@ const CommandDefinition * const commandDefinitions_[] =
 		&networkSearchCommandDefinition_,
 		&transmitBroadcastCommandDefinition_,
 		&transmitUnicastCommandDefinition_,
+		&zbBenchCommandDefinition_,
+		&zbBenchResponderCommandDefinition_,
 };
 
 /// instance of Etrx2 object, used by commands
 Etrx2 *etrx2_;
 
+/// prefix of benchmark request, sent by "zb_bench"
+const char zbBenchRequestPrefix_[] = "zbq:";
+
+/// prefix of benchmark reply, sent by responder
+const char zbBenchReplyPrefix_[] = "zbp:";
+
+/// length of benchmark message header - prefix, 8 hexadecimal digits of sequence number and ':'
+constexpr size_t zbBenchHeaderLength_ = sizeof(zbBenchRequestPrefix_) - 1 + 8 + 1;
+
+/// event callback which was registered in Etrx2 before zbBenchEventCallback_(), all other events are passed to it
+Etrx2::EventCallback zbBenchPreviousEventCallback_;
+
+/// queue for received benchmark replies
+xQueueHandle zbBenchReplyQueue_;
+
+/// queue for received benchmark requests, handled by zbBenchResponderTask_()
+xQueueHandle zbBenchRequestQueue_;
+
+/// true if responder is enabled
+volatile bool zbBenchResponderEnabled_;
+
+/// handle of responder task
+xTaskHandle zbBenchResponderTaskHandle_;
+
+/// number of replies sent by responder
+uint32_t zbBenchResponderReplies_;
+
 }	// namespace
 
 /*---------------------------------------------------------------------------------------------------------------------+
@@ -277,17 +496,17 @@ int etrx2InfoHandler_(const char **, uint32_t, FILE * const output_stream)
 
 int etrx2SregisterHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream)
 {
-	if (arguments_count < 2)	// at least S-Register must be given
-		return -EINVAL;
+	Etrx2SregisterArguments arguments {};
+	int ret = commandArgumentsParse(etrx2SregisterArgumentsSchema_, arguments_array, arguments_count, arguments,
+			output_stream);
+	if (ret < 0)
+		return ret;
 
-	const uint8_t s_register = strtoul(arguments_array[1], nullptr, 0);
-	const bool write = arguments_count > 2;
-	const char * const write_data = write ? arguments_array[2] : nullptr;
-	const char * const password = arguments_count == 4 ? arguments_array[3] : nullptr;
+	const bool write = arguments.data != nullptr;
 	char buffer[64];	// the longest string that can be read is 60 characters
 	char * const read_data = !write ? buffer : nullptr;
 
-	int ret = etrx2_->sRegisterAccess(s_register, write_data, password, read_data, sizeof(buffer));
+	ret = etrx2_->sRegisterAccess(arguments.sRegister, arguments.data, arguments.password, read_data, sizeof(buffer));
 	if (ret != 0)
 		return ret;
 
@@ -322,6 +541,31 @@ int etrx2StatsHandler_(const char **, uint32_t, FILE * const output_stream)
 	return ret >= 0 ? 0 : -EIO;
 }
 
+/**
+ * \brief Structured handler of "etrx2_stats" command.
+ *
+ * Fills Etrx2Stats with ETRX2 statistics.
+ *
+ * \param [out] buffer is the buffer for response
+ * \param [in] size is the size of buffer, bytes
+ *
+ * \return size of response on success, negated errno code otherwise (errno not set)
+ */
+
+int etrx2StatsStructuredHandler_(const char **, uint32_t, void * const buffer, const size_t size)
+{
+	if (size < sizeof(Etrx2Stats))
+		return -ENOSPC;
+
+	uint32_t processed_commands, received_lines, dropped_lines;
+
+	etrx2_->getModuleStats(processed_commands, received_lines, dropped_lines);
+
+	const Etrx2Stats stats = {processed_commands, received_lines, dropped_lines};
+	memcpy(buffer, &stats, sizeof(stats));
+	return sizeof(stats);
+}
+
 /**
  * \brief Handler of "network_connect" and "network_establish" commands.
  *
@@ -489,24 +733,13 @@ int networkSearchHandler_(const char **, uint32_t, FILE * const output_stream)
 
 int transmitBroadcastHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream)
 {
-	if (arguments_count < 2)	// at least data must be given
-		return -EINVAL;
-
-	uint8_t hops;
-	const char *data;
-
-	if (arguments_count == 2)	// hops not given?
-	{
-		hops = 0;
-		data = arguments_array[1];
-	}
-	else	// hops given?
-	{
-		hops = strtoul(arguments_array[1], nullptr, 0);
-		data = arguments_array[2];
-	}
+	TransmitBroadcastArguments arguments {};
+	int ret = commandArgumentsParse(transmitBroadcastArgumentsSchema_, arguments_array, arguments_count, arguments,
+			output_stream);
+	if (ret < 0)
+		return ret;
 
-	int ret = etrx2_->transmitBroadcast(hops, data);
+	ret = etrx2_->transmitBroadcast(arguments.hops, arguments.data);
 
 	if (ret == 0)
 	{
@@ -532,25 +765,332 @@ int transmitBroadcastHandler_(const char **arguments_array, uint32_t arguments_c
 
 int transmitUnicastHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream)
 {
-	int ret = -EINVAL;
+	TransmitUnicastArguments arguments {};
+	int ret = commandArgumentsParse(transmitUnicastArgumentsSchema_, arguments_array, arguments_count, arguments,
+			output_stream);
+	if (ret < 0)
+		return ret;
+
+	uint8_t sequence_number;
+	bool acknowledged;
+
+	ret = etrx2_->transmitUnicast(arguments.address, arguments.data, &sequence_number, &acknowledged);
 
-	if (arguments_count == 3)	// both address and data must be given
+	if (ret == 0)
 	{
-		const uint64_t address = strtoull(arguments_array[1], nullptr, 0);
-		uint8_t sequence_number;
-		bool acknowledged;
+		ret = fiprintf(output_stream, "Sequence number = %hhu\nAcknowledge%sreceived\n",
+				sequence_number, acknowledged ? " " : " not ");
+		ret = ret >= 0 ? 0 : -EIO;
+	}
 
-		ret = etrx2_->transmitUnicast(address, arguments_array[2], &sequence_number, &acknowledged);
+	return ret;
+}
 
-		if (ret == 0)
+/**
+ * \brief Event callback used by ZigBee benchmark.
+ *
+ * Benchmark requests (only when responder is enabled) and benchmark replies are sent to their queues, all other events
+ * are passed to the event callback that was registered previously.
+ *
+ * \param [in] event is a unique_ptr to received event
+ *
+ * \return true is event was consumed, false otherwise
+ */
+
+bool zbBenchEventCallback_(std::unique_ptr<const Etrx2Event> event)
+{
+	if (event->getType() == Etrx2Event::Type::MESSAGE)
+	{
+		const char *data;
+		static_cast<const Etrx2MessageEvent &>(*event).getParameters(nullptr, nullptr, nullptr, &data);
+
+		const bool request = zbBenchResponderEnabled_ == true &&
+				strncmp(data, zbBenchRequestPrefix_, strlen(zbBenchRequestPrefix_)) == 0;
+		const bool reply = strncmp(data, zbBenchReplyPrefix_, strlen(zbBenchReplyPrefix_)) == 0;
+
+		if (request || reply)
 		{
-			ret = fiprintf(output_stream, "Sequence number = %hhu\nAcknowledge%sreceived\n",
-					sequence_number, acknowledged ? " " : " not ");
-			ret = ret >= 0 ? 0 : -EIO;
+			const Etrx2Event * const event_ptr = event.get();
+			const portBASE_TYPE ret = xQueueSend(request ? zbBenchRequestQueue_ : zbBenchReplyQueue_, &event_ptr, 0);
+			if (ret != pdTRUE)	// queue full?
+				return false;
+
+			event.release();	// unique_ptr no longer owns the memory
+			return true;
+		}
+	}
+
+	return zbBenchPreviousEventCallback_ != nullptr ? zbBenchPreviousEventCallback_(std::move(event)) : false;
+}
+
+/**
+ * \brief Handler of "zb_bench" command.
+ *
+ * Sends requested number of messages (unicast or broadcast) with given rate and displays the throughput, ACK ratio and
+ * per-message latency. In round-trip mode the latency includes waiting for the reply from remote responder.
+ *
+ * \param [in] arguments_array is the array with arguments, first elements is the command string
+ * \param [in] arguments_count is the number of arguments in arguments_array
+ * \param [out] output_stream is the stream used for output
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int zbBenchHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream)
+{
+	ZbBenchArguments arguments {};
+	arguments.size = ZB_BENCH_MESSAGE_SIZE_DEFAULT;
+	int ret = commandArgumentsParse(zbBenchArgumentsSchema_, arguments_array, arguments_count, arguments,
+			output_stream);
+	if (ret < 0)
+		return ret;
+
+	const uint32_t count = arguments.count;
+	const uint32_t size = arguments.size;
+	const uint32_t rate = arguments.rate;
+	const uint8_t hops = arguments.hops;
+	const uint64_t address = arguments.address;
+	const bool unicast = (ret & 1 << zbBenchAddressFieldIndex_) != 0;
+	const bool round_trip = arguments.roundTrip;
+
+	// period is a whole number of ticks - higher rate would give period 0, which means no pacing
+	if (count == 0 || size < zbBenchHeaderLength_ || size > ZB_BENCH_MESSAGE_SIZE_MAX || rate > configTICK_RATE_HZ)
+		return -EINVAL;
+
+	ret = zbBenchInitialize_();
+	if (ret != 0)
+		return ret;
+
+	const Etrx2Event *event_ptr;
+	while (xQueueReceive(zbBenchReplyQueue_, &event_ptr, 0) == pdTRUE)	// drop replies left by previous benchmark
+		delete event_ptr;
+
+	char buffer[ZB_BENCH_MESSAGE_SIZE_MAX + 1];
+	memset(buffer, 'x', size);	// filler after the header
+	buffer[size] = '\0';
+
+	const portTickType period = rate != 0 ? configTICK_RATE_HZ / rate : 0;
+	uint32_t sent = 0, failed = 0, acknowledged_count = 0, completed = 0;
+	portTickType latency_min = portMAX_DELAY, latency_max = 0;
+	uint64_t latency_sum = 0;
+	const portTickType start = xTaskGetTickCount();
+	portTickType last_wake_time = start;
+
+	for (uint32_t sequence_number = 0; sequence_number < count; sequence_number++)
+	{
+		siprintf(buffer, "%s%08lx", zbBenchRequestPrefix_, sequence_number);
+		buffer[zbBenchHeaderLength_ - 1] = ':';	// overwrite terminating '\0' of the header
+
+		const portTickType message_start = xTaskGetTickCount();
+		bool acknowledged = false;
+
+		ret = unicast == true ? etrx2_->transmitUnicast(address, buffer, nullptr, &acknowledged) :
+				etrx2_->transmitBroadcast(hops, buffer);
+
+		if (ret == 0)	// transmission successful?
+		{
+			sent++;
+			if (acknowledged == true)
+				acknowledged_count++;
+
+			// message is complete when it was acknowledged (unicast), sent (broadcast) or replied to (round-trip)
+			const bool complete = round_trip == true ? zbBenchWaitForReply_(sequence_number) :
+					unicast == false || acknowledged == true;
+
+			if (complete == true)
+			{
+				const portTickType latency = xTaskGetTickCount() - message_start;
+				completed++;
+				latency_sum += latency;
+				if (latency < latency_min)
+					latency_min = latency;
+				if (latency > latency_max)
+					latency_max = latency;
+			}
 		}
+		else
+			failed++;
+
+		if (period != 0 && sequence_number + 1 < count)
+			vTaskDelayUntil(&last_wake_time, period);
+	}
+
+	portTickType duration = xTaskGetTickCount() - start;
+	if (duration == 0)
+		duration = 1;
+	const uint32_t duration_ms = duration * portTICK_RATE_MS;
+
+	ret = fiprintf(output_stream, "Sent = %lu\nFailed = %lu\nCompleted = %lu (%lu%%)\n", sent, failed, completed,
+			completed * 100 / count);
+	ret = ret >= 0 ? 0 : -EIO;
+
+	if (ret == 0 && unicast == true)
+	{
+		ret = fiprintf(output_stream, "Acknowledged = %lu (%lu%%)\n", acknowledged_count,
+				sent != 0 ? acknowledged_count * 100 / sent : 0);
+		ret = ret >= 0 ? 0 : -EIO;
+	}
+
+	if (ret == 0)
+	{
+		ret = fiprintf(output_stream, "Duration = %lu ms\nThroughput = %lu msg/s, %lu B/s\n", duration_ms,
+				static_cast<uint32_t>(static_cast<uint64_t>(sent) * 1000 / duration_ms),
+				static_cast<uint32_t>(static_cast<uint64_t>(sent) * size * 1000 / duration_ms));
+		ret = ret >= 0 ? 0 : -EIO;
+	}
+
+	if (ret == 0 && completed != 0)
+	{
+		ret = fiprintf(output_stream, "Latency min/avg/max = %lu/%lu/%lu ms\n", latency_min * portTICK_RATE_MS,
+				static_cast<uint32_t>(latency_sum * portTICK_RATE_MS / completed), latency_max * portTICK_RATE_MS);
+		ret = ret >= 0 ? 0 : -EIO;
 	}
 
 	return ret;
 }
 
+/**
+ * \brief Initializes ZigBee benchmark.
+ *
+ * Creates queues and responder task and registers event callback in Etrx2. Does nothing if benchmark is already
+ * initialized.
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int zbBenchInitialize_()
+{
+	if (zbBenchResponderTaskHandle_ != nullptr)	// already initialized?
+		return 0;
+
+	if (zbBenchReplyQueue_ == nullptr)
+		zbBenchReplyQueue_ = xQueueCreate(ZB_BENCH_QUEUE_SIZE, sizeof(const Etrx2Event *));
+	if (zbBenchRequestQueue_ == nullptr)
+		zbBenchRequestQueue_ = xQueueCreate(ZB_BENCH_QUEUE_SIZE, sizeof(const Etrx2Event *));
+
+	if (zbBenchReplyQueue_ == nullptr || zbBenchRequestQueue_ == nullptr)
+		return -ENOMEM;
+
+	const portBASE_TYPE ret = xTaskCreate(zbBenchResponderTask_, reinterpret_cast<const signed char *>("zb bench"),
+			ZB_BENCH_RESPONDER_TASK_STACK_SIZE, nullptr, ZB_BENCH_RESPONDER_TASK_PRIORITY,
+			&zbBenchResponderTaskHandle_);
+	if (ret != pdPASS)
+		return -ENOMEM;
+
+	zbBenchPreviousEventCallback_ = etrx2_->getEventCallback();
+	etrx2_->registerEventCallback(zbBenchEventCallback_);
+
+	return 0;
+}
+
+/**
+ * \brief Handler of "zb_bench_responder" command.
+ *
+ * Enables or disables replies to benchmark requests and displays responder status.
+ *
+ * \param [in] arguments_array is the array with arguments, first elements is the command string
+ * \param [in] arguments_count is the number of arguments in arguments_array
+ * \param [out] output_stream is the stream used for output
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int zbBenchResponderHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream)
+{
+	ZbBenchResponderArguments arguments {};
+	const int parse_ret = commandArgumentsParse(zbBenchResponderArgumentsSchema_, arguments_array, arguments_count,
+			arguments, output_stream);
+	if (parse_ret < 0)
+		return parse_ret;
+
+	if (arguments.state != nullptr)	// "on" or "off" given?
+	{
+		const bool enable = strcmp(arguments.state, "on") == 0;
+
+		if (enable == false && strcmp(arguments.state, "off") != 0)
+			return -EINVAL;
+
+		const int ret = zbBenchInitialize_();
+		if (ret != 0)
+			return ret;
+
+		zbBenchResponderEnabled_ = enable;
+	}
+
+	const int ret = fiprintf(output_stream, "Responder %s\nReplies sent = %lu\n",
+			zbBenchResponderEnabled_ == true ? "enabled" : "disabled", zbBenchResponderReplies_);
+
+	return ret >= 0 ? 0 : -EIO;
+}
+
+/**
+ * \brief Task of ZigBee benchmark responder.
+ *
+ * Replies to each received benchmark request with unicast of the same length and sequence number sent to the
+ * originator of request. This cannot be done directly in the event callback, as it is executed by rx task of Etrx2.
+ */
+
+void zbBenchResponderTask_(void *)
+{
+	while (1)
+	{
+		const Etrx2MessageEvent *message_event_ptr;
+
+		if (xQueueReceive(zbBenchRequestQueue_, &message_event_ptr, portMAX_DELAY) != pdTRUE)
+			continue;
+
+		std::unique_ptr<const Etrx2MessageEvent> message_event(message_event_ptr);
+
+		uint64_t address;
+		const char *data;
+		message_event->getParameters(nullptr, &address, nullptr, &data);
+
+		const size_t length = strlen(data);
+		if (length > ZB_BENCH_MESSAGE_SIZE_MAX)
+			continue;
+
+		char buffer[ZB_BENCH_MESSAGE_SIZE_MAX + 1];
+		memcpy(buffer, data, length + 1);
+		memcpy(buffer, zbBenchReplyPrefix_, strlen(zbBenchReplyPrefix_));	// turn request into reply
+
+		if (etrx2_->transmitUnicast(address, buffer, nullptr, nullptr) == 0)
+			zbBenchResponderReplies_++;
+	}
+}
+
+/**
+ * \brief Waits for the reply to benchmark request with given sequence number.
+ *
+ * Replies with other sequence numbers (late replies to previous requests) are dropped.
+ *
+ * \param [in] sequence_number is the sequence number of request
+ *
+ * \return true if reply was received before ZB_BENCH_REPLY_TIMEOUT_MS, false otherwise
+ */
+
+bool zbBenchWaitForReply_(const uint32_t sequence_number)
+{
+	const portTickType timeout = ZB_BENCH_REPLY_TIMEOUT_MS / portTICK_RATE_MS;
+	const portTickType start = xTaskGetTickCount();
+	portTickType elapsed;
+
+	while ((elapsed = xTaskGetTickCount() - start) < timeout)
+	{
+		const Etrx2MessageEvent *message_event_ptr;
+
+		if (xQueueReceive(zbBenchReplyQueue_, &message_event_ptr, timeout - elapsed) != pdTRUE)
+			break;
+
+		std::unique_ptr<const Etrx2MessageEvent> message_event(message_event_ptr);
+
+		const char *data;
+		message_event->getParameters(nullptr, nullptr, nullptr, &data);
+
+		if (strtoul(data + strlen(zbBenchReplyPrefix_), nullptr, 16) == sequence_number)
+			return true;
+	}
+
+	return false;
+}
+
 }	// namespace
@@ -8,8 +8,23 @@
 #ifndef ETRX2_CLI_HPP_
 #define ETRX2_CLI_HPP_
 
+#include <cstdint>
+
 class Etrx2;
 
+/// fixed-layout response of "etrx2_stats" command returned over binary RPC
+struct Etrx2Stats
+{
+	/// number of processed commands
+	uint32_t processedCommands;
+
+	/// number of received lines
+	uint32_t receivedLines;
+
+	/// number of dropped lines
+	uint32_t droppedLines;
+} __attribute__ ((packed));
+
 int etrx2CliInitialize(Etrx2 &etrx2);
 
 #endif	// ETRX2_CLI_HPP_
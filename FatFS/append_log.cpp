@@ -0,0 +1,286 @@
+/**
+ * \file append_log.cpp
+ * \brief Append-only log files with preallocated contiguous clusters
+ *
+ * When the log is opened for the first time, contiguous cluster chain for its whole capacity is allocated with
+ * f_contiguous() and committed to the card. Appended data is then written straight to computed sectors with
+ * diskCacheWriteThrough(), bypassing the sector cache - full sectors directly from caller's buffer, partial sector
+ * (when it is completed and on checkpoint) from the buffer of FatFS file object (which is otherwise unused, as the file
+ * is never accessed with f_write()). Log data doesn't evict FAT and directory sectors from the cache and consecutive writes - even of single
+ * sectors - continue multi-block write of the card. FAT is never touched again and the directory entry is updated
+ * only by appendLogCheckpoint().
+ *
+ * Writes are batched per allocation unit (AU) of the card. The log starts at AU boundary if there's such contiguous
+ * space, no single write crosses AU boundary and when writes enter new AU, the card is told that the rest of the
+ * AU (within the log) may be pre-erased - its content is not needed - so the multi-block write which fills the AU is
+ * programmed without read-modify-write of old data inside the card.
+ *
+ * Data is written to the card before its length is stored in the directory entry, so after a crash the log contains
+ * everything up to the last checkpoint. Directory entry of the log holds the start of the whole chain, while the size
+ * is only the length of the log - chkdsk may report the unused part of the chain.
+ *
+ * prefix: appendLog
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "append_log.h"
+
+#include "disk_cache.h"
+#include "diskio.h"
+
+#include <cstring>
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local defines
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// max number of sectors in one diskCacheWriteThrough() call - count is BYTE
+#define APPEND_LOG_SECTORS_PER_WRITE_MAX_	255
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+FRESULT writeSectors_(AppendLog *log, const BYTE *buffer, DWORD sector, DWORD count);
+
+}	// namespace
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Makes the log durable up to its current length.
+ *
+ * Partial last sector is written past the sector cache, card is synchronized and then the length is stored in the
+ * directory entry.
+ *
+ * \param [in,out] log is a pointer to opened log
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT appendLogCheckpoint(AppendLog * const log)
+{
+	FATFS * const fs = log->file.fs;
+	FRESULT result = FR_OK;
+
+	if (ff_req_grant(fs->sobj) == 0)
+		return FR_TIMEOUT;
+
+	if (log->length % _MAX_SS != 0 &&		// partial sector also bypasses the cache, like writeSectors_()
+			diskCacheWriteThrough(fs->drv, log->file.buf, log->firstSector + log->length / _MAX_SS, 1) != RES_OK)
+		result = FR_DISK_ERR;
+
+	if (result == FR_OK && disk_ioctl(fs->drv, CTRL_SYNC, nullptr) != RES_OK)	// data before directory entry
+		result = FR_DISK_ERR;
+
+	ff_rel_grant(fs->sobj);
+
+	if (result != FR_OK)
+		return result;
+
+	if (log->file.fsize != log->length)
+	{
+		log->file.fsize = log->length;
+		log->file.flag |= FA__WRITTEN;
+	}
+
+	return f_sync(&log->file);
+}
+
+/**
+ * \brief Makes a checkpoint and closes the log.
+ *
+ * \param [in,out] log is a pointer to opened log
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT appendLogClose(AppendLog * const log)
+{
+	const FRESULT result = appendLogCheckpoint(log);
+	const FRESULT close_result = f_close(&log->file);
+	return result != FR_OK ? result : close_result;
+}
+
+/**
+ * \brief Opens the log, creating it if it doesn't exist.
+ *
+ * Contiguous cluster chain for the whole capacity is allocated for new (or empty) file - aligned to allocation unit of
+ * the card if possible, existing chain must be contiguous and long enough. Writes continue after the last checkpoint.
+ *
+ * \param [out] log is a pointer to log object
+ * \param [in] path is the path of log file
+ * \param [in] capacity is the max length of the log, bytes
+ *
+ * \return FR_OK on success, FR_DENIED if there's no contiguous space for the log or existing file is fragmented or too
+ * short, other error code otherwise
+ */
+
+FRESULT appendLogOpen(AppendLog * const log, const TCHAR * const path, const DWORD capacity)
+{
+	FRESULT result = f_open(&log->file, path, FA_READ | FA_WRITE | FA_OPEN_ALWAYS);
+	if (result != FR_OK)
+		return result;
+
+	FATFS * const fs = log->file.fs;
+
+	log->allocationUnit = 0;
+	if (ff_req_grant(fs->sobj) != 0)
+	{
+		if (disk_ioctl(fs->drv, GET_BLOCK_SIZE, &log->allocationUnit) != RES_OK)
+			log->allocationUnit = 0;		// unknown, writes are not batched
+		ff_rel_grant(fs->sobj);
+	}
+
+	result = f_contiguous(&log->file, capacity, log->allocationUnit);
+	if (result == FR_DENIED && log->allocationUnit > 1)	// no aligned space, try anywhere
+		result = f_contiguous(&log->file, capacity, 1);
+	if (result == FR_OK)
+		result = f_sync(&log->file);		// commit newly allocated chain
+	if (result != FR_OK || log->file.fsize > capacity)
+	{
+		f_close(&log->file);
+		return result != FR_OK ? result : FR_DENIED;
+	}
+
+	log->firstSector = fs->database + (log->file.sclust - 2) * fs->csize;
+	log->capacity = capacity;
+	log->length = log->file.fsize;
+	log->preEraseEnd = 0;
+
+	if (log->length % _MAX_SS != 0)			// load partial last sector
+	{
+		if (ff_req_grant(fs->sobj) == 0)
+			result = FR_TIMEOUT;
+		else
+		{
+			if (disk_read(fs->drv, log->file.buf, log->firstSector + log->length / _MAX_SS, 1) != RES_OK)
+				result = FR_DISK_ERR;
+			ff_rel_grant(fs->sobj);
+		}
+
+		if (result != FR_OK)
+			f_close(&log->file);
+	}
+
+	return result;
+}
+
+/**
+ * \brief Appends data to the log.
+ *
+ * Data is not durable until the next checkpoint.
+ *
+ * \param [in,out] log is a pointer to opened log
+ * \param [in] buffer is the data to append
+ * \param [in] size is the size of data, bytes
+ *
+ * \return FR_OK on success, FR_DENIED if data doesn't fit in the log (nothing is written then), other error code
+ * otherwise
+ */
+
+FRESULT appendLogWrite(AppendLog * const log, const void * const buffer, const UINT size)
+{
+	if (size > log->capacity - log->length)
+		return FR_DENIED;
+
+	FATFS * const fs = log->file.fs;
+
+	if (ff_req_grant(fs->sobj) == 0)
+		return FR_TIMEOUT;
+
+	const BYTE *data = static_cast<const BYTE *>(buffer);
+	UINT remaining = size;
+	FRESULT result = FR_OK;
+
+	const UINT offset = log->length % _MAX_SS;
+	if (offset != 0 || remaining < _MAX_SS)	// fill partial sector first
+	{
+		const UINT chunk = remaining < _MAX_SS - offset ? remaining : _MAX_SS - offset;
+		memcpy(&log->file.buf[offset], data, chunk);
+		data += chunk;
+		remaining -= chunk;
+
+		if (offset + chunk == _MAX_SS)		// sector complete?
+			result = writeSectors_(log, log->file.buf, log->firstSector + log->length / _MAX_SS, 1);
+	}
+
+	const DWORD sector = log->firstSector + (log->length + (size - remaining)) / _MAX_SS;
+	const DWORD sectors = remaining / _MAX_SS;
+	if (result == FR_OK && sectors != 0)	// full sectors directly from caller's buffer, uncached
+		result = writeSectors_(log, data, sector, sectors);
+
+	if (result == FR_OK)
+	{
+		memcpy(log->file.buf, data + sectors * _MAX_SS, remaining % _MAX_SS);	// start of next partial sector
+		log->length += size;
+	}
+
+	ff_rel_grant(fs->sobj);
+
+	return result;
+}
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Writes consecutive sectors of the log.
+ *
+ * Write is split at boundaries of allocation units. Before the first write to each allocation unit, the card is told
+ * that the rest of the unit within the log may be pre-erased.
+ *
+ * \param [in,out] log is a pointer to opened log
+ * \param [in] buffer is the data to write
+ * \param [in] sector is the first sector to write
+ * \param [in] count is the number of sectors to write
+ *
+ * \return FR_OK on success, FR_DISK_ERR otherwise
+ */
+
+FRESULT writeSectors_(AppendLog * const log, const BYTE *buffer, DWORD sector, DWORD count)
+{
+	const BYTE drive = log->file.fs->drv;
+	const DWORD au = log->allocationUnit;
+	const DWORD log_end = log->firstSector + (log->capacity + _MAX_SS - 1) / _MAX_SS;
+
+	while (count != 0)
+	{
+		DWORD chunk = count < APPEND_LOG_SECTORS_PER_WRITE_MAX_ ? count : APPEND_LOG_SECTORS_PER_WRITE_MAX_;
+
+		if (au > 1)
+		{
+			const DWORD au_end = (sector / au + 1) * au;
+			if (chunk > au_end - sector)
+				chunk = au_end - sector;
+
+			if (sector >= log->preEraseEnd)	// first write to this allocation unit?
+			{
+				log->preEraseEnd = au_end < log_end ? au_end : log_end;
+				DWORD pre_erase[2] {sector, log->preEraseEnd - sector};
+				disk_ioctl(drive, MMC_SET_PRE_ERASE, pre_erase);	// only a hint, failure doesn't matter
+			}
+		}
+
+		if (diskCacheWriteThrough(drive, buffer, sector, chunk) != RES_OK)
+			return FR_DISK_ERR;
+
+		buffer += chunk * _MAX_SS;
+		sector += chunk;
+		count -= chunk;
+	}
+
+	return FR_OK;
+}
+
+}	// namespace
@@ -0,0 +1,36 @@
+/**
+ * \file append_log.h
+ * \brief Header for append_log.cpp
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef APPEND_LOG_H_
+#define APPEND_LOG_H_
+
+#include "ff.h"
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// append-only log file with preallocated contiguous clusters
+struct AppendLog
+{
+	FIL file;								///< FatFS file object, its buffer holds the last partial sector of the log
+	DWORD firstSector;						///< first sector of the log
+	DWORD capacity;							///< max length of the log, bytes
+	DWORD length;							///< current length of the log, bytes
+	DWORD allocationUnit;					///< allocation unit of the card, sectors, 0 if unknown
+	DWORD preEraseEnd;						///< end of sectors already announced to the card for pre-erase
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+FRESULT appendLogCheckpoint(AppendLog *log);
+FRESULT appendLogClose(AppendLog *log);
+FRESULT appendLogOpen(AppendLog *log, const TCHAR *path, DWORD capacity);
+FRESULT appendLogWrite(AppendLog *log, const void *buffer, UINT size);
+
+#endif /* APPEND_LOG_H_ */
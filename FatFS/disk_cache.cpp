@@ -0,0 +1,404 @@
+/**
+ * \file disk_cache.cpp
+ * \brief Write-back sector cache between FatFS and SD card driver
+ *
+ * Implements disk_read(), disk_write() and disk_ioctl() of FatFS on top of mmcDiskRead(), mmcDiskWrite() and
+ * mmcDiskIoctl(). Single-sector accesses - FAT, directories and partial file sectors - go through fully associative
+ * cache of SD_CACHE_SECTORS entries. Writes only mark the entry dirty, dirty entries are written to the card when they
+ * are evicted and on CTRL_SYNC. Replacement is LRU, but entries holding FAT sectors are evicted only if there are no
+ * other entries, as FAT is accessed on every cluster boundary of appended files.
+ *
+ * Multi-sector accesses - whole sectors of file data - and writes with diskCacheWriteThrough() bypass the cache, so
+ * that they don't evict hot sectors and don't break multi-block transfers of the card. Cached copies of these sectors
+ * are kept coherent.
+ *
+ * All calls come from FatFS, which serializes them with volume mutex.
+ *
+ * prefix: diskCache
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "disk_cache.h"
+
+#include "mmc.h"
+
+#include "diskio.h"
+#include "ff.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <cstring>
+
+static_assert(SD_CACHE_SECTORS > 0, "SD_CACHE_SECTORS must be greater than 0!");
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// entry of the cache
+struct Entry_
+{
+	DWORD sector;							///< cached sector
+	uint32_t lastUse;						///< value of useCounter_ at last access of entry
+	bool valid;								///< true if entry holds the sector
+	bool dirty;								///< true if entry was modified and not yet written to the card
+	bool fat;								///< true if entry holds FAT sector
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+int allocate_(BYTE drive, DWORD sector);
+int find_(DWORD sector);
+DRESULT flush_(BYTE drive);
+void touch_(int index);
+DRESULT writeBack_(BYTE drive, int index);
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// entries of the cache
+Entry_ entries_[SD_CACHE_SECTORS];
+
+/// data of entries of the cache
+BYTE buffers_[SD_CACHE_SECTORS][_MAX_SS];
+
+/// incremented on each access of the cache, used for LRU replacement
+uint32_t useCounter_;
+
+/// first FAT sector
+DWORD fatFirst_;
+
+/// number of FAT sectors (all copies), 0 if unknown
+DWORD fatCount_;
+
+/// statistics of the cache
+DiskCacheStatistics statistics_;
+
+}	// namespace
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Reads sectors.
+ *
+ * \param [in] drive is the physical drive number
+ * \param [out] buffer is the buffer for read data
+ * \param [in] sector is the first sector to read
+ * \param [in] count is the number of sectors to read
+ *
+ * \return RES_OK on success, error code otherwise
+ */
+
+DRESULT disk_read(BYTE drive, BYTE *buffer, DWORD sector, BYTE count)
+{
+	if (drive != 0 || count != 1)
+	{
+		const DRESULT result = mmcDiskRead(drive, buffer, sector, count);
+
+		if (result == RES_OK)
+			for (Entry_ &entry : entries_)	// cached dirty sectors are newer than the ones on the card
+				if (entry.valid == true && entry.dirty == true && entry.sector - sector < count)
+					memcpy(buffer + (entry.sector - sector) * _MAX_SS, buffers_[&entry - entries_], _MAX_SS);
+
+		return result;
+	}
+
+	int index = find_(sector);
+
+	if (index < 0)
+	{
+		index = allocate_(drive, sector);
+		if (index < 0)
+			return RES_ERROR;
+
+		const DRESULT result = mmcDiskRead(drive, buffers_[index], sector, 1);
+		if (result != RES_OK)
+			return result;
+
+		entries_[index].valid = true;
+	}
+
+	touch_(index);
+	memcpy(buffer, buffers_[index], _MAX_SS);
+	return RES_OK;
+}
+
+#if _READONLY == 0
+
+/**
+ * \brief Writes sectors.
+ *
+ * Single sector is only stored in the cache, it is written to the card when it is evicted or on CTRL_SYNC.
+ *
+ * \param [in] drive is the physical drive number
+ * \param [in] buffer is the buffer with data to write
+ * \param [in] sector is the first sector to write
+ * \param [in] count is the number of sectors to write
+ *
+ * \return RES_OK on success, error code otherwise
+ */
+
+DRESULT disk_write(BYTE drive, const BYTE *buffer, DWORD sector, BYTE count)
+{
+	if (drive != 0 || count != 1)
+		return diskCacheWriteThrough(drive, buffer, sector, count);
+
+	int index = find_(sector);
+
+	if (index < 0)
+	{
+		index = allocate_(drive, sector);
+		if (index < 0)
+			return RES_ERROR;
+
+		entries_[index].valid = true;
+	}
+
+	memcpy(buffers_[index], buffer, _MAX_SS);
+	entries_[index].dirty = true;
+	touch_(index);
+	return RES_OK;
+}
+
+/**
+ * \brief Writes sectors directly to the card, bypassing the cache.
+ *
+ * Used for sectors which won't be accessed again soon - e.g. data of append-log - so that they don't evict hot sectors
+ * and consecutive single-sector writes continue multi-block write of the card. Cached copies of written sectors are
+ * updated.
+ *
+ * \param [in] drive is the physical drive number
+ * \param [in] buffer is the buffer with data to write
+ * \param [in] sector is the first sector to write
+ * \param [in] count is the number of sectors to write
+ *
+ * \return RES_OK on success, error code otherwise
+ */
+
+DRESULT diskCacheWriteThrough(const BYTE drive, const BYTE * const buffer, const DWORD sector, const BYTE count)
+{
+	const DRESULT result = mmcDiskWrite(drive, buffer, sector, count);
+
+	if (result == RES_OK && drive == 0)
+		for (Entry_ &entry : entries_)		// cached copies are now the same as sectors on the card
+			if (entry.valid == true && entry.sector - sector < count)
+			{
+				memcpy(buffers_[&entry - entries_], buffer + (entry.sector - sector) * _MAX_SS, _MAX_SS);
+				entry.dirty = false;
+			}
+
+	return result;
+}
+
+#endif	// _READONLY == 0
+
+/**
+ * \brief Miscellaneous functions of disk.
+ *
+ * CTRL_SYNC writes all dirty sectors to the card before it is passed to the card.
+ *
+ * \param [in] drive is the physical drive number
+ * \param [in] control_code is the control code
+ * \param [in,out] buffer is the buffer for data of control code
+ *
+ * \return RES_OK on success, error code otherwise
+ */
+
+DRESULT disk_ioctl(BYTE drive, BYTE control_code, void *buffer)
+{
+	if (drive == 0 && control_code == CTRL_SYNC)
+	{
+		const DRESULT result = flush_(drive);
+		if (result != RES_OK)
+			return result;
+	}
+
+	return mmcDiskIoctl(drive, control_code, buffer);
+}
+
+/**
+ * \brief Gets statistics of the cache.
+ *
+ * \param [out] statistics is a pointer to struct which will be filled with statistics
+ */
+
+void diskCacheGetStatistics(DiskCacheStatistics * const statistics)
+{
+	taskENTER_CRITICAL();
+	*statistics = statistics_;
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * \brief Sets range of FAT sectors, which are kept in the cache in preference to other sectors.
+ *
+ * \param [in] first is the first FAT sector
+ * \param [in] count is the number of FAT sectors (all copies of FAT)
+ */
+
+void diskCacheSetFatSectors(const DWORD first, const DWORD count)
+{
+	fatFirst_ = first;
+	fatCount_ = count;
+
+	for (Entry_ &entry : entries_)
+		entry.fat = entry.sector - fatFirst_ < fatCount_;
+}
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Allocates entry for the sector.
+ *
+ * Free entry is used if there is one, otherwise LRU entry which doesn't hold FAT sector, otherwise LRU entry. Dirty
+ * entry is written to the card before it is evicted. Allocated entry is not valid.
+ *
+ * \param [in] drive is the physical drive number
+ * \param [in] sector is the sector which will be stored in the entry
+ *
+ * \return index of entry on success, -1 if evicted entry could not be written to the card
+ */
+
+int allocate_(const BYTE drive, const DWORD sector)
+{
+	int index = -1;
+
+	for (size_t i = 0; i < SD_CACHE_SECTORS; i++)
+	{
+		const Entry_ &entry = entries_[i];
+
+		if (entry.valid == false)
+		{
+			index = i;
+			break;
+		}
+
+		if (index < 0 || (entry.fat == false && entries_[index].fat == true) ||
+				(entry.fat == entries_[index].fat && useCounter_ - entry.lastUse > useCounter_ - entries_[index].lastUse))
+			index = i;
+	}
+
+	statistics_.misses++;
+
+	if (entries_[index].valid == true)
+	{
+		if (writeBack_(drive, index) != RES_OK)
+			return -1;
+
+		statistics_.evictions++;
+	}
+
+	Entry_ &entry = entries_[index];
+	entry.sector = sector;
+	entry.valid = false;
+	entry.dirty = false;
+	entry.fat = sector - fatFirst_ < fatCount_;
+	return index;
+}
+
+/**
+ * \brief Finds entry holding the sector.
+ *
+ * \param [in] sector is the sector to find
+ *
+ * \return index of entry, -1 if sector is not cached
+ */
+
+int find_(const DWORD sector)
+{
+	for (size_t i = 0; i < SD_CACHE_SECTORS; i++)
+		if (entries_[i].valid == true && entries_[i].sector == sector)
+		{
+			statistics_.hits++;
+			return i;
+		}
+
+	return -1;
+}
+
+/**
+ * \brief Writes all dirty entries to the card.
+ *
+ * Entries are written in order of ascending sector numbers, so that consecutive sectors make a multi-block write.
+ *
+ * \param [in] drive is the physical drive number
+ *
+ * \return RES_OK on success, error code otherwise
+ */
+
+DRESULT flush_(const BYTE drive)
+{
+	while (1)
+	{
+		int index = -1;
+
+		for (size_t i = 0; i < SD_CACHE_SECTORS; i++)
+			if (entries_[i].valid == true && entries_[i].dirty == true &&
+					(index < 0 || entries_[i].sector < entries_[index].sector))
+				index = i;
+
+		if (index < 0)						// no more dirty entries?
+			return RES_OK;
+
+		const DRESULT result = writeBack_(drive, index);
+		if (result != RES_OK)
+			return result;
+	}
+}
+
+/**
+ * \brief Marks entry as most recently used.
+ *
+ * \param [in] index is the index of entry
+ */
+
+void touch_(const int index)
+{
+	entries_[index].lastUse = ++useCounter_;
+}
+
+/**
+ * \brief Writes entry to the card if it is dirty.
+ *
+ * \param [in] drive is the physical drive number
+ * \param [in] index is the index of entry
+ *
+ * \return RES_OK on success, error code otherwise
+ */
+
+DRESULT writeBack_(const BYTE drive, const int index)
+{
+	Entry_ &entry = entries_[index];
+
+	if (entry.dirty == false)
+		return RES_OK;
+
+#if _READONLY == 0
+	const DRESULT result = mmcDiskWrite(drive, buffers_[index], entry.sector, 1);
+	if (result != RES_OK)
+		return result;
+#else
+	(void)drive;
+#endif	// _READONLY == 0
+
+	entry.dirty = false;
+	statistics_.writeBacks++;
+	return RES_OK;
+}
+
+}	// namespace
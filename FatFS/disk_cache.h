@@ -0,0 +1,45 @@
+/**
+ * \file disk_cache.h
+ * \brief Header for disk_cache.cpp
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef DISK_CACHE_H_
+#define DISK_CACHE_H_
+
+#include <stdint.h>
+
+#include "diskio.h"
+#include "integer.h"
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// statistics of sector cache
+struct DiskCacheStatistics
+{
+	uint32_t hits;							///< number of single-sector accesses served by the cache
+	uint32_t misses;						///< number of single-sector accesses which needed a free entry
+	uint32_t evictions;						///< number of valid entries replaced by other sectors
+	uint32_t writeBacks;					///< number of dirty sectors written to the card
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif	// __cplusplus
+
+void diskCacheGetStatistics(struct DiskCacheStatistics *statistics);
+void diskCacheSetFatSectors(DWORD first, DWORD count);
+DRESULT diskCacheWriteThrough(BYTE drive, const BYTE *buffer, DWORD sector, BYTE count);
+
+#ifdef __cplusplus
+}	// extern "C"
+#endif	// __cplusplus
+
+#endif	// DISK_CACHE_H_
@@ -68,6 +68,7 @@ DRESULT disk_ioctl (BYTE, BYTE, void*);
 #define MMC_GET_CID			12	/* Get CID */
 #define MMC_GET_OCR			13	/* Get OCR */
 #define MMC_GET_SDSTAT		14	/* Get SD status */
+#define MMC_SET_PRE_ERASE	15	/* Set sectors which may be pre-erased by write starting among them (DWORD[2]: first sector, count) */
 
 /* ATA/CF specific ioctl command */
 #define ATA_GET_REV			20	/* Get F/W revision */
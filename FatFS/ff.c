@@ -136,6 +136,16 @@
 #define	ABORT(fs, res)		{ fp->flag |= FA__ERROR; LEAVE_FF(fs, res); }
 
 
+/* Free cluster map */
+#if !_FS_READONLY && _FS_FREEMAP
+#define	FM_GROUP(fs, cl)	((cl) >> (fs)->fm_shift)
+#define	FM_LAST(fs, cl)		((cl) | (((DWORD)1 << (fs)->fm_shift) - 1))	/* Last cluster of the group */
+#define	FM_TEST(fs, cl)		((fs)->freemap[FM_GROUP(fs, cl) / 8] & (1 << FM_GROUP(fs, cl) % 8))
+#define	FM_SET(fs, cl)		((fs)->freemap[FM_GROUP(fs, cl) / 8] |= 1 << FM_GROUP(fs, cl) % 8)
+#define	FM_CLEAR(fs, cl)	((fs)->freemap[FM_GROUP(fs, cl) / 8] &= ~(1 << FM_GROUP(fs, cl) % 8))
+#endif
+
+
 /* File access control feature */
 #if _FS_LOCK
 #if _FS_READONLY
@@ -910,6 +920,9 @@ FRESULT put_fat (
 			res = FR_INT_ERR;
 		}
 		fs->wflag = 1;
+#if _FS_FREEMAP
+		if (val == 0) FM_SET(fs, clst);	/* Group of freed cluster is not full */
+#endif
 	}
 
 	return res;
@@ -984,6 +997,9 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 {
 	DWORD cs, ncl, scl;
 	FRESULT res;
+#if _FS_FREEMAP
+	BYTE gfull = 0;			/* Current group is scanned from its top and has no free cluster so far */
+#endif
 
 
 	if (clst == 0) {		/* Create a new chain */
@@ -1004,10 +1020,22 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 			ncl = 2;
 			if (ncl > scl) return 0;	/* No free cluster */
 		}
+#if _FS_FREEMAP
+		if (!FM_TEST(fs, ncl)) {		/* The group is full? */
+			if (ncl <= scl && scl <= FM_LAST(fs, ncl)) return 0;	/* Wrapped around to the start - no free cluster */
+			ncl = FM_LAST(fs, ncl);		/* Skip the group without reading the FAT */
+			continue;
+		}
+		if (ncl == 2 || ncl == FM_GROUP(fs, ncl) << fs->fm_shift) gfull = 1;	/* Top of the group */
+#endif
 		cs = get_fat(fs, ncl);			/* Get the cluster status */
 		if (cs == 0) break;				/* Found a free cluster */
 		if (cs == 0xFFFFFFFF || cs == 1)/* An error occurred */
 			return cs;
+#if _FS_FREEMAP
+		if (gfull && (ncl == FM_LAST(fs, ncl) || ncl == fs->n_fatent - 1))
+			FM_CLEAR(fs, ncl);			/* The whole group is in use */
+#endif
 		if (ncl == scl) return 0;		/* No free cluster */
 	}
 
@@ -2171,6 +2199,11 @@ FRESULT chk_mounted (	/* FR_OK(0): successful, !=0: any error occurred */
 	/* Initialize cluster allocation information */
 	fs->free_clust = 0xFFFFFFFF;
 	fs->last_clust = 0;
+#if _FS_FREEMAP
+	fs->fm_shift = 0;		/* Smallest groups for which the map covers the volume */
+	while ((fs->n_fatent - 1) >> fs->fm_shift >= _FS_FREEMAP * 8) fs->fm_shift++;
+	mem_set(fs->freemap, 0xFF, _FS_FREEMAP);	/* Any group may contain free clusters until it is scanned */
+#endif
 
 	/* Get fsinfo if available */
 	if (fmt == FS_FAT32) {
@@ -3154,13 +3187,21 @@ FRESULT f_getfree (
 			/* Get number of free clusters */
 			fat = fs->fs_type;
 			n = 0;
+#if _FS_FREEMAP
+			mem_set(fs->freemap, 0, _FS_FREEMAP);	/* Rebuild the free cluster map with the scan */
+#endif
 			if (fat == FS_FAT12) {
 				clst = 2;
 				do {
 					stat = get_fat(fs, clst);
 					if (stat == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
 					if (stat == 1) { res = FR_INT_ERR; break; }
-					if (stat == 0) n++;
+					if (stat == 0) {
+						n++;
+#if _FS_FREEMAP
+						FM_SET(fs, clst);
+#endif
+					}
 				} while (++clst < fs->n_fatent);
 			} else {
 				clst = fs->n_fatent;
@@ -3174,14 +3215,23 @@ FRESULT f_getfree (
 						i = SS(fs);
 					}
 					if (fat == FS_FAT16) {
-						if (LD_WORD(p) == 0) n++;
+						stat = LD_WORD(p);
 						p += 2; i -= 2;
 					} else {
-						if ((LD_DWORD(p) & 0x0FFFFFFF) == 0) n++;
+						stat = LD_DWORD(p) & 0x0FFFFFFF;
 						p += 4; i -= 4;
 					}
+					if (stat == 0) {
+						n++;
+#if _FS_FREEMAP
+						FM_SET(fs, fs->n_fatent - clst);
+#endif
+					}
 				} while (--clst);
 			}
+#if _FS_FREEMAP
+			if (res != FR_OK) mem_set(fs->freemap, 0xFF, _FS_FREEMAP);	/* Incomplete scan */
+#endif
 			fs->free_clust = n;
 			if (fat == FS_FAT32) fs->fsi_flag = 1;
 			*nclst = n;
@@ -3243,6 +3293,94 @@ FRESULT f_truncate (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Allocate Contiguous Cluster Chain to the File                         */
+/*-----------------------------------------------------------------------*/
+#if _USE_CONTIGUOUS
+
+FRESULT f_contiguous (
+	FIL *fp,		/* Pointer to the file object */
+	DWORD fsz,		/* Number of bytes the chain must hold */
+	DWORD align		/* Alignment of the first sector of new chain in unit of sector (0 or 1:No alignment) */
+)
+{
+	FRESULT res;
+	FATFS *fs;
+	DWORD csz, tcl, ncl, scl, stcl, clst, val;
+	BYTE wrap;
+
+
+	res = validate(fp);						/* Check validity of the object */
+	if (res != FR_OK) LEAVE_FF(fp->fs, res);
+	if (fp->flag & FA__ERROR)				/* Check abort flag */
+		LEAVE_FF(fp->fs, FR_INT_ERR);
+	if (!(fp->flag & FA_WRITE))				/* Check access mode */
+		LEAVE_FF(fp->fs, FR_DENIED);
+
+	fs = fp->fs;
+	csz = (DWORD)fs->csize * SS(fs);		/* Cluster size in bytes */
+	tcl = fsz / csz + ((fsz % csz) ? 1 : 0);	/* Number of clusters required */
+	if (!tcl) tcl = 1;
+
+	if (fp->sclust) {						/* The file has a chain - check that it is contiguous and long enough */
+		clst = fp->sclust; ncl = 1;
+		for (;;) {
+			val = get_fat(fs, clst);
+			if (val == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
+			if (val < 2) { res = FR_INT_ERR; break; }
+			if (val >= fs->n_fatent) break;	/* End of the chain */
+			if (val != clst + 1) { res = FR_DENIED; break; }	/* Fragmented chain */
+			clst = val; ncl++;
+		}
+		if (res == FR_OK && ncl < tcl) res = FR_DENIED;
+		LEAVE_FF(fs, res);
+	}
+
+	stcl = fs->last_clust;					/* Search for a run of free clusters from the last allocated one */
+	if (stcl < 2 || stcl >= fs->n_fatent) stcl = 2;
+	scl = clst = stcl; ncl = 0; wrap = 0;
+	for (;;) {
+		val = get_fat(fs, clst);
+		if (val == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
+		if (val == 1) { res = FR_INT_ERR; break; }
+		if (val == 0 && (ncl || align < 2 || clust2sect(fs, clst) % align == 0)) {	/* Free cluster extends the run or starts aligned one */
+			if (++ncl == tcl) break;
+		} else {
+			ncl = 0;
+		}
+		if (++clst >= fs->n_fatent) {		/* Wrap around, the run cannot continue over the end */
+			clst = 2; ncl = 0;
+		}
+		if (!ncl) scl = clst;				/* Next run starts here */
+		if (clst == stcl) wrap = 1;			/* Whole FAT is scanned, only the run in progress may continue */
+		if (wrap && !ncl) { res = FR_DENIED; break; }	/* No run is long enough */
+	}
+
+	if (res == FR_OK) {
+		for (clst = scl; clst < scl + tcl; clst++) {	/* Link the run into a chain */
+			res = put_fat(fs, clst, (clst == scl + tcl - 1) ? 0x0FFFFFFF : clst + 1);
+			if (res != FR_OK) break;
+		}
+		if (res == FR_OK) {
+			fs->last_clust = scl + tcl - 1;
+			if (fs->free_clust != 0xFFFFFFFF) {
+				fs->free_clust -= tcl;
+				fs->fsi_flag = 1;
+			}
+			fp->sclust = scl;				/* Attach the chain, the directory entry is updated by f_sync() */
+			fp->flag |= FA__WRITTEN;
+		} else {
+			fp->flag |= FA__ERROR;
+		}
+	}
+
+	LEAVE_FF(fs, res);
+}
+#endif /* _USE_CONTIGUOUS */
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Delete a File or Directory                                            */
 /*-----------------------------------------------------------------------*/
@@ -93,6 +93,10 @@ typedef struct {
 	DWORD	last_clust;		/* Last allocated cluster */
 	DWORD	free_clust;		/* Number of free clusters */
 	DWORD	fsi_sector;		/* fsinfo sector (FAT32) */
+#if _FS_FREEMAP
+	BYTE	fm_shift;		/* Size of cluster group of free cluster map (1 << fm_shift clusters) */
+	BYTE	freemap[_FS_FREEMAP];	/* Free cluster map (bit 1:Group may contain free cluster, 0:Group is full) */
+#endif
 #endif
 #if _FS_RPATH
 	DWORD	cdir;			/* Current directory start cluster (0:root) */
@@ -213,6 +217,7 @@ FRESULT f_stat (const TCHAR*, FILINFO*);			/* Get file status */
 FRESULT f_write (FIL*, const void*, UINT, UINT*);	/* Write data to a file */
 FRESULT f_getfree (const TCHAR*, DWORD*, FATFS**);	/* Get number of free clusters on the drive */
 FRESULT f_truncate (FIL*);							/* Truncate file */
+FRESULT f_contiguous (FIL*, DWORD, DWORD);					/* Allocate contiguous cluster chain to the file */
 FRESULT f_sync (FIL*);								/* Flush cached data of a writing file */
 FRESULT f_unlink (const TCHAR*);					/* Delete an existing file or directory */
 FRESULT	f_mkdir (const TCHAR*);						/* Create a new directory */
@@ -40,7 +40,9 @@
 /* To enable string functions, set _USE_STRFUNC to 1 or 2. */
 
 
+#ifndef _USE_MKFS					/* host build (host/Makefile) enables it to format disk images */
 #define	_USE_MKFS		0	/* 0:Disable or 1:Enable */
+#endif
 /* To enable f_mkfs function, set _USE_MKFS to 1 and set _FS_READONLY to 0 */
 
 
@@ -52,6 +54,21 @@
 /* To enable fast seek feature, set _USE_FASTSEEK to 1. */
 
 
+#define	_USE_CONTIGUOUS	1	/* 0:Disable or 1:Enable */
+/* To enable f_contiguous function, set _USE_CONTIGUOUS to 1 and set _FS_READONLY to 0 */
+
+
+#ifndef _FS_FREEMAP					/* host build (host/Makefile) can override it for comparison */
+#define	_FS_FREEMAP		128	/* 0:Disable or size of free cluster map in bytes */
+#endif
+/* When _FS_FREEMAP is not 0, the file system object holds a map of cluster groups
+/  which may contain free clusters and cluster allocation skips FAT sectors of
+/  full groups. Size of a group is the smallest power of 2 for which the map of
+/  the whole volume fits in _FS_FREEMAP bytes. The map starts with all groups
+/  marked and is refined by allocation scans and exactly rebuilt by the full
+/  scan of f_getfree. _FS_READONLY must be 0. */
+
+
 
 /*---------------------------------------------------------------------------/
 / Locale and Namespace Configurations
@@ -19,8 +19,8 @@
 #include "config.h"
 #include "bsp.h"
 
-#include "gpio.h"
-#include "spi.h"
+#include "spi_bus.h"
+#include "mmc.h"
 
 /* Place holder for calls to ioctl that don't use the value parameter. */
 #define mmcPARAMETER_NOT_USED			( ( void * ) 0 )
@@ -28,8 +28,15 @@
 /* Clock speed to use before the card type is determined. */
 #define mmcSD_INTERFACE_SLOW_CLOCK		100000UL
 
-/* Clock speed to use after the card type has been determined. */
-#define mmcSD_INTERFACE_FAST_CLOCK		10000000UL
+/* Clock speed to use after the card type has been determined - max clock of
+SD card in SPI mode, SPI bus uses the highest clock that doesn't exceed it. */
+#define mmcSD_INTERFACE_FAST_CLOCK		20000000UL
+
+/* Max time to wait for the SPI bus, converted to ticks. */
+#define mmcBUS_TIMEOUT					( 1000UL / portTICK_RATE_MS )
+
+/* Max time to wait for DMA transfer of data block, converted to ticks. */
+#define mmcDMA_TIMEOUT					( 100UL / portTICK_RATE_MS )
 
 /* Misc constants required by the MMC SPI protocol. */
 #define mmc80_CLOCKS_IN_BYTES			( 10 )
@@ -58,6 +65,11 @@
 #define mmcCMD55_LEADING_COMMAND_OF_ACMD	( 0x40+55 )	/* APP_CMD */
 #define mmcCMD58_READ_OCR					( 0x40+58 )	/* READ_OCR */
 
+/* Direction of the last access to the card. */
+#define mmcACCESS_NONE					0
+#define mmcACCESS_READ					1
+#define mmcACCESS_WRITE					2
+
 /* A block time of 500ms, converted to ticks. */
 #define mmc500ms		( ( void * ) ( 500UL / portTICK_RATE_MS ) )
 
@@ -69,7 +81,7 @@
 static BYTE prvSendCommand( BYTE cCommand,	DWORD xArgument	);
 
 /*
- * Deselect the card and release the SPI bus.
+ * Deselect the card, the SPI bus stays acquired.
  */
 static void prvDeselectCard( void );
 
@@ -93,11 +105,48 @@ static bool prvQueryCard( BYTE ucCommand, DWORD ulCommandArgument, BYTE *pucRxBu
  */
 static bool prvReceiveDataBlock( BYTE *pcBuffer, UINT xBytesToRead );
 
+/*
+ * Receive xCount consecutive blocks of open multi block read.
+ */
+static bool prvReceiveDataBlocks( BYTE *pcBuffer, BYTE xCount );
+
 /*
  * Write a block of data to the card.
  */
 static bool prvWriteDataBlock( const BYTE *pcBuffer, BYTE cToken );
 
+/*
+ * Write xCount consecutive blocks of open multi block write.
+ */
+static bool prvWriteDataBlocks( const BYTE *pcBuffer, BYTE xCount );
+
+/*
+ * End multi block read or write which was left open, if any.
+ */
+static bool prvCloseStream( void );
+
+/*
+ * Deselect the card and release the SPI bus - card is left selected if multi
+ * block read or write is still open.
+ */
+static void prvReleaseCard( void );
+
+/*
+ * Read size of allocation unit of the card from SD status.
+ */
+static DWORD prvReadAllocationUnit( void );
+
+/*
+ * Called by SPI bus when it is acquired for other device while the card was
+ * left selected with open multi block read or write.
+ */
+static void prvDeselectHook( void );
+
+/*
+ * Convert sector number to the address used by the card.
+ */
+static DWORD prvSectorToAddress( DWORD ulSector );
+
 /*
  * Check the card is inserted, and set the STA_NODISK bits in the xDiskStatus
  * byte accordingly.  Return pdTRUE if the card is present, and pdFALSE if the
@@ -113,6 +162,38 @@ static volatile DSTATUS xDiskStatus = STA_NOINIT;
 /* Stores the card type discovered during the initialisation process. */
 static BYTE ucInsertedCardType = 0U;
 
+/* Throughput statistics of mmcDiskRead() and mmcDiskWrite(). */
+static MmcStatistics xStatistics;
+
+/* Descriptor of the card on the SPI bus. */
+static SpiDevice xSdDevice = { SD_CS_GPIO, SD_CS_PIN, mmcSD_INTERFACE_SLOW_CLOCK, SPI_MODE_0, prvDeselectHook };
+
+/* Direction of the last successful mmcDiskRead() or mmcDiskWrite(). */
+static BYTE ucLastAccess = mmcACCESS_NONE;
+
+/* Sector which follows the last accessed one - access to this sector in the
+same direction is sequential. */
+static DWORD ulNextSector;
+
+/* True if multi block read or write (in direction of ucLastAccess) is still
+open, so that sequential access can continue it without any command. */
+static bool bStreamOpen = false;
+
+/* Size of allocation unit of the card in sectors, read from SD status during
+initialisation, 0 if unknown. */
+static DWORD ulAllocationUnit = 0;
+
+/* Sectors which may be pre-erased by mmcDiskWrite() which starts among them -
+their content is not needed.  Set with MMC_SET_PRE_ERASE, cleared by any write
+which overlaps them. */
+static DWORD ulPreEraseSector, ulPreEraseCount = 0;
+
+/* Sizes of allocation unit for AU_SIZE field of SD status, in sectors. */
+static const DWORD pulAllocationUnits[ 16 ] =
+{
+	0, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 24576, 32768, 49152, 65536, 131072
+};
+
 /*-----------------------------------------------------------*/
 
 /*-----------------------------------------------------------------------*/
@@ -130,10 +211,12 @@ const portTickType xTimeOut = 1000UL / portTICK_RATE_MS;
 
 	if (initialized == false)
 	{
-		gpioConfigurePin(SD_CS_GPIO, SD_CS_PIN, GPIO_OUT_PP_2MHz);
-		SD_CS_bb = SD_CS_DEASSERTED;
+		if (spiBusInitialize() != ERROR_NONE)
+		{
+			return STA_NOINIT;
+		}
 
-		spiInitialize();
+		spiBusDeviceInitialize(&xSdDevice);
 
 		initialized = true;
 	}
@@ -146,10 +229,21 @@ const portTickType xTimeOut = 1000UL / portTICK_RATE_MS;
 	else if( ( xDiskStatus & STA_NOINIT ) != 0U )
 	{
 		/* Always start with the slow SPI clock. */
-		spiSetBaudRate(mmcSD_INTERFACE_SLOW_CLOCK);
+		spiBusSetBaudRate(&xSdDevice, mmcSD_INTERFACE_SLOW_CLOCK);
+
+		/* Card is reset, so any open multi block transfer is lost. */
+		ucLastAccess = mmcACCESS_NONE;
+		bStreamOpen = false;
+		ulAllocationUnit = 0;
+		ulPreEraseCount = 0;
+
+		if( spiBusAcquire( &xSdDevice, mmcBUS_TIMEOUT ) != ERROR_NONE )
+		{
+			return xDiskStatus;
+		}
 
 		/* Wait the obligatory 80 clocks. */
-		spiRead(ucBuffer, mmc80_CLOCKS_IN_BYTES);
+		spiBusRead(ucBuffer, mmc80_CLOCKS_IN_BYTES);
 
 		cCardType = 0;
 		if( prvSendCommand( mmcCMD0_SOFTWARE_RESET, 0 ) == 1 )
@@ -161,7 +255,7 @@ const portTickType xTimeOut = 1000UL / portTICK_RATE_MS;
 			{
 				/* SDHC */
 				/* Get trailing return value of R7 resp */
-				spiRead(ucBuffer, mmcOCR_LENGTH);
+				spiBusRead(ucBuffer, mmcOCR_LENGTH);
 
 				if( ( ucBuffer[ 2 ] == 0x01 ) && ( ucBuffer[ 3 ] == 0xAA ) )
 				{
@@ -177,7 +271,7 @@ const portTickType xTimeOut = 1000UL / portTICK_RATE_MS;
 					if( ( ( xTaskGetTickCount() - xTimeAtStart ) < xTimeOut ) && ( prvSendCommand( mmcCMD58_READ_OCR, 0 ) == 0 ) )
 					{
 						/* Check CCS bit in the OCR */
-						spiRead(ucBuffer, mmcOCR_LENGTH);
+						spiBusRead(ucBuffer, mmcOCR_LENGTH);
 
 						/* SDv2 */
 						if( ( ucBuffer[ 0 ] & 0x40 ) != 0 )
@@ -227,9 +321,17 @@ const portTickType xTimeOut = 1000UL / portTICK_RATE_MS;
 		{
 			/* Initialization succeeded.  Clear STA_NOINIT */
 			xDiskStatus &= ~STA_NOINIT;
-			spiSetBaudRate(mmcSD_INTERFACE_FAST_CLOCK);
+			spiBusSetBaudRate(&xSdDevice, mmcSD_INTERFACE_FAST_CLOCK);
+
+			if( ( cCardType & CT_SD2 ) != 0 )
+			{
+				ulAllocationUnit = prvReadAllocationUnit();
+				prvDeselectCard();
+			}
 		}
 
+		spiBusRelease();
+
 		xReturn = xDiskStatus;
 	}
 
@@ -261,7 +363,7 @@ DSTATUS xReturn;
 /*-----------------------------------------------------------------------*/
 /* Read Sector(s)                                                        */
 /*-----------------------------------------------------------------------*/
-DRESULT disk_read
+DRESULT mmcDiskRead
 		(
 			BYTE	cDriveNumber,	/* Physical drive nmuber (0) */
 			BYTE	*pcBuffer,		/* Pointer to the data buffer to store read data */
@@ -270,6 +372,8 @@ DRESULT disk_read
 		)
 {
 DRESULT xReturn;
+portTickType xTimeAtStart;
+bool bSequential, bContinued = false, bSuccess = false;
 
 	if( ( cDriveNumber != 0 ) || ( xCount == 0 ) )
 	{
@@ -279,54 +383,69 @@ DRESULT xReturn;
 	{
 		xReturn = RES_NOTRDY;
 	}
+	else if( spiBusAcquire( &xSdDevice, mmcBUS_TIMEOUT ) != ERROR_NONE )
+	{
+		xReturn = RES_NOTRDY;
+	}
 	else
 	{
-		if( ( ucInsertedCardType & CT_BLOCK ) == 0U )
+		xTimeAtStart = xTaskGetTickCount();
+
+		bSequential = ( ucLastAccess == mmcACCESS_READ ) && ( ulSector == ulNextSector );
+
+		if( ( bStreamOpen == true ) && ( bSequential == true ) )
 		{
-			/* Convert to byte address if needed */
-			ulSector *= mmcSECTOR_SIZE;
+			/* Continue multi block read - the card already waits with the
+			next block. */
+			bContinued = true;
+			bSuccess = prvReceiveDataBlocks( pcBuffer, xCount );
 		}
-
-		if( xCount == 1 )
+		else
 		{
-			/* Single block read */
-			if( prvSendCommand( mmcCMD17_READ_SINGLE_BLOCK, ulSector ) == 0 )
+			prvCloseStream();
+
+			if( ( xCount == 1 ) && ( bSequential == false ) )
 			{
-				if( prvReceiveDataBlock( pcBuffer, mmcSECTOR_SIZE ) == true )
-				{
-					xCount = 0;
-				}
+				/* Single block read */
+				bSuccess = ( prvSendCommand( mmcCMD17_READ_SINGLE_BLOCK, prvSectorToAddress( ulSector ) ) == 0 ) &&
+						( prvReceiveDataBlock( pcBuffer, mmcSECTOR_SIZE ) == true );
+			}
+			else if( prvSendCommand( mmcCMD18_READ_MULTI_BLOCK, prvSectorToAddress( ulSector ) ) == 0 )
+			{
+				/* Multiple block read, left open for following sequential
+				reads. */
+				bStreamOpen = true;
+				bSuccess = prvReceiveDataBlocks( pcBuffer, xCount );
 			}
 		}
+
+		if( bSuccess == true )
+		{
+			ucLastAccess = mmcACCESS_READ;
+			ulNextSector = ulSector + xCount;
+		}
 		else
 		{
-			/* Multiple block read */
-			if( prvSendCommand( mmcCMD18_READ_MULTI_BLOCK, ulSector ) == 0 )
-			{
-				do
-				{
-					if( prvReceiveDataBlock( pcBuffer, mmcSECTOR_SIZE ) == false )
-					{
-						break;
-					}
-
-					pcBuffer += mmcSECTOR_SIZE;
-				} while( --xCount );
-
-				prvSendCommand( mmcCMD12_STOP, 0 );
-			}
+			prvCloseStream();
+			ucLastAccess = mmcACCESS_NONE;
 		}
 
-		prvDeselectCard();
+		prvReleaseCard();
 
-		if( xCount > 0 )
+		taskENTER_CRITICAL();
+		if( bSuccess == true )
 		{
-			xReturn = RES_ERROR;
+			xStatistics.readSectors += xCount;
+			xStatistics.readTicks += xTaskGetTickCount() - xTimeAtStart;
+			xStatistics.streamContinuations += bContinued == true ? 1 : 0;
 		}
 		else
 		{
-			xReturn = RES_OK;
+			xStatistics.errors++;
 		}
+		taskEXIT_CRITICAL();
+
+		xReturn = bSuccess == true ? RES_OK : RES_ERROR;
 	}
 
 	return xReturn;
@@ -338,7 +457,7 @@ DRESULT xReturn;
 /* Write Sector(s)                                                       */
 /*-----------------------------------------------------------------------*/
 #if _READONLY == 0
-DRESULT disk_write
+DRESULT mmcDiskWrite
 		(
 			BYTE		cDriveNumber,	/* Physical drive nmuber (0) */
 			const BYTE	*pcBuffer,		/* Pointer to the data to be written */
@@ -347,6 +466,9 @@ DRESULT disk_write
 		)
 {
 DRESULT xReturn;
+portTickType xTimeAtStart;
+bool bSequential, bContinued = false, bSuccess = false, bPreErased = false;
+DWORD ulEraseCount;
 
 	if( ( cDriveNumber != 0 ) || ( xCount == 0 ) )
 	{
@@ -360,64 +482,98 @@ DRESULT xReturn;
 	{
 		xReturn = RES_WRPRT;
 	}
+	else if( spiBusAcquire( &xSdDevice, mmcBUS_TIMEOUT ) != ERROR_NONE )
+	{
+		xReturn = RES_NOTRDY;
+	}
 	else
 	{
-		if( ( ucInsertedCardType & CT_BLOCK ) == 0 )
+		xTimeAtStart = xTaskGetTickCount();
+
+		/* Pre-erase hint is used by the write which starts among hinted
+		sectors, any write which overlaps them makes it stale. */
+		if( ( ulPreEraseCount != 0 ) && ( ulSector >= ulPreEraseSector ) && ( ulSector - ulPreEraseSector < ulPreEraseCount ) )
 		{
-			/* Convert to byte address if needed */
-			ulSector *= mmcSECTOR_SIZE;
+			ulEraseCount = ulPreEraseCount - ( ulSector - ulPreEraseSector );
+			ulPreEraseCount = 0;
 		}
-
-		if( xCount == 1 )
+		else
 		{
-			/* Single block write */
-			if( prvSendCommand( mmcCMD24_WRITE_SINGLE_BLOCK, ulSector ) == 0 )
+			ulEraseCount = 0;
+
+			if( ( ulPreEraseCount != 0 ) && ( ulPreEraseSector - ulSector < xCount ) )
 			{
-				if( prvWriteDataBlock( pcBuffer, 0xFE ) == true )
-				{
-					xCount = 0;
-				}
+				ulPreEraseCount = 0;
 			}
 		}
+
+		bSequential = ( ucLastAccess == mmcACCESS_WRITE ) && ( ulSector == ulNextSector );
+
+		/* Write which uses pre-erase hint needs new multi block write, as the
+		number of sectors to pre-erase is sent before CMD25. */
+		if( ( bStreamOpen == true ) && ( bSequential == true ) && ( ulEraseCount == 0 ) )
+		{
+			/* Continue multi block write. */
+			bContinued = true;
+			bSuccess = prvWriteDataBlocks( pcBuffer, xCount );
+		}
 		else
 		{
-			/* Multiple block write */
-			if( ucInsertedCardType & CT_SDC )
+			prvCloseStream();
+
+			if( ( xCount == 1 ) && ( bSequential == false ) && ( ulEraseCount == 0 ) )
 			{
-				prvSendCommand( mmcACMD23_SET_ERASE_COUNT, xCount );
+				/* Single block write */
+				bSuccess = ( prvSendCommand( mmcCMD24_WRITE_SINGLE_BLOCK, prvSectorToAddress( ulSector ) ) == 0 ) &&
+						( prvWriteDataBlock( pcBuffer, 0xFE ) == true );
 			}
-
-			if( prvSendCommand( mmcCMD25_WRITE_MULTI_BLOCK, ulSector ) == 0 )
+			else
 			{
-				do
+				/* Multiple block write, left open for following sequential
+				writes.  Sectors up to the end of pre-erase hint are erased
+				at once, so following writes of the stream are fast. */
+				if( ucInsertedCardType & CT_SDC )
 				{
-					if( prvWriteDataBlock( pcBuffer, 0xFC ) != true )
-					{
-						break;
-					}
-
-					pcBuffer += mmcSECTOR_SIZE;
-
-				} while( --xCount );
+					prvSendCommand( mmcACMD23_SET_ERASE_COUNT, ulEraseCount > xCount ? ulEraseCount : xCount );
+				}
 
-				if( prvWriteDataBlock( NULL, 0xFD ) != true )
+				if( prvSendCommand( mmcCMD25_WRITE_MULTI_BLOCK, prvSectorToAddress( ulSector ) ) == 0 )
 				{
-					/* STOP_TRAN token */
-					xCount = 1;
+					bStreamOpen = true;
+					bSuccess = prvWriteDataBlocks( pcBuffer, xCount );
+					bPreErased = ( ( ucInsertedCardType & CT_SDC ) != 0 ) && ( ulEraseCount != 0 );
 				}
 			}
 		}
 
-		prvDeselectCard();
+		if( bSuccess == true )
+		{
+			ucLastAccess = mmcACCESS_WRITE;
+			ulNextSector = ulSector + xCount;
+		}
+		else
+		{
+			prvCloseStream();
+			ucLastAccess = mmcACCESS_NONE;
+		}
+
+		prvReleaseCard();
 
-		if( xCount > 0 )
+		taskENTER_CRITICAL();
+		if( bSuccess == true )
 		{
-			xReturn = RES_ERROR;
+			xStatistics.writeSectors += xCount;
+			xStatistics.writeTicks += xTaskGetTickCount() - xTimeAtStart;
+			xStatistics.streamContinuations += bContinued == true ? 1 : 0;
+			xStatistics.preEraseSectors += bPreErased == true ? ulEraseCount : 0;
 		}
 		else
 		{
-			xReturn = RES_OK;
+			xStatistics.errors++;
 		}
+		taskEXIT_CRITICAL();
+
+		xReturn = bSuccess == true ? RES_OK : RES_ERROR;
 	}
 
 	return xReturn;
@@ -431,7 +587,7 @@ DRESULT xReturn;
 /*-----------------------------------------------------------------------*/
 
 #if _USE_IOCTL != 0
-DRESULT disk_ioctl
+DRESULT mmcDiskIoctl
 		(
 			BYTE	cDriveNumber,	/* Physical drive nmuber (0) */
 			BYTE	cControlCode,	/* Control code */
@@ -452,15 +608,31 @@ WORD	usSize;
 	{
 		xResult = RES_NOTRDY;
 	}
+	else if( cControlCode == MMC_SET_PRE_ERASE )
+	{
+		/* Remember sectors which a following write may pre-erase (DWORD[2]:
+		first sector, count).  ACMD23 count is 23-bit.  Card is not accessed,
+		so open multi block write is left intact. */
+		ulPreEraseSector = ( ( DWORD * ) pvBuffer )[ 0 ];
+		ulPreEraseCount = ( ( DWORD * ) pvBuffer )[ 1 ] & 0x7FFFFFUL;
+		xResult = RES_OK;
+	}
+	else if( spiBusAcquire( &xSdDevice, mmcBUS_TIMEOUT ) != ERROR_NONE )
+	{
+		xResult = RES_NOTRDY;
+	}
 	else
 	{
+		/* Any command ends multi block read or write, sync commits it. */
+		const bool bClosed = prvCloseStream();
+
 		switch( cControlCode )
 		{
 			case CTRL_SYNC:
 
 				/* Make sure that no pending write process. Do not remove
 				this or written ulSector might not left updated. */
-				if( prvSelectCard() == true )
+				if( ( bClosed == true ) && ( prvSelectCard() == true ) )
 				{
 					xResult = RES_OK;
 					prvDeselectCard();
@@ -505,21 +677,12 @@ WORD	usSize;
 				/* Get erase block size in unit of ulSector (DWORD) */
 				if( ( ucInsertedCardType & CT_SD2 ) != 0 )
 				{
-					/* SDC ver 2.00 */
-					if( prvQueryCard( mmcACMD13_READ_SD_STATUS, 0, pcTempBuffer, mmcMAX_QUERY_STRING_BYTES ) == true )
+					/* SDC ver 2.00 - allocation unit read during
+					initialisation. */
+					if( ulAllocationUnit != 0 )
 					{
-						* ( DWORD * ) pvBuffer = 16UL << ( pcTempBuffer[ 10 ] >> 4 );
+						* ( DWORD * ) pvBuffer = ulAllocationUnit;
 						xResult = RES_OK;
-
-						/* Only 16 of the 64 bytes have been read.  Purge
-						the remaining bytes.  Read bytes 16 to 32. */
-						spiRead(pcTempBuffer, mmcMAX_QUERY_STRING_BYTES);
-
-						/* Read bytes 32 to 48. */
-						spiRead(pcTempBuffer, mmcMAX_QUERY_STRING_BYTES);
-
-						/* Read bytes 48 to 64. */
-						spiRead(pcTempBuffer, mmcMAX_QUERY_STRING_BYTES);
 					}
 				}
 				else
@@ -579,7 +742,7 @@ WORD	usSize;
 				if( prvSendCommand( mmcCMD58_READ_OCR, 0 ) == 0 )
 				{
 					/* READ_OCR */
-					spiRead(pcExternalBuffer, mmcOCR_LENGTH);
+					spiBusRead(pcExternalBuffer, mmcOCR_LENGTH);
 
 					xResult = RES_OK;
 				}
@@ -602,9 +765,10 @@ WORD	usSize;
 				xResult = RES_PARERR;
 				break;
 		}
-	}
 
-	prvDeselectCard();
+		prvDeselectCard();
+		spiBusRelease();
+	}
 
 	return xResult;
 }
@@ -626,6 +790,7 @@ static BYTE prvSendCommand( BYTE cCommand,	DWORD xArgument	)
 {
 BYTE cResult = 0, n;
 BYTE cCommandString[ mmcCOMMAND_LENGTH_BYTES ];
+bool bSelected = true;
 
 	if( ( cCommand & 0x80 ) != 0 )
 	{
@@ -638,9 +803,16 @@ BYTE cCommandString[ mmcCOMMAND_LENGTH_BYTES ];
 	{
 		cResult = 0xff;
 
-		/* Select the card and wait for ready */
-		prvDeselectCard();
-		if( prvSelectCard() == true )
+		/* Select the card and wait for ready - except for stop of multi
+		block read, the card is selected then and sends data instead of
+		signalling ready. */
+		if( cCommand != mmcCMD12_STOP )
+		{
+			prvDeselectCard();
+			bSelected = prvSelectCard();
+		}
+
+		if( bSelected == true )
 		{
 			/* Send command packet */
 			cCommandString[ 0 ] = cCommand;
@@ -665,19 +837,19 @@ BYTE cCommandString[ mmcCOMMAND_LENGTH_BYTES ];
 				cCommandString[ 5 ] = 0x01;
 			}
 
-			if (spiWrite(cCommandString, mmcCOMMAND_LENGTH_BYTES) == mmcCOMMAND_LENGTH_BYTES)
+			if (spiBusWrite(cCommandString, mmcCOMMAND_LENGTH_BYTES) == mmcCOMMAND_LENGTH_BYTES)
 			{
 				/* Receive command response */
 				if( cCommand == mmcCMD12_STOP )
 				{
 					/* Skip a stuff byte when stop reading */
-					spiRead(&cResult, sizeof(cResult));
+					spiBusRead(&cResult, sizeof(cResult));
 				}
 
 				/* Wait for a valid response. */
 				for( n = 0; n < 10; n++ )
 				{
-					if(spiRead(&cResult, sizeof(cResult)) == sizeof(cResult))
+					if(spiBusRead(&cResult, sizeof(cResult)) == sizeof(cResult))
 					{
 						if( ( cResult & 0x80 ) == 0 )
 						{
@@ -701,10 +873,10 @@ BYTE cDummy;
 
 	xTimeOnEntering = xTaskGetTickCount();
 
-	spiRead(&cDummy, sizeof(cDummy));
+	spiBusRead(&cDummy, sizeof(cDummy));
 	do
 	{
-		spiRead(&cDummy, sizeof(cDummy));
+		spiBusRead(&cDummy, sizeof(cDummy));
 	}
 	while( ( cDummy != 0xFF ) && ( ( xTaskGetTickCount() - xTimeOnEntering ) < xMaxTimeToWait_ms ) );
 
@@ -716,8 +888,8 @@ static void prvDeselectCard( void )
 {
 	uint8_t cDummy;
 
-	SD_CS_bb = SD_CS_DEASSERTED;
-	spiRead(&cDummy, sizeof(cDummy));
+	spiBusDeselect();
+	spiBusRead(&cDummy, sizeof(cDummy));
 }
 /*-----------------------------------------------------------*/
 
@@ -725,7 +897,7 @@ static bool prvSelectCard( void )
 {
 bool xReturn = true;
 
-	SD_CS_bb = SD_CS_ASSERTED;
+	spiBusSelect();
 	if( prvWaitForCardReady() != 0xFF )
 	{
 		prvDeselectCard();
@@ -754,7 +926,7 @@ BYTE cTimedOut = ( BYTE ) pdFALSE;
 
 		do
 		{
-			spiRead(pucRxBuffer, sizeof(*pucRxBuffer));
+			spiBusRead(pucRxBuffer, sizeof(*pucRxBuffer));
 
 			if( ( xTaskGetTickCount() - xTimeAtStart ) > xTimeOut )
 			{
@@ -766,10 +938,10 @@ BYTE cTimedOut = ( BYTE ) pdFALSE;
 		if( cTimedOut != pdTRUE )
 		{
 			/* Read data. */
-			if(spiRead(pucRxBuffer, uiRxLength) == uiRxLength )
+			if(spiBusRead(pucRxBuffer, uiRxLength) == uiRxLength )
 			{
 				/* Read and discard CRC. */
-				spiRead(cDummy, sizeof(cDummy));
+				spiBusRead(cDummy, sizeof(cDummy));
 				xReturn = true;
 			}
 		}
@@ -791,17 +963,17 @@ const portTickType xMaxTimeToWait_ms = 200 / portTICK_RATE_MS;
 	/* Wait with timeout for a valid byte. */
 	do
 	{
-		spiRead(pcToken, sizeof(*pcToken));
+		spiBusRead(pcToken, sizeof(*pcToken));
 	} while( ( *pcToken == 0xff ) && ( ( xTaskGetTickCount() - xTimeOnEntering ) < xMaxTimeToWait_ms ) );
 
 	/* Was the byte as expected? */
 	if( *pcToken == 0xfe )
 	{
-		/* Receive the data block. */
-		if(spiRead(pcBuffer, xBytesToRead) == xBytesToRead )
+		/* Receive the data block with DMA, the task sleeps in the meantime. */
+		if( spiBusTransferDma( NULL, pcBuffer, xBytesToRead, mmcDMA_TIMEOUT ) == ERROR_NONE )
 		{
 			/* Read and discard the CRC. */
-			spiRead(pcToken, sizeof(pcToken));
+			spiBusRead(pcToken, sizeof(pcToken));
 			xReturn = true;
 		}
 	}
@@ -810,6 +982,22 @@ const portTickType xMaxTimeToWait_ms = 200 / portTICK_RATE_MS;
 }
 /*-----------------------------------------------------------*/
 
+static bool prvReceiveDataBlocks( BYTE *pcBuffer, BYTE xCount )
+{
+	do
+	{
+		if( prvReceiveDataBlock( pcBuffer, mmcSECTOR_SIZE ) == false )
+		{
+			return false;
+		}
+
+		pcBuffer += mmcSECTOR_SIZE;
+	} while( --xCount );
+
+	return true;
+}
+/*-----------------------------------------------------------*/
+
 #if _READONLY == 0
 static bool prvWriteDataBlock( const BYTE *pcBuffer, BYTE cToken )
 {
@@ -819,16 +1007,16 @@ volatile bool bReturn = false;
 
 	if( prvWaitForCardReady() == 0xff )
 		/* Transmit the token. */
-		if( spiWrite(&cToken, sizeof( cToken ) ) == 1 )
+		if( spiBusWrite(&cToken, sizeof( cToken ) ) == 1 )
 		{
 			if( cToken != 0xFD )
 			{
-				/* Write the data block. */
-				if( spiWrite(pcBuffer, mmcDATA_BLOCK_SIZE ) == mmcDATA_BLOCK_SIZE )
+				/* Write the data block with DMA, the task sleeps in the meantime. */
+				if( spiBusTransferDma( pcBuffer, NULL, mmcDATA_BLOCK_SIZE, mmcDMA_TIMEOUT ) == ERROR_NONE )
 					/* Write the CRC. */
-					if( spiWrite(cCRCDummy, sizeof( cCRCDummy ) ) == sizeof( cCRCDummy ) )
+					if( spiBusWrite(cCRCDummy, sizeof( cCRCDummy ) ) == sizeof( cCRCDummy ) )
 						/* Receive response. */
-						if(spiRead(&cToken, sizeof(cToken)) == sizeof(cToken))
+						if(spiBusRead(&cToken, sizeof(cToken)) == sizeof(cToken))
 							if( ( cToken & 0x1f ) == 0x05 )
 								bReturn = true;
 			}
@@ -839,9 +1027,117 @@ volatile bool bReturn = false;
 	configASSERT( bReturn );
 	return bReturn;
 }
+/*-----------------------------------------------------------*/
+
+static bool prvWriteDataBlocks( const BYTE *pcBuffer, BYTE xCount )
+{
+	do
+	{
+		if( prvWriteDataBlock( pcBuffer, 0xFC ) != true )
+		{
+			return false;
+		}
+
+		pcBuffer += mmcSECTOR_SIZE;
+	} while( --xCount );
+
+	return true;
+}
 #endif /* _READONLY */
 /*-----------------------------------------------------------*/
 
+static bool prvCloseStream( void )
+{
+bool bReturn = true;
+
+	if( bStreamOpen == true )
+	{
+		bStreamOpen = false;
+
+		if( ucLastAccess == mmcACCESS_READ )
+		{
+			prvSendCommand( mmcCMD12_STOP, 0 );
+		}
+#if _READONLY == 0
+		else if( prvWriteDataBlock( NULL, 0xFD ) != true )
+		{
+			/* STOP_TRAN token */
+			bReturn = false;
+
+			taskENTER_CRITICAL();
+			xStatistics.errors++;
+			taskEXIT_CRITICAL();
+		}
+#endif /* _READONLY == 0 */
+	}
+
+	return bReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvReleaseCard( void )
+{
+	if( bStreamOpen == true )
+	{
+		spiBusReleaseSelected();
+	}
+	else
+	{
+		prvDeselectCard();
+		spiBusRelease();
+	}
+}
+/*-----------------------------------------------------------*/
+
+static DWORD prvReadAllocationUnit( void )
+{
+BYTE pcTempBuffer[ mmcMAX_QUERY_STRING_BYTES ];
+DWORD ulReturn = 0;
+
+	if( prvQueryCard( mmcACMD13_READ_SD_STATUS, 0, pcTempBuffer, mmcMAX_QUERY_STRING_BYTES ) == true )
+	{
+		/* AU_SIZE is the upper nibble of byte 10. */
+		ulReturn = pulAllocationUnits[ pcTempBuffer[ 10 ] >> 4 ];
+
+		/* Only 16 of the 64 bytes have been read.  Purge the remaining
+		bytes. */
+		spiBusRead(pcTempBuffer, mmcMAX_QUERY_STRING_BYTES);
+		spiBusRead(pcTempBuffer, mmcMAX_QUERY_STRING_BYTES);
+		spiBusRead(pcTempBuffer, mmcMAX_QUERY_STRING_BYTES);
+	}
+
+	return ulReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvDeselectHook( void )
+{
+	prvCloseStream();
+	prvDeselectCard();
+}
+/*-----------------------------------------------------------*/
+
+static DWORD prvSectorToAddress( DWORD ulSector )
+{
+	if( ( ucInsertedCardType & CT_BLOCK ) == 0U )
+	{
+		/* Convert to byte address if needed */
+		ulSector *= mmcSECTOR_SIZE;
+	}
+
+	return ulSector;
+}
+/*-----------------------------------------------------------*/
+
+void mmcGetStatistics( MmcStatistics *pxStatistics )
+{
+	taskENTER_CRITICAL();
+	*pxStatistics = xStatistics;
+	pxStatistics->allocationUnit = ulAllocationUnit;
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
 DWORD get_fattime(void)
 {
 	return 0;								// no time is implemented
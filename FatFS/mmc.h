@@ -0,0 +1,40 @@
+/**
+ * \file mmc.h
+ * \brief Header for mmc.cpp
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef MMC_H_
+#define MMC_H_
+
+#include <cstdint>
+
+#include "diskio.h"
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// throughput statistics of SD card, times include commands and waiting for the card
+struct MmcStatistics
+{
+	uint32_t readSectors;					///< number of sectors read by successful mmcDiskRead() calls
+	uint32_t readTicks;						///< time spent in successful mmcDiskRead() calls, ticks
+	uint32_t writeSectors;					///< number of sectors written by successful mmcDiskWrite() calls
+	uint32_t writeTicks;					///< time spent in successful mmcDiskWrite() calls, ticks
+	uint32_t errors;						///< number of failed mmcDiskRead() and mmcDiskWrite() calls
+	uint32_t streamContinuations;			///< number of calls which continued open multi-block read or write
+	uint32_t allocationUnit;				///< allocation unit of the card from SD status, sectors, 0 if unknown
+	uint32_t preEraseSectors;				///< number of sectors announced with ACMD23 from MMC_SET_PRE_ERASE hints
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+DRESULT mmcDiskRead(BYTE drive, BYTE *buffer, DWORD sector, BYTE count);
+DRESULT mmcDiskWrite(BYTE drive, const BYTE *buffer, DWORD sector, BYTE count);
+DRESULT mmcDiskIoctl(BYTE drive, BYTE control_code, void *buffer);
+void mmcGetStatistics(MmcStatistics *statistics);
+
+#endif /* MMC_H_ */
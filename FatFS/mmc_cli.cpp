@@ -0,0 +1,580 @@
+/**
+ * \file mmc_cli.cpp
+ * \brief SD card command-line interface
+ *
+ * prefix: mmcCli
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "mmc_cli.hpp"
+
+#include "mmc.h"
+#include "disk_cache.h"
+#include "append_log.h"
+#include "storage_service.h"
+#include "ff.h"
+#include "sys_sd.h"
+#include "command.hpp"
+#include "command_arguments.hpp"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include <memory>
+
+#include <cerrno>
+#include <cstring>
+#include <cstddef>
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| private types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// arguments of "sd_log_bench" command
+struct SdLogBenchArguments
+{
+	/// amount of data written to each file, KB
+	uint32_t kilobytes;
+
+	/// size of single record, bytes
+	uint32_t size;
+};
+
+/// arguments of "sd_service_bench" command
+struct SdServiceBenchArguments
+{
+	/// amount of data written to the log, KB
+	uint32_t kilobytes;
+
+	/// size of single record, bytes
+	uint32_t size;
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+FRESULT appendLogBench_(uint32_t length, uint32_t size, portTickType &ticks);
+FRESULT fileWriteBench_(uint32_t length, uint32_t size, portTickType &ticks);
+uint32_t kilobytesPerSecond_(uint32_t sectors, uint32_t ticks);
+int sdLogBenchHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream);
+int sdServiceBenchHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream);
+int sdServiceStatsHandler_(const char **, uint32_t, FILE * const output_stream);
+int sdServiceStatsStructuredHandler_(const char **, uint32_t, void * const buffer, const size_t size);
+int sdStatsHandler_(const char **, uint32_t, FILE * const output_stream);
+int sdStatsStructuredHandler_(const char **, uint32_t, void * const buffer, const size_t size);
+FRESULT serviceBench_(uint32_t length, uint32_t size, portTickType &ticks, portTickType &max_latency_ticks);
+void serviceBenchCallback_(StorageRequest *request);
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// definition of "sd_stats" command
+const CommandDefinition sdStatsCommandDefinition_ =
+{
+		"sd_stats",				// command string
+		0,						// maximum number of arguments
+		sdStatsHandler_,		// handler function
+		"sd_stats: displays throughput of SD card sector reads and writes and statistics of sector cache\n",	// string displayed by help function
+		sdStatsStructuredHandler_,	// structured handler function
+};
+
+/// fields of "sd_log_bench" command's arguments
+const CommandArgumentField sdLogBenchArgumentFields_[] =
+{
+		{"kilobytes", CommandArgumentType::UINT32, CommandArgumentField::REQUIRED,
+				offsetof(SdLogBenchArguments, kilobytes)},
+		{"size", CommandArgumentType::UINT32, CommandArgumentField::OPTIONAL, offsetof(SdLogBenchArguments, size)},
+};
+
+/// schema of "sd_log_bench" command's arguments
+constexpr CommandArgumentsSchema<SdLogBenchArguments> sdLogBenchArgumentsSchema_ =
+		commandArgumentsSchema<SdLogBenchArguments>(sdLogBenchArgumentFields_);
+
+/// definition of "sd_log_bench" command
+const CommandDefinition sdLogBenchCommandDefinition_ =
+{
+		"sd_log_bench",			// command string
+		4,						// maximum number of arguments
+		sdLogBenchHandler_,		// handler function
+		"sd_log_bench --kilobytes kilobytes [--size size]: compares appending to file with f_write() and to "
+		"preallocated append-log\n"
+		"\tkilobytes - amount of data written to each file,\n"
+		"\tsize - size of single record in bytes, [1; 512], default = 512\n",	// string displayed by help function
+		nullptr,				// structured handler function
+};
+
+/// definition of "sd_service_stats" command
+const CommandDefinition sdServiceStatsCommandDefinition_ =
+{
+		"sd_service_stats",		// command string
+		0,						// maximum number of arguments
+		sdServiceStatsHandler_,	// handler function
+		"sd_service_stats: displays queue depth and request latency of storage service\n",	// string displayed by help function
+		sdServiceStatsStructuredHandler_,	// structured handler function
+};
+
+/// fields of "sd_service_bench" command's arguments
+const CommandArgumentField sdServiceBenchArgumentFields_[] =
+{
+		{"kilobytes", CommandArgumentType::UINT32, CommandArgumentField::REQUIRED,
+				offsetof(SdServiceBenchArguments, kilobytes)},
+		{"size", CommandArgumentType::UINT32, CommandArgumentField::OPTIONAL,
+				offsetof(SdServiceBenchArguments, size)},
+};
+
+/// schema of "sd_service_bench" command's arguments
+constexpr CommandArgumentsSchema<SdServiceBenchArguments> sdServiceBenchArgumentsSchema_ =
+		commandArgumentsSchema<SdServiceBenchArguments>(sdServiceBenchArgumentFields_);
+
+/// definition of "sd_service_bench" command
+const CommandDefinition sdServiceBenchCommandDefinition_ =
+{
+		"sd_service_bench",		// command string
+		4,						// maximum number of arguments
+		sdServiceBenchHandler_,	// handler function
+		"sd_service_bench --kilobytes kilobytes [--size size]: appends records to preallocated append-log through "
+		"storage service, keeping its queue full\n"
+		"\tkilobytes - amount of data written to the log,\n"
+		"\tsize - size of single record in bytes, [1; 512], default = 512\n",	// string displayed by help function
+		nullptr,				// structured handler function
+};
+
+/// names of benchmark files
+const char fileWriteBenchPath_[] = "bench_fw.bin";
+const char appendLogBenchPath_[] = "bench_al.bin";
+const char serviceBenchPath_[] = "bench_ss.bin";
+
+/// data of records written by benchmark, in flash
+const uint8_t benchPattern_[_MAX_SS] {};
+
+}	// namespace
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Initializes SD card command-line interface.
+ *
+ * Registers commands.
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int mmcCliInitialize()
+{
+	int ret = commandRegister(sdStatsCommandDefinition_);
+	if (ret == 0)
+		ret = commandRegister(sdLogBenchCommandDefinition_);
+	if (ret == 0)
+		ret = commandRegister(sdServiceStatsCommandDefinition_);
+	if (ret == 0)
+		ret = commandRegister(sdServiceBenchCommandDefinition_);
+
+	return ret;
+}
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Appends records to preallocated append-log.
+ *
+ * Previous log is removed first, so that the time includes allocation of contiguous chain for the whole log.
+ *
+ * \param [in] length is the amount of data to write, bytes
+ * \param [in] size is the size of single record, bytes
+ * \param [out] ticks is a reference to variable for time of open, writes and close, ticks
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT appendLogBench_(const uint32_t length, const uint32_t size, portTickType &ticks)
+{
+	FRESULT result = f_unlink(appendLogBenchPath_);
+	if (result != FR_OK && result != FR_NO_FILE)
+		return result;
+
+	std::unique_ptr<AppendLog> log(new AppendLog);
+	const portTickType start = xTaskGetTickCount();
+
+	result = appendLogOpen(log.get(), appendLogBenchPath_, length);
+	if (result != FR_OK)
+		return result;
+
+	for (uint32_t written = 0; written < length && result == FR_OK; written += size)
+		result = appendLogWrite(log.get(), benchPattern_, length - written < size ? length - written : size);
+
+	const FRESULT close_result = appendLogClose(log.get());
+	ticks = xTaskGetTickCount() - start;
+
+	return result != FR_OK ? result : close_result;
+}
+
+/**
+ * \brief Appends records to regular file with f_write().
+ *
+ * \param [in] length is the amount of data to write, bytes
+ * \param [in] size is the size of single record, bytes
+ * \param [out] ticks is a reference to variable for time of open, writes and close, ticks
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT fileWriteBench_(const uint32_t length, const uint32_t size, portTickType &ticks)
+{
+	std::unique_ptr<FIL> file(new FIL);
+	const portTickType start = xTaskGetTickCount();
+
+	FRESULT result = f_open(file.get(), fileWriteBenchPath_, FA_WRITE | FA_CREATE_ALWAYS);
+	if (result != FR_OK)
+		return result;
+
+	for (uint32_t written = 0; written < length && result == FR_OK; written += size)
+	{
+		const UINT chunk = length - written < size ? length - written : size;
+		UINT count;
+		result = f_write(file.get(), benchPattern_, chunk, &count);
+		if (result == FR_OK && count != chunk)
+			result = FR_DENIED;				// volume full
+	}
+
+	const FRESULT close_result = f_close(file.get());
+	ticks = xTaskGetTickCount() - start;
+
+	return result != FR_OK ? result : close_result;
+}
+
+/**
+ * \brief Calculates throughput.
+ *
+ * \param [in] sectors is the number of transferred sectors
+ * \param [in] ticks is the time of transfers, ticks
+ *
+ * \return throughput in KB/s, 0 if time is 0
+ */
+
+uint32_t kilobytesPerSecond_(const uint32_t sectors, const uint32_t ticks)
+{
+	const uint32_t milliseconds = ticks * portTICK_RATE_MS;
+	// 512 B sector is 0.5 KB, so KB/s = sectors * 0.5 * 1000 / ms
+	return milliseconds != 0 ? static_cast<uint64_t>(sectors) * 500 / milliseconds : 0;
+}
+
+/**
+ * \brief Handler of "sd_log_bench" command.
+ *
+ * Writes the same amount of data in records of the same size to regular file with f_write() and to preallocated
+ * append-log, then displays time and throughput of both.
+ *
+ * \param [in] arguments_array is the array with arguments, first elements is the command string
+ * \param [in] arguments_count is the number of arguments in arguments_array
+ * \param [out] output_stream is the stream used for output
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int sdLogBenchHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream)
+{
+	SdLogBenchArguments arguments {};
+	arguments.size = _MAX_SS;
+	const int ret = commandArgumentsParse(sdLogBenchArgumentsSchema_, arguments_array, arguments_count, arguments,
+			output_stream);
+	if (ret < 0)
+		return ret;
+
+	if (arguments.kilobytes == 0 || arguments.kilobytes > UINT32_MAX / 1024 || arguments.size == 0 ||
+			arguments.size > _MAX_SS)
+		return -EINVAL;
+
+	if (sd_mount() == false)
+		return -ENODEV;
+
+	const uint32_t length = arguments.kilobytes * 1024;
+	const uint32_t sectors = length / _MAX_SS;
+	portTickType file_write_ticks, append_log_ticks;
+
+	FRESULT result = fileWriteBench_(length, arguments.size, file_write_ticks);
+	if (result == FR_OK)
+		result = appendLogBench_(length, arguments.size, append_log_ticks);
+
+	if (result != FR_OK)
+	{
+		fiprintf(output_stream, "FatFS error %d\n", result);
+		return -EIO;
+	}
+
+	const int printed = fiprintf(output_stream, "f_write(): %lu KB in %lu ms = %lu KB/s\n"
+			"append-log: %lu KB in %lu ms = %lu KB/s\n", arguments.kilobytes, file_write_ticks * portTICK_RATE_MS,
+			kilobytesPerSecond_(sectors, file_write_ticks), arguments.kilobytes, append_log_ticks * portTICK_RATE_MS,
+			kilobytesPerSecond_(sectors, append_log_ticks));
+
+	return printed < 0 ? -EIO : 0;
+}
+
+/**
+ * \brief Handler of "sd_service_bench" command.
+ *
+ * Appends records to preallocated append-log through storage service, then displays time, throughput and max latency
+ * of requests.
+ *
+ * \param [in] arguments_array is the array with arguments, first elements is the command string
+ * \param [in] arguments_count is the number of arguments in arguments_array
+ * \param [out] output_stream is the stream used for output
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int sdServiceBenchHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream)
+{
+	SdServiceBenchArguments arguments {};
+	arguments.size = _MAX_SS;
+	const int ret = commandArgumentsParse(sdServiceBenchArgumentsSchema_, arguments_array, arguments_count,
+			arguments, output_stream);
+	if (ret < 0)
+		return ret;
+
+	if (arguments.kilobytes == 0 || arguments.kilobytes > UINT32_MAX / 1024 || arguments.size == 0 ||
+			arguments.size > _MAX_SS)
+		return -EINVAL;
+
+	if (sd_mount() == false)
+		return -ENODEV;
+
+	const uint32_t length = arguments.kilobytes * 1024;
+	portTickType ticks, max_latency_ticks;
+
+	const FRESULT result = serviceBench_(length, arguments.size, ticks, max_latency_ticks);
+	if (result != FR_OK)
+	{
+		fiprintf(output_stream, "FatFS error %d\n", result);
+		return -EIO;
+	}
+
+	const int printed = fiprintf(output_stream, "storage service: %lu KB in %lu ms = %lu KB/s, "
+			"max latency = %lu ms\n", arguments.kilobytes, ticks * portTICK_RATE_MS,
+			kilobytesPerSecond_(length / _MAX_SS, ticks), max_latency_ticks * portTICK_RATE_MS);
+
+	return printed < 0 ? -EIO : 0;
+}
+
+/**
+ * \brief Handler of "sd_service_stats" command.
+ *
+ * Displays counters, queue depth and latency of requests of storage service.
+ *
+ * \param [out] output_stream is the stream used for output
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int sdServiceStatsHandler_(const char **, uint32_t, FILE * const output_stream)
+{
+	StorageServiceStatistics statistics;
+	storageServiceGetStatistics(&statistics);
+
+	const uint32_t average_latency_ticks = statistics.completed != 0 ?
+			statistics.totalLatencyTicks / statistics.completed : 0;
+	const int ret = fiprintf(output_stream, "Submitted = %lu\nRejected (queue full) = %lu\nCompleted = %lu\n"
+			"Failed = %lu\nQueue depth = %lu\nMax queue depth = %lu\nLast latency = %lu ms\n"
+			"Max latency = %lu ms\nAverage latency = %lu ms\n", statistics.submitted, statistics.rejected,
+			statistics.completed, statistics.failed, statistics.queueDepth, statistics.queueDepthMax,
+			statistics.lastLatencyTicks * portTICK_RATE_MS, statistics.maxLatencyTicks * portTICK_RATE_MS,
+			average_latency_ticks * portTICK_RATE_MS);
+
+	return ret < 0 ? -EIO : 0;
+}
+
+/**
+ * \brief Structured handler of "sd_service_stats" command.
+ *
+ * Fills StorageServiceStatistics struct with statistics of storage service.
+ *
+ * \param [out] buffer is the buffer for response
+ * \param [in] size is the size of buffer, bytes
+ *
+ * \return size of response on success, negated errno code otherwise (errno not set)
+ */
+
+int sdServiceStatsStructuredHandler_(const char **, uint32_t, void * const buffer, const size_t size)
+{
+	if (size < sizeof(StorageServiceStatistics))
+		return -ENOSPC;
+
+	StorageServiceStatistics statistics;
+	storageServiceGetStatistics(&statistics);
+	memcpy(buffer, &statistics, sizeof(statistics));
+	return sizeof(statistics);
+}
+
+/**
+ * \brief Handler of "sd_stats" command.
+ *
+ * Displays number of transferred sectors, time of transfers and throughput of SD card reads and writes, followed by
+ * statistics of sector cache.
+ *
+ * \param [out] output_stream is the stream used for output
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int sdStatsHandler_(const char **, uint32_t, FILE * const output_stream)
+{
+	MmcStatistics statistics;
+	mmcGetStatistics(&statistics);
+	DiskCacheStatistics cache_statistics;
+	diskCacheGetStatistics(&cache_statistics);
+
+	const int ret = fiprintf(output_stream, "Read: %lu sectors in %lu ms = %lu KB/s\n"
+			"Write: %lu sectors in %lu ms = %lu KB/s\nStream continuations = %lu\nErrors = %lu\n"
+			"Allocation unit = %lu sectors\nPre-erased sectors = %lu\n"
+			"Cache hits = %lu\nCache misses = %lu\nCache evictions = %lu\nCache write-backs = %lu\n",
+			statistics.readSectors, statistics.readTicks * portTICK_RATE_MS,
+			kilobytesPerSecond_(statistics.readSectors, statistics.readTicks),
+			statistics.writeSectors, statistics.writeTicks * portTICK_RATE_MS,
+			kilobytesPerSecond_(statistics.writeSectors, statistics.writeTicks), statistics.streamContinuations,
+			statistics.errors, statistics.allocationUnit, statistics.preEraseSectors, cache_statistics.hits,
+			cache_statistics.misses, cache_statistics.evictions, cache_statistics.writeBacks);
+
+	return ret < 0 ? -EIO : 0;
+}
+
+/**
+ * \brief Structured handler of "sd_stats" command.
+ *
+ * Fills MmcStatistics struct with SD card statistics, followed by DiskCacheStatistics struct.
+ *
+ * \param [out] buffer is the buffer for response
+ * \param [in] size is the size of buffer, bytes
+ *
+ * \return size of response on success, negated errno code otherwise (errno not set)
+ */
+
+int sdStatsStructuredHandler_(const char **, uint32_t, void * const buffer, const size_t size)
+{
+	if (size < sizeof(MmcStatistics) + sizeof(DiskCacheStatistics))
+		return -ENOSPC;
+
+	MmcStatistics statistics;
+	mmcGetStatistics(&statistics);
+	memcpy(buffer, &statistics, sizeof(statistics));
+
+	DiskCacheStatistics cache_statistics;
+	diskCacheGetStatistics(&cache_statistics);
+	memcpy(static_cast<uint8_t *>(buffer) + sizeof(statistics), &cache_statistics, sizeof(cache_statistics));
+
+	return sizeof(statistics) + sizeof(cache_statistics);
+}
+
+/**
+ * \brief Appends records to preallocated append-log through storage service.
+ *
+ * Log is opened and closed directly, all records are submitted as LOG_APPEND requests. Completed requests are
+ * returned by their callback through a queue and reused, so the queue of storage service is kept full.
+ *
+ * \param [in] length is the amount of data to write, bytes
+ * \param [in] size is the size of single record, bytes
+ * \param [out] ticks is a reference to variable for time of open, writes and close, ticks
+ * \param [out] max_latency_ticks is a reference to variable for max latency of requests, ticks
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT serviceBench_(const uint32_t length, const uint32_t size, portTickType &ticks,
+		portTickType &max_latency_ticks)
+{
+	FRESULT result = f_unlink(serviceBenchPath_);
+	if (result != FR_OK && result != FR_NO_FILE)
+		return result;
+
+	std::unique_ptr<AppendLog> log(new AppendLog);
+	std::unique_ptr<StorageRequest[]> requests(new StorageRequest[STORAGE_SERVICE_QUEUE_SIZE]);
+	const xQueueHandle completed_queue = xQueueCreate(STORAGE_SERVICE_QUEUE_SIZE, sizeof(StorageRequest *));
+	if (completed_queue == nullptr)
+		return FR_NOT_ENOUGH_CORE;
+
+	for (size_t i = 0; i < STORAGE_SERVICE_QUEUE_SIZE; i++)
+	{
+		StorageRequest * const request = &requests[i];
+		request->result = FR_OK;
+		request->latencyTicks = 0;
+		xQueueSend(completed_queue, &request, 0);
+	}
+
+	const portTickType start = xTaskGetTickCount();
+	max_latency_ticks = 0;
+
+	result = appendLogOpen(log.get(), serviceBenchPath_, length);
+	if (result != FR_OK)
+	{
+		vQueueDelete(completed_queue);
+		return result;
+	}
+
+	uint32_t written = 0;
+	for (size_t pending = 0; pending < STORAGE_SERVICE_QUEUE_SIZE; )
+	{
+		StorageRequest *request;
+		xQueueReceive(completed_queue, &request, portMAX_DELAY);
+
+		if (request->result != FR_OK && result == FR_OK)
+			result = request->result;
+		if (request->latencyTicks > max_latency_ticks)
+			max_latency_ticks = request->latencyTicks;
+
+		if (written == length || result != FR_OK)	// nothing more to submit, collect remaining requests
+		{
+			pending++;
+			continue;
+		}
+
+		const UINT chunk = length - written < size ? length - written : size;
+		request->type = StorageRequestType::LOG_APPEND;
+		request->log = log.get();
+		request->buffer = benchPattern_;
+		request->size = chunk;
+		request->callback = serviceBenchCallback_;
+		request->argument = completed_queue;
+		if (storageServiceSubmit(request, portMAX_DELAY) != 0)
+		{
+			result = FR_INT_ERR;
+			pending++;
+			continue;
+		}
+
+		written += chunk;
+	}
+
+	vQueueDelete(completed_queue);
+	const FRESULT close_result = appendLogClose(log.get());
+	ticks = xTaskGetTickCount() - start;
+
+	return result != FR_OK ? result : close_result;
+}
+
+/**
+ * \brief Completion callback of requests of storage service benchmark.
+ *
+ * Returns the request to the queue given as its argument.
+ *
+ * \param [in] request is a pointer to completed request
+ */
+
+void serviceBenchCallback_(StorageRequest * const request)
+{
+	const xQueueHandle completed_queue = static_cast<xQueueHandle>(request->argument);
+	xQueueSend(completed_queue, &request, 0);
+}
+
+}	// namespace
@@ -0,0 +1,16 @@
+/**
+ * \file mmc_cli.hpp
+ * \brief Header for mmc_cli.cpp
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef MMC_CLI_HPP_
+#define MMC_CLI_HPP_
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+int mmcCliInitialize();
+
+#endif	// MMC_CLI_HPP_
@@ -0,0 +1,218 @@
+/**
+ * \file storage_service.cpp
+ * \brief Storage service task executing queued file requests
+ *
+ * Tasks which must not block for SD card latency (busy card may need hundreds of milliseconds for single write) or
+ * wait for volume mutex of FatFS submit requests - write, append, sync - to the queue and continue. Service task
+ * executes requests in order of submission and calls completion callback of each, which may give a semaphore or send
+ * the request back through a queue to the submitter.
+ *
+ * Submission with ticks_to_wait = 0 never blocks - request is rejected if the queue is full. Queue depth and latency
+ * (from submission to completion) of requests are collected in statistics.
+ *
+ * prefix: storageService
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "storage_service.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include <cerrno>
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+FRESULT execute_(const StorageRequest &request);
+FRESULT fileWrite_(FIL *file, DWORD offset, const void *buffer, UINT size);
+void task_(void *parameters);
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// queue of pointers to submitted requests
+xQueueHandle requestQueue_;
+
+/// statistics of storage service
+StorageServiceStatistics statistics_;
+
+}	// namespace
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Gets statistics of storage service.
+ *
+ * \param [out] statistics is a pointer to struct for statistics
+ */
+
+void storageServiceGetStatistics(StorageServiceStatistics * const statistics)
+{
+	taskENTER_CRITICAL();
+	*statistics = statistics_;
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * \brief Initializes storage service.
+ *
+ * Creates request queue and service task.
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int storageServiceInitialize()
+{
+	requestQueue_ = xQueueCreate(STORAGE_SERVICE_QUEUE_SIZE, sizeof(StorageRequest *));
+	if (requestQueue_ == nullptr)
+		return -ENOMEM;
+
+	const portBASE_TYPE ret = xTaskCreate(task_, reinterpret_cast<const signed char *>("storage"),
+			STORAGE_SERVICE_TASK_STACK_SIZE, nullptr, STORAGE_SERVICE_TASK_PRIORITY, nullptr);
+	return ret == pdPASS ? 0 : -ENOMEM;
+}
+
+/**
+ * \brief Submits request to storage service.
+ *
+ * \param [in,out] request is a pointer to request, its type, file or log, offset, buffer, size, callback and argument
+ * must be set
+ * \param [in] ticks_to_wait is the max time to wait for free space in the queue, 0 to never block, ticks
+ *
+ * \return 0 on success, -EINVAL if request is invalid, -EAGAIN if the queue was full
+ */
+
+int storageServiceSubmit(StorageRequest * const request, const portTickType ticks_to_wait)
+{
+	const bool log_request = request->type == StorageRequestType::LOG_APPEND ||
+			request->type == StorageRequestType::LOG_CHECKPOINT;
+	if ((log_request == true && request->log == nullptr) || (log_request == false && request->file == nullptr))
+		return -EINVAL;
+
+	request->submitTicks = xTaskGetTickCount();
+
+	taskENTER_CRITICAL();
+	statistics_.queueDepth++;				// before sending - request may be completed before xQueueSend() returns
+	if (statistics_.queueDepth > statistics_.queueDepthMax)
+		statistics_.queueDepthMax = statistics_.queueDepth;
+	taskEXIT_CRITICAL();
+
+	const portBASE_TYPE ret = xQueueSend(requestQueue_, &request, ticks_to_wait);
+
+	taskENTER_CRITICAL();
+	if (ret == pdTRUE)
+		statistics_.submitted++;
+	else
+	{
+		statistics_.queueDepth--;
+		statistics_.rejected++;
+	}
+	taskEXIT_CRITICAL();
+
+	return ret == pdTRUE ? 0 : -EAGAIN;
+}
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Executes single request.
+ *
+ * \param [in] request is a reference to request
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT execute_(const StorageRequest &request)
+{
+	switch (request.type)
+	{
+	case StorageRequestType::WRITE:
+		return fileWrite_(request.file, request.offset, request.buffer, request.size);
+	case StorageRequestType::APPEND:
+		return fileWrite_(request.file, request.file->fsize, request.buffer, request.size);
+	case StorageRequestType::SYNC:
+		return f_sync(request.file);
+	case StorageRequestType::LOG_APPEND:
+		return appendLogWrite(request.log, request.buffer, request.size);
+	case StorageRequestType::LOG_CHECKPOINT:
+		return appendLogCheckpoint(request.log);
+	default:
+		return FR_INVALID_PARAMETER;
+	}
+}
+
+/**
+ * \brief Writes data at given offset of regular file.
+ *
+ * \param [in] file is a pointer to opened file
+ * \param [in] offset is the offset in file, bytes
+ * \param [in] buffer is the data to write
+ * \param [in] size is the size of data, bytes
+ *
+ * \return FR_OK on success, FR_DENIED if volume is full, other error code otherwise
+ */
+
+FRESULT fileWrite_(FIL * const file, const DWORD offset, const void * const buffer, const UINT size)
+{
+	FRESULT result = f_lseek(file, offset);
+	if (result != FR_OK)
+		return result;
+
+	UINT count;
+	result = f_write(file, buffer, size, &count);
+	if (result == FR_OK && count != size)
+		result = FR_DENIED;					// volume full
+
+	return result;
+}
+
+/**
+ * \brief Task of storage service.
+ *
+ * Executes requests from the queue and calls their completion callbacks.
+ */
+
+void task_(void *)
+{
+	while (1)
+	{
+		StorageRequest *request;
+		if (xQueueReceive(requestQueue_, &request, portMAX_DELAY) != pdTRUE)
+			continue;
+
+		request->result = execute_(*request);
+		const portTickType latency = xTaskGetTickCount() - request->submitTicks;
+		request->latencyTicks = latency;
+
+		taskENTER_CRITICAL();
+		statistics_.queueDepth--;
+		statistics_.completed++;
+		if (request->result != FR_OK)
+			statistics_.failed++;
+		statistics_.lastLatencyTicks = latency;
+		if (latency > statistics_.maxLatencyTicks)
+			statistics_.maxLatencyTicks = latency;
+		statistics_.totalLatencyTicks += latency;
+		taskEXIT_CRITICAL();
+
+		if (request->callback != nullptr)
+			request->callback(request);		// request may be reused by submitter from now on
+	}
+}
+
+}	// namespace
@@ -0,0 +1,76 @@
+/**
+ * \file storage_service.h
+ * \brief Header for storage_service.cpp
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef STORAGE_SERVICE_H_
+#define STORAGE_SERVICE_H_
+
+#include "append_log.h"
+#include "ff.h"
+
+#include "FreeRTOS.h"
+
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// type of request executed by storage service
+enum class StorageRequestType
+{
+	WRITE,									///< f_write() of buffer at offset of regular file
+	APPEND,									///< f_write() of buffer at the end of regular file
+	SYNC,									///< f_sync() of regular file
+	LOG_APPEND,								///< appendLogWrite() of buffer to append-log
+	LOG_CHECKPOINT,							///< appendLogCheckpoint() of append-log
+};
+
+struct StorageRequest;
+
+/// completion callback of request, called from storage service task - must not block for long
+typedef void (*StorageCallback)(StorageRequest *request);
+
+/// request executed by storage service, owned by submitter - it (and its buffer) must not be touched from submission
+/// until completion callback is called
+struct StorageRequest
+{
+	StorageRequestType type;				///< type of request
+	FIL *file;								///< opened file of WRITE, APPEND and SYNC requests
+	AppendLog *log;							///< opened append-log of LOG_APPEND and LOG_CHECKPOINT requests
+	DWORD offset;							///< offset in file of WRITE request, bytes
+	const void *buffer;						///< data of WRITE, APPEND and LOG_APPEND requests
+	UINT size;								///< size of data, bytes
+	StorageCallback callback;				///< completion callback, nullptr if not needed
+	void *argument;							///< argument for completion callback, not used by storage service
+
+	FRESULT result;							///< result of request, valid in completion callback
+	portTickType submitTicks;				///< tick count at submission
+	portTickType latencyTicks;				///< time from submission to completion, valid in completion callback, ticks
+};
+
+/// statistics of storage service
+struct StorageServiceStatistics
+{
+	uint32_t submitted;						///< number of requests accepted to the queue
+	uint32_t rejected;						///< number of requests not accepted because the queue was full
+	uint32_t completed;						///< number of executed requests
+	uint32_t failed;						///< number of executed requests with result other than FR_OK
+	uint32_t queueDepth;					///< number of requests waiting in the queue or being executed
+	uint32_t queueDepthMax;					///< max value of queueDepth
+	uint32_t lastLatencyTicks;				///< latency of the last executed request, ticks
+	uint32_t maxLatencyTicks;				///< max latency of executed request, ticks
+	uint32_t totalLatencyTicks;				///< sum of latencies of executed requests, ticks
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+void storageServiceGetStatistics(StorageServiceStatistics *statistics);
+int storageServiceInitialize();
+int storageServiceSubmit(StorageRequest *request, portTickType ticks_to_wait);
+
+#endif	// STORAGE_SERVICE_H_
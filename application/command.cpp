@@ -10,7 +10,7 @@
 
 #include "command.hpp"
 
-#include <new>
+#include "config.h"
 
 #include <cstring>
 #include <cerrno>
@@ -18,25 +18,12 @@
 namespace
 {
 
-/*---------------------------------------------------------------------------------------------------------------------+
-| local variables' types
-+---------------------------------------------------------------------------------------------------------------------*/
-
-/// list element holding the command definition
-struct ListEntry
-{
-	/// command definition
-	const CommandDefinition *definition;
-
-	/// ptr to next item on the list
-	ListEntry *next;
-};
-
 /*---------------------------------------------------------------------------------------------------------------------+
 | local functions' prototypes
 +---------------------------------------------------------------------------------------------------------------------*/
 
 int helpHandler_(const char **arguments_array, uint32_t arguments_count, FILE *output_stream);
+size_t lowerBound_(const char * const command);
 
 /*---------------------------------------------------------------------------------------------------------------------+
 | local variables
@@ -49,15 +36,18 @@ const CommandDefinition helpCommandDefinition_ =
 		0,					// maximum number of arguments
 		helpHandler_,		// handler function
 		"help: lists all available commands\n",	// string displayed by help function
+		nullptr,				// structured handler function
 };
 
-/// head of list holding all registered commands, always starts with "help" handler
-ListEntry listHead_ =
+/// table holding all registered commands sorted by command string, always contains "help" handler
+const CommandDefinition *commands_[COMMAND_COUNT_MAX] =
 {
 		&helpCommandDefinition_,
-		nullptr,
 };
 
+/// number of valid entries in commands_[]
+size_t commandsCount_ = 1;
+
 }	// namespace
 
 /*---------------------------------------------------------------------------------------------------------------------+
@@ -65,52 +55,30 @@ ListEntry listHead_ =
 +---------------------------------------------------------------------------------------------------------------------*/
 
 /**
- * \brief Converts arguments to map of key-value pairs.
+ * \brief Finds registered command.
  *
- * Key is identified by double hyphen. Values are optional.
+ * Binary search in the sorted table of commands, O(log n).
  *
- * \param [in] arguments_array is an array with arguments
- * \param [in] arguments_count is the number or arguments on the arguments_array
- * \param [out] pairs is the output array with pairs
- * \param [in] pairs_length is the size of externally provided pairs array
+ * \param [in] command is the command string
  *
- * \return number of found pairs
+ * \return pointer to definition of found command, nullptr if no such command is registered
  */
 
-uint32_t commandArgumentsToPairs(const char * const * const arguments_array, const uint32_t arguments_count,
-		CommandArgumentPair * const pairs, const size_t pairs_length)
+const CommandDefinition * commandFind(const char * const command)
 {
-	pairs[0].key = nullptr;
-
-	uint32_t i = 0, j = 0;
-	uint32_t found = 0;
+	const size_t index = lowerBound_(command);
 
-	while (i < arguments_count && j < pairs_length)
-	{
-		const char * const argument = arguments_array[i++];
-
-		// if the argument is in form --something - it's a key
-		if (argument[0] == '-' && argument[1] == '-' && argument[2] != '\0')
-		{
-			// if current key in pairs array is valid and another key was found - increment the index
-			if (pairs[j].key != nullptr)
-				j++;
+	if (index < commandsCount_ && strcmp(commands_[index]->command, command) == 0)
+		return commands_[index];
 
-			pairs[j].key = &argument[2];
-			pairs[j].value = nullptr;			// initially value is unknown
-
-			found++;
-		}
-		else								// otherwise it's a value
-			pairs[j].value = argument;
-	}
-
-	return found;
+	return nullptr;
 }
 
 /**
  * \brief Processes command input string.
  *
+ * No dynamic memory is used - arguments are collected in array on stack.
+ *
  * \param [in] input is input string
  * \param [out] output_stream is the stream used for output
  *
@@ -119,56 +87,40 @@ uint32_t commandArgumentsToPairs(const char * const * const arguments_array, con
 
 int commandProcessInput(char * const input, FILE * const output_stream)
 {
-	ListEntry *ptr = &listHead_;
-
-	int error = -EINVAL;	// initially assume that command was not found
-
 	char *lasts;
 	const char *argument = strtok_r(input, " \t\n", &lasts);	// get the command itself (first word)
 	if (argument == nullptr)
-		return error;
-
-	while (ptr != nullptr)
-	{
-		if (strcmp(ptr->definition->command, argument) == 0)	// was the input matched to command?
-		{
-			// always make space for command name - first entry
-			const uint32_t arguments_count_max = ptr->definition->argumentsCountMax + 1;
-
-			const char ** const arguments_array = new (std::nothrow) const char*[arguments_count_max];
+		return -EINVAL;
 
-			if (arguments_array == nullptr)
-				return -ENOMEM;
+	const CommandDefinition * const definition = commandFind(argument);
+	if (definition == nullptr)	// command not found?
+		return -EINVAL;
 
-			uint32_t arguments_count = 0;
-			arguments_array[arguments_count++] = argument;	// first store the command (first word)
+	// always make space for command name - first entry
+	const char *arguments_array[COMMAND_ARGUMENTS_COUNT_MAX + 1];
+	const uint32_t arguments_count_max = definition->argumentsCountMax + 1;
 
-			while (arguments_count < arguments_count_max)
-			{
-				argument = strtok_r(nullptr, " \t\n", &lasts);
+	uint32_t arguments_count = 0;
+	arguments_array[arguments_count++] = argument;	// first store the command (first word)
 
-				if (argument == nullptr)	// valid argument?
-					break;					// no - no more arguments available, so break...
-
-				arguments_array[arguments_count++] = argument;
-			}
-
-			error = ptr->definition->handler(arguments_array, arguments_count, output_stream);	// execute handler
-
-			delete[] arguments_array;
+	while (arguments_count < arguments_count_max)
+	{
+		argument = strtok_r(nullptr, " \t\n", &lasts);
 
-			break;
-		}
+		if (argument == nullptr)	// valid argument?
+			break;					// no - no more arguments available, so break...
 
-		ptr = ptr->next;					// advance list
+		arguments_array[arguments_count++] = argument;
 	}
 
-	return error;
+	return definition->handler(arguments_array, arguments_count, output_stream);	// execute handler
 }
 
 /**
  * \brief Registers new command to command interpreter.
  *
+ * Command is inserted into the table of commands so that it stays sorted by command string. No dynamic memory is used.
+ *
  * This function should be called BEFORE the scheduler is started, as it's not thread-safe.
  *
  * \param [in] definition is a reference to command definition struct, it should be in flash or available through entire
@@ -179,20 +131,20 @@ int commandProcessInput(char * const input, FILE * const output_stream)
 
 int commandRegister(const CommandDefinition &definition)
 {
-	ListEntry * const new_entry = new ListEntry;
+	if (definition.argumentsCountMax > COMMAND_ARGUMENTS_COUNT_MAX)
+		return -E2BIG;
 
-	if (new_entry == nullptr)
-		return -ENOMEM;
+	if (commandsCount_ >= sizeof(commands_) / sizeof(*commands_))
+		return -ENOSPC;
 
-	new_entry->definition = &definition;
-	new_entry->next = nullptr;
+	const size_t index = lowerBound_(definition.command);
 
-	ListEntry *ptr = &listHead_;
+	if (index < commandsCount_ && strcmp(commands_[index]->command, definition.command) == 0)	// duplicate?
+		return -EEXIST;
 
-	while (ptr->next != nullptr)
-		ptr = ptr->next;
-
-	ptr->next = new_entry;
+	memmove(&commands_[index + 1], &commands_[index], (commandsCount_ - index) * sizeof(*commands_));
+	commands_[index] = &definition;
+	commandsCount_++;
 
 	return 0;
 }
@@ -207,7 +159,7 @@ namespace
 /**
  * \brief Handler of 'help' command.
  *
- * Displays all available commands' help strings.
+ * Displays all available commands' help strings, sorted alphabetically.
  *
  * \param [out] output_stream is the stream used for output
  *
@@ -216,17 +168,40 @@ namespace
 
 int helpHandler_(const char **, uint32_t, FILE *output_stream)
 {
-	const ListEntry *ptr = &listHead_;
+	for (size_t i = 0; i < commandsCount_; i++)
+		if (fputs(commands_[i]->helpString, output_stream) == EOF)
+			return -EIO;
+
+	return 0;
+}
+
+/**
+ * \brief Finds the position of command in the sorted table of commands.
+ *
+ * \param [in] command is the command string
+ *
+ * \return index of first entry in commands_[] which is not less than command, commandsCount_ if there is no such entry
+ */
+
+size_t lowerBound_(const char * const command)
+{
+	size_t first = 0;
+	size_t count = commandsCount_;
 
-	while (ptr != nullptr)
+	while (count > 0)
 	{
-		if (fputs(ptr->definition->helpString, output_stream) == EOF)
-			return -EIO;
+		const size_t step = count / 2;
 
-		ptr = ptr->next;					// advance list
+		if (strcmp(commands_[first + step]->command, command) < 0)
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+			count = step;
 	}
 
-	return 0;
+	return first;
 }
 
 }	// namespace
@@ -21,6 +21,11 @@ struct CommandDefinition
 	/// typedef of handler function
 	typedef int (&Handler)(const char **arguments_array, uint32_t arguments_count, FILE *output_stream);
 
+	/// typedef of structured handler function - fills buffer with fixed-layout response, returns its size in bytes
+	/// or negated errno code
+	typedef int (*StructuredHandler)(const char **arguments_array, uint32_t arguments_count, void *buffer,
+			size_t size);
+
 	/// command string
 	const char *command;
 
@@ -32,24 +37,16 @@ struct CommandDefinition
 
 	/// string displayed by help function
 	const char *helpString;
-};
-
-/// struct for map of key-value pairs formed of arguments
-struct CommandArgumentPair
-{
-	/// key - without preceeding "--"
-	const char *key;
 
-	/// value associated with key
-	const char *value;
+	/// structured handler function used by binary RPC, nullptr if RPC should capture output of handler
+	StructuredHandler structuredHandler;
 };
 
 /*---------------------------------------------------------------------------------------------------------------------+
 | global functions' prototypes
 +---------------------------------------------------------------------------------------------------------------------*/
 
-uint32_t commandArgumentsToPairs(const char * const * const arguments_array, const uint32_t arguments_count,
-		CommandArgumentPair * const pairs, const size_t pairs_length);
+const CommandDefinition * commandFind(const char * const command);
 int commandProcessInput(char * const input, FILE * const output_stream);
 int commandRegister(const CommandDefinition &definition);
 
@@ -0,0 +1,261 @@
+/**
+ * \file command_arguments.cpp
+ * \brief Parser of command's arguments described by schema
+ *
+ * prefix: command
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "command_arguments.hpp"
+
+#include "config.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+size_t findKey_(const CommandArgumentField * const fields, const size_t fields_count, const char * const key);
+int setField_(const CommandArgumentField &field, const char * const value, uint8_t * const base,
+		FILE * const output_stream);
+
+}	// namespace
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Parses arguments of command into struct described by array of fields.
+ *
+ * Arguments are processed in one pass - keyed arguments are stored immediately, positional arguments are collected and
+ * assigned to positional fields when the number of them is known. No dynamic memory is used.
+ *
+ * Fields of struct for which no argument was given are not modified. If parsing fails, error message generated from
+ * schema is written to output stream.
+ *
+ * \param [in] fields is the array with descriptors of fields
+ * \param [in] fields_count is the number of elements in fields array, at most 31
+ * \param [in] arguments_array is the array with arguments, first element is the command string
+ * \param [in] arguments_count is the number of arguments in arguments_array
+ * \param [out] arguments is a pointer to struct for parsed arguments
+ * \param [out] output_stream is the stream used for error messages
+ *
+ * \return bitmask of given fields (bit n set if fields[n] was given) on success, negated errno code otherwise (errno
+ * not set)
+ */
+
+int commandArgumentsParse(const CommandArgumentField * const fields, const size_t fields_count,
+		const char * const * const arguments_array, const uint32_t arguments_count, void * const arguments,
+		FILE * const output_stream)
+{
+	uint8_t * const base = static_cast<uint8_t *>(arguments);
+	const char *positional_arguments[COMMAND_ARGUMENTS_COUNT_MAX];
+	size_t positional_count = 0;
+	uint32_t given = 0;
+
+	for (uint32_t i = 1; i < arguments_count; i++)	// skip command string
+	{
+		const char * const argument = arguments_array[i];
+
+		// if the argument is in form --something - it's a key
+		if (argument[0] == '-' && argument[1] == '-' && argument[2] != '\0')
+		{
+			const size_t index = findKey_(fields, fields_count, &argument[2]);
+			if (index == fields_count)
+			{
+				fiprintf(output_stream, "Unknown argument %s\n", argument);
+				return -EINVAL;
+			}
+
+			const CommandArgumentField &field = fields[index];
+			const char *value = nullptr;
+
+			if (field.type != CommandArgumentType::FLAG)
+			{
+				if (i + 1 >= arguments_count)
+				{
+					fiprintf(output_stream, "Missing value for %s\n", argument);
+					return -EINVAL;
+				}
+
+				value = arguments_array[++i];
+			}
+
+			const int ret = setField_(field, value, base, output_stream);
+			if (ret != 0)
+				return ret;
+
+			given |= 1 << index;
+		}
+		else	// otherwise it's positional argument
+		{
+			if (positional_count >= sizeof(positional_arguments) / sizeof(*positional_arguments))
+			{
+				fputs("Too many arguments\n", output_stream);
+				return -E2BIG;
+			}
+
+			positional_arguments[positional_count++] = argument;
+		}
+	}
+
+	size_t required_positional_count = 0;
+	for (size_t index = 0; index < fields_count; index++)
+		if ((fields[index].flags & (CommandArgumentField::POSITIONAL | CommandArgumentField::REQUIRED)) ==
+				(CommandArgumentField::POSITIONAL | CommandArgumentField::REQUIRED))
+			required_positional_count++;
+
+	// optional positional fields are filled only with arguments left after all required ones
+	size_t optional_positional_count = positional_count > required_positional_count ?
+			positional_count - required_positional_count : 0;
+	size_t next_positional = 0;
+
+	for (size_t index = 0; index < fields_count && next_positional < positional_count; index++)
+	{
+		const CommandArgumentField &field = fields[index];
+
+		if ((field.flags & CommandArgumentField::POSITIONAL) == 0)
+			continue;
+
+		if ((field.flags & CommandArgumentField::REQUIRED) == 0)
+		{
+			if (optional_positional_count == 0)
+				continue;
+
+			optional_positional_count--;
+		}
+
+		const int ret = setField_(field, positional_arguments[next_positional++], base, output_stream);
+		if (ret != 0)
+			return ret;
+
+		given |= 1 << index;
+	}
+
+	if (next_positional < positional_count)
+	{
+		fputs("Too many arguments\n", output_stream);
+		return -E2BIG;
+	}
+
+	for (size_t index = 0; index < fields_count; index++)
+	{
+		const CommandArgumentField &field = fields[index];
+
+		if ((field.flags & CommandArgumentField::REQUIRED) != 0 && (given & 1 << index) == 0)
+		{
+			fiprintf(output_stream, "Missing argument %s%s\n",
+					(field.flags & CommandArgumentField::POSITIONAL) != 0 ? "" : "--", field.key);
+			return -EINVAL;
+		}
+	}
+
+	return given;
+}
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Finds keyed field with given key.
+ *
+ * \param [in] fields is the array with descriptors of fields
+ * \param [in] fields_count is the number of elements in fields array
+ * \param [in] key is the key without preceding "--"
+ *
+ * \return index of found field, fields_count if there is no such field
+ */
+
+size_t findKey_(const CommandArgumentField * const fields, const size_t fields_count, const char * const key)
+{
+	size_t index = 0;
+
+	while (index < fields_count && ((fields[index].flags & CommandArgumentField::POSITIONAL) != 0 ||
+			strcmp(fields[index].key, key) != 0))
+		index++;
+
+	return index;
+}
+
+/**
+ * \brief Converts value and stores it in the field.
+ *
+ * \param [in] field is a reference to descriptor of field
+ * \param [in] value is the value of argument, nullptr for flags
+ * \param [out] base is a pointer to struct for parsed arguments
+ * \param [out] output_stream is the stream used for error messages
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int setField_(const CommandArgumentField &field, const char * const value, uint8_t * const base,
+		FILE * const output_stream)
+{
+	uint8_t * const destination = base + field.offset;
+
+	if (field.type == CommandArgumentType::FLAG)
+	{
+		const bool flag = true;
+		memcpy(destination, &flag, sizeof(flag));
+		return 0;
+	}
+
+	if (field.type == CommandArgumentType::STRING)
+	{
+		memcpy(destination, &value, sizeof(value));
+		return 0;
+	}
+
+	uint64_t maximum;
+	size_t size;
+
+	if (field.type == CommandArgumentType::UINT8)
+	{
+		maximum = UINT8_MAX;
+		size = sizeof(uint8_t);
+	}
+	else if (field.type == CommandArgumentType::UINT16)
+	{
+		maximum = UINT16_MAX;
+		size = sizeof(uint16_t);
+	}
+	else if (field.type == CommandArgumentType::UINT32)
+	{
+		maximum = UINT32_MAX;
+		size = sizeof(uint32_t);
+	}
+	else /* if (field.type == CommandArgumentType::UINT64) */
+	{
+		maximum = UINT64_MAX;
+		size = sizeof(uint64_t);
+	}
+
+	char *end;
+	errno = 0;
+	const uint64_t number = strtoull(value, &end, 0);
+
+	if (value[0] == '\0' || value[0] == '-' || *end != '\0' || errno == ERANGE || number > maximum)
+	{
+		fiprintf(output_stream, "Invalid value \"%s\" of %s%s\n", value,
+				(field.flags & CommandArgumentField::POSITIONAL) != 0 ? "" : "--", field.key);
+		return -EINVAL;
+	}
+
+	// little-endian - the lowest bytes of the number hold the value for all sizes
+	memcpy(destination, &number, size);
+	return 0;
+}
+
+}	// namespace
@@ -0,0 +1,140 @@
+/**
+ * \file command_arguments.hpp
+ * \brief Header for command_arguments.cpp
+ *
+ * Schema of command's arguments is an array of CommandArgumentField objects describing the fields of a struct into
+ * which the arguments are parsed. Keyed fields are given as "--key value" ("--key" alone for flags), positional fields
+ * are filled with remaining arguments in the order of the schema - optional positional fields are filled only when
+ * there are more positional arguments than required positional fields.
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef COMMAND_ARGUMENTS_HPP_
+#define COMMAND_ARGUMENTS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global variables' types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// type of field in the struct with parsed arguments
+enum class CommandArgumentType : uint8_t
+{
+	/// uint8_t - decimal, hexadecimal ("0x" or "0X" prefix) or octal ("0" prefix)
+	UINT8,
+	/// uint16_t - decimal, hexadecimal ("0x" or "0X" prefix) or octal ("0" prefix)
+	UINT16,
+	/// uint32_t - decimal, hexadecimal ("0x" or "0X" prefix) or octal ("0" prefix)
+	UINT32,
+	/// uint64_t - decimal, hexadecimal ("0x" or "0X" prefix) or octal ("0" prefix)
+	UINT64,
+	/// const char * - points to the argument itself, no copy is made
+	STRING,
+	/// bool - set to true if key is given, takes no value
+	FLAG,
+};
+
+/// descriptor of single field in the struct with parsed arguments
+struct CommandArgumentField
+{
+	/// flags of field
+	enum Flags : uint8_t
+	{
+		/// field is optional keyed argument
+		OPTIONAL = 0,
+		/// argument must be given
+		REQUIRED = 1 << 0,
+		/// argument is positional - identified by position instead of key
+		POSITIONAL = 1 << 1,
+	};
+
+	/// key of argument (without preceding "--"), for positional arguments only used in error messages
+	const char *key;
+
+	/// type of field
+	CommandArgumentType type;
+
+	/// flags of field
+	uint8_t flags;
+
+	/// offset of field in the struct with parsed arguments, use offsetof()
+	uint16_t offset;
+};
+
+/**
+ * \brief Schema of arguments bound to the type of struct with parsed arguments.
+ *
+ * \param T is the type of struct with parsed arguments
+ */
+
+template<typename T>
+struct CommandArgumentsSchema
+{
+	/// array with descriptors of fields
+	const CommandArgumentField *fields;
+
+	/// number of elements in fields array
+	size_t fieldsCount;
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+int commandArgumentsParse(const CommandArgumentField * const fields, const size_t fields_count,
+		const char * const * const arguments_array, const uint32_t arguments_count, void * const arguments,
+		FILE * const output_stream);
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global templates
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Creates schema of arguments.
+ *
+ * \param T is the type of struct with parsed arguments
+ * \param N is the number of fields in schema, at most 31 - result of parsing is a bitmask of given fields
+ *
+ * \param [in] fields is a reference to array with descriptors of fields, it must be available through entire program
+ *
+ * \return schema of arguments
+ */
+
+template<typename T, size_t N>
+constexpr CommandArgumentsSchema<T> commandArgumentsSchema(const CommandArgumentField (&fields)[N])
+{
+	static_assert(N <= 31, "Too many fields in schema of arguments!");
+	return CommandArgumentsSchema<T>{fields, N};
+}
+
+/**
+ * \brief Parses arguments of command into typed struct.
+ *
+ * Fields of struct for which no argument was given are not modified, so they should be initialized with default
+ * values. If parsing fails, error message generated from schema is written to output stream.
+ *
+ * \param T is the type of struct with parsed arguments
+ *
+ * \param [in] schema is a reference to schema of arguments
+ * \param [in] arguments_array is the array with arguments, first element is the command string
+ * \param [in] arguments_count is the number of arguments in arguments_array
+ * \param [out] arguments is a reference to struct for parsed arguments
+ * \param [out] output_stream is the stream used for error messages
+ *
+ * \return bitmask of given fields (bit n set if fields[n] was given) on success, negated errno code otherwise (errno
+ * not set)
+ */
+
+template<typename T>
+inline int commandArgumentsParse(const CommandArgumentsSchema<T> &schema, const char * const * const arguments_array,
+		const uint32_t arguments_count, T &arguments, FILE * const output_stream)
+{
+	return commandArgumentsParse(schema.fields, schema.fieldsCount, arguments_array, arguments_count, &arguments,
+			output_stream);
+}
+
+#endif	// COMMAND_ARGUMENTS_HPP_
@@ -0,0 +1,166 @@
+/**
+ * \file console.cpp
+ * \brief Console task
+ *
+ * Reads input stream and dispatches text command lines to command interpreter and binary frames to RPC. Mode is
+ * detected per frame - 0x00 byte received between text lines starts binary frame, which ends with next 0x00 byte.
+ *
+ * prefix: console
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "console.hpp"
+
+#include "command.hpp"
+#include "rpc.hpp"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <cerrno>
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables' types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// streams used by console task
+struct Streams
+{
+	/// input stream
+	FILE *input;
+
+	/// output stream
+	FILE *output;
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+void task_(void *parameters);
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// streams used by console task
+Streams streams_;
+
+}	// namespace
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Initializes console.
+ *
+ * Creates console task.
+ *
+ * \param [in] input_stream is the stream used for input
+ * \param [out] output_stream is the stream used for output
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int consoleInitialize(FILE * const input_stream, FILE * const output_stream)
+{
+	streams_.input = input_stream;
+	streams_.output = output_stream;
+
+	const portBASE_TYPE ret = xTaskCreate(task_, reinterpret_cast<const signed char *>("console"),
+			CONSOLE_TASK_STACK_SIZE, &streams_, CONSOLE_TASK_PRIORITY, nullptr);
+
+	return ret == pdPASS ? 0 : -ENOMEM;
+}
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Console task.
+ *
+ * Collects text lines and binary frames in common buffer. 0x00 byte always starts binary frame, so the host can
+ * resynchronize at any moment. Input that doesn't fit in the buffer is discarded up to the end of line or frame.
+ *
+ * \param [in] parameters is a pointer to Streams struct
+ */
+
+void task_(void *parameters)
+{
+	const Streams &streams = *static_cast<const Streams *>(parameters);
+
+	char buffer[CONSOLE_INPUT_BUFFER_SIZE];
+	size_t length = 0;
+	bool binary = false;
+	bool overflow = false;
+
+	while (1)
+	{
+		const int character = fgetc(streams.input);
+
+		if (character == EOF)
+		{
+			clearerr(streams.input);
+			vTaskDelay(CONSOLE_READ_RETRY_DELAY_MS / portTICK_RATE_MS);
+			continue;
+		}
+
+		if (binary == true)
+		{
+			if (character != 0)
+			{
+				if (length < sizeof(buffer))
+					buffer[length++] = character;
+				else
+					overflow = true;
+			}
+			else if (length != 0)	// closing delimiter, consecutive delimiters are just skipped
+			{
+				if (overflow == false)
+					rpcProcessFrame(reinterpret_cast<uint8_t *>(buffer), length, streams.output);
+
+				length = 0;
+				binary = false;
+				overflow = false;
+			}
+		}
+		else if (character == 0)	// start of binary frame? partial text line is discarded
+		{
+			length = 0;
+			binary = true;
+			overflow = false;
+		}
+		else if (character == '\n')
+		{
+			if (overflow == false)
+			{
+				buffer[length] = '\0';
+				const int ret = commandProcessInput(buffer, streams.output);
+				if (ret != 0 && length != 0)
+					fiprintf(streams.output, "Error %d\n", ret);
+				fflush(streams.output);
+			}
+
+			length = 0;
+			overflow = false;
+		}
+		else if (character != '\r')
+		{
+			if (length < sizeof(buffer) - 1)	// leave space for terminating '\0'
+				buffer[length++] = character;
+			else
+				overflow = true;
+		}
+	}
+}
+
+}	// namespace
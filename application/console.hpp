@@ -0,0 +1,18 @@
+/**
+ * \file console.hpp
+ * \brief Header for console.cpp
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef CONSOLE_HPP_
+#define CONSOLE_HPP_
+
+#include <cstdio>
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+int consoleInitialize(FILE * const input_stream, FILE * const output_stream);
+
+#endif	// CONSOLE_HPP_
@@ -210,6 +210,32 @@ int DataConsumer::consumerStatsHandler_(const char **, uint32_t, FILE * const ou
 	return ret >= 0 ? 0 : -EIO;
 }
 
+/**
+ * \brief Structured handler of "consumer_stats" command.
+ *
+ * Fills DataConsumer::Stats with DataConsumer statistics.
+ *
+ * \param [out] buffer is the buffer for response
+ * \param [in] size is the size of buffer, bytes
+ *
+ * \return size of response on success, negated errno code otherwise (errno not set)
+ */
+
+int DataConsumer::consumerStatsStructuredHandler_(const char **, uint32_t, void * const buffer, const size_t size)
+{
+	if (size < sizeof(Stats))
+		return -ENOSPC;
+
+	const Stats stats =
+	{
+			dataConsumer_->subscribeRequestsCount_,
+			dataConsumer_->transfersCount_,
+			dataConsumer_->producersCount_,
+	};
+	memcpy(buffer, &stats, sizeof(stats));
+	return sizeof(stats);
+}
+
 /// \brief Trampoline for eventCallback_() member function.
 
 bool DataConsumer::eventCallbackTrampoline_(std::unique_ptr<const Etrx2Event> event)
@@ -230,4 +256,5 @@ const CommandDefinition DataConsumer::consumerStatsCommandDefinition_ =
 		0,						// maximum number of arguments
 		DataConsumer::consumerStatsHandler_,	// handler function
 		"consumer_stats: displays DataConsumer statistics\n",	// string displayed by help function
+		DataConsumer::consumerStatsStructuredHandler_,	// structured handler function
 };
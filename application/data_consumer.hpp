@@ -26,6 +26,19 @@ class DataConsumer
 {
 public:
 
+	/// fixed-layout response of "consumer_stats" command returned over binary RPC
+	struct Stats
+	{
+		/// number of subscribe requests sent
+		uint32_t subscribeRequests;
+
+		/// number of received "data:..." transfers
+		uint32_t transfers;
+
+		/// number of unique producers
+		uint32_t producers;
+	} __attribute__ ((packed));
+
 	/**
 	 * \brief DataConsumer constructor - just sets internal variables.
 	 *
@@ -69,6 +82,8 @@ private:
 
 	static int consumerStatsHandler_(const char **, uint32_t, FILE * const output_stream);
 
+	static int consumerStatsStructuredHandler_(const char **, uint32_t, void * const buffer, const size_t size);
+
 	static bool eventCallbackTrampoline_(std::unique_ptr<const Etrx2Event> event);
 
 	/**
@@ -256,6 +256,34 @@ int DataProducer::producerStatsHandler_(const char **, uint32_t, FILE * const ou
 	return ret >= 0 ? 0 : -EIO;
 }
 
+/**
+ * \brief Structured handler of "producer_stats" command.
+ *
+ * Fills DataProducer::Stats with DataProducer statistics.
+ *
+ * \param [out] buffer is the buffer for response
+ * \param [in] size is the size of buffer, bytes
+ *
+ * \return size of response on success, negated errno code otherwise (errno not set)
+ */
+
+int DataProducer::producerStatsStructuredHandler_(const char **, uint32_t, void * const buffer, const size_t size)
+{
+	if (size < sizeof(Stats))
+		return -ENOSPC;
+
+	const Stats stats =
+	{
+			dataProducer_->measurementsCount_,
+			dataProducer_->transmissionsCount_,
+			dataProducer_->subscriptionsCount_,
+			dataProducer_->removalsCount_,
+			dataProducer_->consumerCount_,
+	};
+	memcpy(buffer, &stats, sizeof(stats));
+	return sizeof(stats);
+}
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | private static variables
 +---------------------------------------------------------------------------------------------------------------------*/
@@ -269,4 +297,5 @@ const CommandDefinition DataProducer::producerStatsCommandDefinition_ =
 		0,						// maximum number of arguments
 		DataProducer::producerStatsHandler_,	// handler function
 		"producer_stats: displays DataProducer statistics\n",	// string displayed by help function
+		DataProducer::producerStatsStructuredHandler_,	// structured handler function
 };
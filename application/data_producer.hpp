@@ -26,6 +26,25 @@ class DataProducer
 {
 public:
 
+	/// fixed-layout response of "producer_stats" command returned over binary RPC
+	struct Stats
+	{
+		/// total "measurements"
+		uint32_t measurements;
+
+		/// total transmissions
+		uint32_t transmissions;
+
+		/// total subscriptions
+		uint32_t subscriptions;
+
+		/// total removals (unsubscriptions)
+		uint32_t removals;
+
+		/// current number of consumers
+		uint8_t consumers;
+	} __attribute__ ((packed));
+
 	/**
 	 * \brief DataProducer constructor - just sets internal variables.
 	 *
@@ -89,6 +108,8 @@ private:
 
 	static int producerStatsHandler_(const char **, uint32_t, FILE * const output_stream);
 
+	static int producerStatsStructuredHandler_(const char **, uint32_t, void * const buffer, const size_t size);
+
 	/**
 	 * \brief Trampoline for task_()
 	 *
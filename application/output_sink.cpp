@@ -0,0 +1,68 @@
+/**
+ * \file output_sink.cpp
+ * \brief OutputSink class implementation
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "output_sink.hpp"
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| public functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Opens stream of OutputSink.
+ *
+ * Stream is fully buffered with internal buffer of OUTPUT_SINK_CHUNK_SIZE bytes, so output of any length uses constant
+ * amount of RAM - when buffer is full, its contents are passed to transport, which blocks the writer until it can
+ * accept the chunk. Stream is opened only once, following calls return the same stream.
+ *
+ * \return pointer to stream on success, nullptr otherwise
+ */
+
+FILE * OutputSink::open()
+{
+	if (stream_ != nullptr)
+		return stream_;
+
+	const cookie_io_functions_t functions = {nullptr, writeTrampoline_, nullptr, nullptr};
+	FILE * const stream = fopencookie(this, "w", functions);
+	if (stream == nullptr)
+		return nullptr;
+
+	if (setvbuf(stream, buffer_, _IOFBF, sizeof(buffer_)) != 0)
+	{
+		fclose(stream);
+		return nullptr;
+	}
+
+	stream_ = stream;
+	return stream_;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| private static functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Write function of stream, passes chunk to transport.
+ *
+ * \param [in] cookie is a pointer to OutputSink object
+ * \param [in] buffer is a pointer to chunk
+ * \param [in] size is the size of chunk, bytes
+ *
+ * \return number of written bytes on success, -1 otherwise
+ */
+
+ssize_t OutputSink::writeTrampoline_(void *cookie, const char *buffer, size_t size)
+{
+	OutputSink &that = *static_cast<OutputSink *>(cookie);
+
+	if (that.write_(buffer, size) != 0)
+		return -1;
+
+	that.bytesCount_ += size;
+	that.chunksCount_++;
+	return size;
+}
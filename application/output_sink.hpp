@@ -0,0 +1,75 @@
+/**
+ * \file output_sink.hpp
+ * \brief OutputSink class header
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef OUTPUT_SINK_HPP_
+#define OUTPUT_SINK_HPP_
+
+#include "FreeRTOS.h"
+
+#include <cstdio>
+
+/// OutputSink is a stdio stream which passes output to transport in fixed-size chunks
+class OutputSink
+{
+public:
+
+	/**
+	 * \brief typedef of transport's write function
+	 *
+	 * Function should block until whole data is accepted by transport (it may be copied to transport's buffer or
+	 * already sent), this gives backpressure to the writer of stream. Data is not valid after the function returns.
+	 *
+	 * \param [in] data is a pointer to data
+	 * \param [in] length is the length of data, bytes
+	 *
+	 * \return 0 on success, negated errno code otherwise (errno not set)
+	 */
+
+	typedef int (&Write)(const char *data, size_t length);
+
+	/**
+	 * \brief OutputSink constructor - just sets internal variables.
+	 *
+	 * \param [in] write is a reference to transport's write function
+	 */
+
+	constexpr OutputSink(Write write) :
+			write_(write),
+			stream_(nullptr),
+			buffer_{},
+			bytesCount_(),
+			chunksCount_()
+	{};
+
+	FILE * open();
+
+	/// \return total number of bytes passed to transport
+	uint32_t getBytesCount() const { return bytesCount_; };
+
+	/// \return total number of chunks passed to transport
+	uint32_t getChunksCount() const { return chunksCount_; };
+
+private:
+
+	static ssize_t writeTrampoline_(void *cookie, const char *buffer, size_t size);
+
+	/// transport's write function
+	Write write_;
+
+	/// stream, nullptr if not yet opened
+	FILE *stream_;
+
+	/// buffer of stream, holds single chunk
+	char buffer_[OUTPUT_SINK_CHUNK_SIZE];
+
+	/// total number of bytes passed to transport
+	uint32_t bytesCount_;
+
+	/// total number of chunks passed to transport
+	uint32_t chunksCount_;
+};
+
+#endif	// OUTPUT_SINK_HPP_
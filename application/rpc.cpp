@@ -0,0 +1,371 @@
+/**
+ * \file rpc.cpp
+ * \brief Binary RPC for command interpreter
+ *
+ * Invokes registered CommandDefinition objects with typed arguments received in COBS-framed binary requests.
+ *
+ * prefix: rpc
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "rpc.hpp"
+
+#include "command.hpp"
+
+#include "config.h"
+
+#include "FreeRTOS.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+int cobsDecode_(uint8_t * const buffer, const size_t length);
+size_t cobsEncode_(const uint8_t * const input, const size_t length, uint8_t * const output);
+uint16_t crc16_(const uint8_t * const buffer, const size_t length);
+int execute_(const uint8_t * const request, const size_t length, uint8_t * const data, const size_t size,
+		RpcResponseFormat &format);
+int sendResponse_(const uint8_t sequence, const int status, const RpcResponseFormat format, const size_t length,
+		FILE * const output_stream);
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// size of header of response - sequence (u8), status (s16) and format (u8)
+constexpr size_t responseHeaderSize_ = 4;
+
+/// size of CRC16 at the end of payload
+constexpr size_t crcSize_ = 2;
+
+/// buffer for response payload with CRC
+uint8_t responseBuffer_[responseHeaderSize_ + RPC_RESPONSE_DATA_SIZE_MAX + crcSize_];
+
+/// buffer for COBS-encoded response with delimiters, COBS overhead is 1 byte per each started 254 bytes
+uint8_t encodedBuffer_[1 + sizeof(responseBuffer_) + (sizeof(responseBuffer_) + 253) / 254 + 1];
+
+/// storage for strings of arguments converted from binary request
+char argumentsBuffer_[RPC_ARGUMENTS_BUFFER_SIZE];
+
+}	// namespace
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Processes single binary RPC frame.
+ *
+ * Decodes the frame, verifies CRC, executes requested command and sends framed response to output stream. Frame with
+ * invalid CRC or format is dropped without response, as its sequence number cannot be trusted.
+ *
+ * This function is not reentrant - it should be called from one task only.
+ *
+ * \param [in,out] frame is the COBS-encoded frame without delimiters, it is decoded in place
+ * \param [in] length is the length of frame, bytes
+ * \param [out] output_stream is the stream used for output
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int rpcProcessFrame(uint8_t * const frame, const size_t length, FILE * const output_stream)
+{
+	const int decoded_length = cobsDecode_(frame, length);
+	if (decoded_length < 0)
+		return decoded_length;
+
+	if (static_cast<size_t>(decoded_length) < 1 + crcSize_)	// at least sequence and CRC are required
+		return -EBADMSG;
+
+	const size_t payload_length = decoded_length - crcSize_;
+	const uint16_t crc = frame[payload_length] | frame[payload_length + 1] << 8;
+	if (crc16_(frame, payload_length) != crc)
+		return -EBADMSG;
+
+	RpcResponseFormat format = RpcResponseFormat::STRUCTURED;
+	uint8_t * const data = responseBuffer_ + responseHeaderSize_;
+	const int ret = execute_(frame + 1, payload_length - 1, data, RPC_RESPONSE_DATA_SIZE_MAX, format);
+
+	return sendResponse_(frame[0], ret < 0 ? ret : 0, format, ret < 0 ? 0 : ret, output_stream);
+}
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Decodes COBS-encoded buffer in place.
+ *
+ * \param [in,out] buffer is the buffer with encoded data (without delimiters), decoded data is placed here
+ * \param [in] length is the length of encoded data, bytes
+ *
+ * \return length of decoded data on success, negated errno code otherwise (errno not set)
+ */
+
+int cobsDecode_(uint8_t * const buffer, const size_t length)
+{
+	size_t read_index = 0;
+	size_t write_index = 0;
+
+	while (read_index < length)
+	{
+		const uint8_t code = buffer[read_index++];
+		if (code == 0 || read_index + code - 1 > length)
+			return -EBADMSG;
+
+		for (uint8_t i = 1; i < code; i++)
+			buffer[write_index++] = buffer[read_index++];
+
+		if (code != 0xff && read_index < length)	// block shorter than maximum is followed by zero
+			buffer[write_index++] = 0;
+	}
+
+	return write_index;
+}
+
+/**
+ * \brief COBS-encodes buffer.
+ *
+ * \param [in] input is the buffer with data to encode
+ * \param [in] length is the length of data, bytes
+ * \param [out] output is the buffer for encoded data, it must have space for length + length / 254 + 1 bytes
+ *
+ * \return length of encoded data, bytes
+ */
+
+size_t cobsEncode_(const uint8_t * const input, const size_t length, uint8_t * const output)
+{
+	size_t code_index = 0;
+	size_t write_index = 1;
+	uint8_t code = 1;
+
+	for (size_t read_index = 0; read_index < length; read_index++)
+	{
+		if (input[read_index] != 0)
+		{
+			output[write_index++] = input[read_index];
+			code++;
+		}
+
+		if (input[read_index] == 0 || code == 0xff)	// end of block?
+		{
+			output[code_index] = code;
+			code_index = write_index++;
+			code = 1;
+		}
+	}
+
+	output[code_index] = code;
+
+	return write_index;
+}
+
+/**
+ * \brief Calculates CRC16-CCITT (polynomial 0x1021, initial value 0xffff) of buffer.
+ *
+ * Calculation is done with 16-entry table, processing one nibble per iteration.
+ *
+ * \param [in] buffer is the buffer with data
+ * \param [in] length is the length of data, bytes
+ *
+ * \return calculated CRC
+ */
+
+uint16_t crc16_(const uint8_t * const buffer, const size_t length)
+{
+	static const uint16_t table[16] =
+	{
+			0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+			0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+	};
+
+	uint16_t crc = 0xffff;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		crc = (crc << 4) ^ table[(crc >> 12) ^ (buffer[i] >> 4)];
+		crc = (crc << 4) ^ table[(crc >> 12) ^ (buffer[i] & 0x0f)];
+	}
+
+	return crc;
+}
+
+/**
+ * \brief Executes command from RPC request.
+ *
+ * Typed arguments are converted to strings, so that the same handler can be used for text and binary requests. If
+ * command has structured handler it is used to produce the response, otherwise text output of regular handler is
+ * captured.
+ *
+ * \param [in] request is the request payload following the sequence number
+ * \param [in] length is the length of request, bytes
+ * \param [out] data is the buffer for response data
+ * \param [in] size is the size of data buffer, bytes
+ * \param [out] format is a reference to variable which will hold format of response data
+ *
+ * \return length of response data on success, negated errno code otherwise (errno not set)
+ */
+
+int execute_(const uint8_t * const request, const size_t length, uint8_t * const data, const size_t size,
+		RpcResponseFormat &format)
+{
+	size_t index = 0;
+
+	if (index >= length)
+		return -EBADMSG;
+	const uint8_t command_length = request[index++];
+
+	if (command_length == 0 || index + command_length + 1 > length || command_length >= sizeof(argumentsBuffer_))
+		return -EBADMSG;
+
+	// command string is the first argument
+	memcpy(argumentsBuffer_, &request[index], command_length);
+	argumentsBuffer_[command_length] = '\0';
+	index += command_length;
+	size_t buffer_index = command_length + 1;
+
+	const CommandDefinition * const definition = commandFind(argumentsBuffer_);
+	if (definition == nullptr)
+		return -EINVAL;
+
+	const uint8_t arguments_count = request[index++];
+	if (arguments_count > definition->argumentsCountMax)
+		return -E2BIG;
+
+	const char *arguments_array[COMMAND_ARGUMENTS_COUNT_MAX + 1];
+	arguments_array[0] = argumentsBuffer_;
+
+	for (uint8_t i = 1; i <= arguments_count; i++)
+	{
+		if (index >= length)
+			return -EBADMSG;
+
+		const RpcArgumentType type = static_cast<RpcArgumentType>(request[index++]);
+		char * const argument = &argumentsBuffer_[buffer_index];
+		const size_t space = sizeof(argumentsBuffer_) - buffer_index;
+		int argument_length;
+
+		if (type == RpcArgumentType::UINT32)
+		{
+			if (index + sizeof(uint32_t) > length)
+				return -EBADMSG;
+
+			uint32_t value;
+			memcpy(&value, &request[index], sizeof(value));
+			index += sizeof(value);
+			argument_length = sniprintf(argument, space, "%lu", value);
+		}
+		else if (type == RpcArgumentType::UINT64)
+		{
+			if (index + sizeof(uint64_t) > length)
+				return -EBADMSG;
+
+			uint32_t value_low, value_high;
+			memcpy(&value_low, &request[index], sizeof(value_low));
+			memcpy(&value_high, &request[index + sizeof(value_low)], sizeof(value_high));
+			index += sizeof(uint64_t);
+			// "0x" prefix is required - consumers parse with base 0, which treats leading "0" as octal
+			argument_length = sniprintf(argument, space, "0x%08lX%08lX", value_high, value_low);
+			if (argument_length >= 0 && static_cast<size_t>(argument_length) < space &&
+					strtoull(argument, nullptr, 0) != (static_cast<uint64_t>(value_high) << 32 | value_low))
+				return -EINVAL;	// round-trip check - text must parse back to the same value
+		}
+		else if (type == RpcArgumentType::STRING)
+		{
+			if (index >= length || index + 1 + request[index] > length)
+				return -EBADMSG;
+
+			const uint8_t string_length = request[index++];
+			argument_length = string_length;
+			if (string_length < space)
+			{
+				memcpy(argument, &request[index], string_length);
+				argument[string_length] = '\0';
+			}
+			index += string_length;
+		}
+		else
+			return -EBADMSG;
+
+		if (argument_length < 0 || static_cast<size_t>(argument_length) >= space)
+			return -ENOSPC;
+
+		arguments_array[i] = argument;
+		buffer_index += argument_length + 1;
+	}
+
+	if (index != length)	// trailing garbage?
+		return -EBADMSG;
+
+	if (definition->structuredHandler != nullptr)
+	{
+		format = RpcResponseFormat::STRUCTURED;
+		return definition->structuredHandler(arguments_array, arguments_count + 1, data, size);
+	}
+
+	format = RpcResponseFormat::TEXT;
+
+	FILE * const capture_stream = fmemopen(data, size, "w");
+	if (capture_stream == nullptr)
+		return -ENOMEM;
+
+	setvbuf(capture_stream, nullptr, _IONBF, 0);
+
+	int ret = definition->handler(arguments_array, arguments_count + 1, capture_stream);
+	const long captured_length = ftell(capture_stream);
+	fclose(capture_stream);
+
+	if (ret == 0)
+		ret = captured_length >= 0 ? captured_length : -EIO;
+
+	return ret;
+}
+
+/**
+ * \brief Sends framed response.
+ *
+ * \param [in] sequence is the sequence number copied from request
+ * \param [in] status is the status of execution - 0 on success, negated errno code otherwise
+ * \param [in] format is the format of response data
+ * \param [in] length is the length of response data already placed in responseBuffer_, bytes
+ * \param [out] output_stream is the stream used for output
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int sendResponse_(const uint8_t sequence, const int status, const RpcResponseFormat format, const size_t length,
+		FILE * const output_stream)
+{
+	responseBuffer_[0] = sequence;
+	responseBuffer_[1] = static_cast<uint16_t>(status);
+	responseBuffer_[2] = static_cast<uint16_t>(status) >> 8;
+	responseBuffer_[3] = static_cast<uint8_t>(format);
+
+	const size_t payload_length = responseHeaderSize_ + length;
+	const uint16_t crc = crc16_(responseBuffer_, payload_length);
+	responseBuffer_[payload_length] = crc;
+	responseBuffer_[payload_length + 1] = crc >> 8;
+
+	encodedBuffer_[0] = 0;	// leading delimiter
+	const size_t encoded_length = cobsEncode_(responseBuffer_, payload_length + crcSize_, &encodedBuffer_[1]);
+	encodedBuffer_[encoded_length + 1] = 0;	// trailing delimiter
+
+	const size_t frame_length = encoded_length + 2;
+	if (fwrite(encodedBuffer_, 1, frame_length, output_stream) != frame_length)
+		return -EIO;
+
+	return fflush(output_stream) == 0 ? 0 : -EIO;
+}
+
+}	// namespace
@@ -0,0 +1,63 @@
+/**
+ * \file rpc.hpp
+ * \brief Header for rpc.cpp
+ *
+ * Binary RPC shares transport with text command interpreter. Frame is delimited with 0x00 bytes on both sides, content
+ * of frame is COBS-encoded, so it contains no 0x00 bytes. Decoded frame is a payload followed by CRC16-CCITT
+ * (polynomial 0x1021, initial value 0xffff) of that payload, little-endian. All multi-byte values are little-endian.
+ *
+ * Request payload:
+ * - sequence number (u8),
+ * - length of command string (u8), command string (without terminating '\0'),
+ * - number of arguments (u8), for each argument: type (u8, RpcArgumentType) and value:
+ * 	- RpcArgumentType::UINT32 - u32, passed to handler as decimal string,
+ * 	- RpcArgumentType::UINT64 - u64, passed to handler as 16-digit hexadecimal string (like ZigBee addresses),
+ * 	- RpcArgumentType::STRING - length (u8) and string (without terminating '\0').
+ *
+ * Response payload:
+ * - sequence number copied from request (u8),
+ * - status - 0 on success, negated errno code otherwise (s16),
+ * - format of data (u8, RpcResponseFormat),
+ * - data - fixed-layout struct from CommandDefinition::structuredHandler or captured text output of
+ * CommandDefinition::handler.
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef RPC_HPP_
+#define RPC_HPP_
+
+#include <cstdint>
+#include <cstdio>
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global variables' types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// type of argument in RPC request
+enum class RpcArgumentType : uint8_t
+{
+	/// 32-bit unsigned integer
+	UINT32 = 1,
+	/// 64-bit unsigned integer
+	UINT64 = 2,
+	/// string
+	STRING = 3,
+};
+
+/// format of data in RPC response
+enum class RpcResponseFormat : uint8_t
+{
+	/// fixed-layout struct produced by structured handler
+	STRUCTURED = 0,
+	/// text output captured from handler
+	TEXT = 1,
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+int rpcProcessFrame(uint8_t * const frame, const size_t length, FILE * const output_stream);
+
+#endif	// RPC_HPP_
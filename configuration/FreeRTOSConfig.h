@@ -156,22 +156,10 @@ See http://www.FreeRTOS.org/RTOS-Cortex-M3-M4.html. */
 #define HEARTBEAT_TASK_PRIORITY				tskIDLE_PRIORITY
 #define HEARTBEAT_STACK_SIZE				256
 
-// USART TX task
-#define USART_TX_TASK_PRIORITY				(tskIDLE_PRIORITY + 1)
-#define USART_TX_STACK_SIZE					256
-
-// USART RX task
-#define USART_RX_TASK_PRIORITY				(tskIDLE_PRIORITY + 1)
-#define USART_RX_STACK_SIZE					256
-
 // i2c tasks
 #define I2C_TASK_PRIORITY					(tskIDLE_PRIORITY + 1)
 #define I2C_TASK_STACK_SIZE					128
 
-// SPI TX task
-#define SPI_TX_TASK_PRIORITY				(tskIDLE_PRIORITY + 1)
-#define SPI_TX_STACK_SIZE					128
-
 /// priority of console task
 enum { CONSOLE_TASK_PRIORITY = 1 };
 
@@ -190,6 +178,18 @@ enum { DATA_PRODUCER_TASK_PRIORITY = 1 };
 /// stack size of DataProducer task, words (4 bytes each)
 enum { DATA_PRODUCER_TASK_STACK_SIZE = 512 };
 
+/// priority of ZigBee benchmark responder task
+enum { ZB_BENCH_RESPONDER_TASK_PRIORITY = 1 };
+
+/// stack size of ZigBee benchmark responder task, words (4 bytes each)
+enum { ZB_BENCH_RESPONDER_TASK_STACK_SIZE = 256 };
+
+/// priority of storage service task - not higher than any task which submits requests to it
+enum { STORAGE_SERVICE_TASK_PRIORITY = 1 };
+
+/// stack size of storage service task, words (4 bytes each)
+enum { STORAGE_SERVICE_TASK_STACK_SIZE = 384 };
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | UARTs
 +---------------------------------------------------------------------------------------------------------------------*/
@@ -207,6 +207,33 @@ enum { UART_QUEUE_SIZE = 128 };
 /// default UART baudrate used when opening device
 enum { UART_STREAM_BAUDRATE = 19200 };
 
+/// how long blocking read from UART waits for data before returning end-of-file, milliseconds, 0 - wait forever
+enum { UART_READ_TIMEOUT_MS = 0 };
+
+/// number of static buffers (STREAM_BUFFER_SIZE bytes each) for UART streams opened with ioFopen(), streams opened
+/// when all are used get buffers from heap
+enum { UART_STREAM_BUFFERS_COUNT = 2 };
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| SD card files
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// maximum number of simultaneously opened files on SD card, each takes one FatFS file object (with sector buffer)
+enum { SD_FILES_MAX = 2 };
+
+/// size of buffer of streams of files on SD card, multiple of sector size - full buffers bypass FatFS buffers
+enum { SD_STREAM_BUFFER_SIZE = 512 };
+
+/// number of static buffers (SD_STREAM_BUFFER_SIZE bytes each) for SD card streams opened with ioFopen(), streams
+/// opened when all are used get buffers from heap
+enum { SD_STREAM_BUFFERS_COUNT = 1 };
+
+/// number of sectors in write-back cache between FatFS and SD card, FAT sectors are kept in preference to others
+enum { SD_CACHE_SECTORS = 2 };
+
+/// size of request queue of storage service (number of requests waiting for execution)
+enum { STORAGE_SERVICE_QUEUE_SIZE = 8 };
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | I/O syscalls
 +---------------------------------------------------------------------------------------------------------------------*/
@@ -214,13 +241,32 @@ enum { UART_STREAM_BAUDRATE = 19200 };
 /// how long should open and close block on mutex operations (in RTOS ticks)
 #define	STREAM_MUTEX_TICKS_TO_WAIT			portMAX_DELAY
 
+/// max number of tasks waiting in ioPoll() at the same time
+enum { IO_POLL_WAITERS_MAX = 4 };
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | console
 +---------------------------------------------------------------------------------------------------------------------*/
 
-/// size of input buffer for console task
+/// port number of UART used by console, the same as N in /dev/uartN
+enum { CONSOLE_UART_PORT = 0 };
+
+/// size of input buffer for console task, used for text lines and encoded binary RPC frames
 enum { CONSOLE_INPUT_BUFFER_SIZE = 128 };
 
+/// how long console task should wait before retrying read after end-of-file, milliseconds
+enum { CONSOLE_READ_RETRY_DELAY_MS = 10 };
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| binary RPC
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// max size of data in RPC response (structured response or captured text output), bytes
+enum { RPC_RESPONSE_DATA_SIZE_MAX = 256 };
+
+/// size of buffer for strings of arguments converted from binary RPC request (including command string)
+enum { RPC_ARGUMENTS_BUFFER_SIZE = 160 };
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | UART assert
 +---------------------------------------------------------------------------------------------------------------------*/
@@ -235,6 +281,22 @@ enum { UART_ASSERT_BAUDRATE = UART_STREAM_BAUDRATE };
 /// size of buffer for rx task of ETRX2 module
 enum { ETRX2_BUFFER_SIZE = 128 };
 
+/*---------------------------------------------------------------------------------------------------------------------+
+| ZigBee benchmark
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// max size of single benchmark message, bytes (limited by ETRX2 payload size)
+enum { ZB_BENCH_MESSAGE_SIZE_MAX = 64 };
+
+/// default size of single benchmark message, bytes
+enum { ZB_BENCH_MESSAGE_SIZE_DEFAULT = 16 };
+
+/// size of queues for received benchmark requests and replies (number of elements)
+enum { ZB_BENCH_QUEUE_SIZE = 4 };
+
+/// how long to wait for the reply from responder in round-trip mode, milliseconds
+enum { ZB_BENCH_REPLY_TIMEOUT_MS = 2000 };
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | streams
 +---------------------------------------------------------------------------------------------------------------------*/
@@ -242,6 +304,9 @@ enum { ETRX2_BUFFER_SIZE = 128 };
 /// size of buffer used for stdio streams
 enum { STREAM_BUFFER_SIZE = 128 };
 
+/// size of single chunk passed by OutputSink to transport, bytes - this is the only buffer used for command output
+enum { OUTPUT_SINK_CHUNK_SIZE = 64 };
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | DataConsumer
 +---------------------------------------------------------------------------------------------------------------------*/
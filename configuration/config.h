@@ -32,32 +32,45 @@
 | USART
 +---------------------------------------------------------------------------------------------------------------------*/
 
-#define USARTx								USART1
-
-#define USARTx_TX_GPIO						GPIOA
-#define USARTx_TX_PIN						GPIO_PIN9
-#define USARTx_TX_CONFIGURATION				GPIO_AF7_PP_40MHz_PULL_UP
-#define USARTx_RX_GPIO						GPIOA
-#define USARTx_RX_PIN						GPIO_PIN10
-#define USARTx_RX_CONFIGURATION				GPIO_AF7_PP_40MHz_PULL_UP
-
-#define RCC_APBxENR_USARTxEN_bb				RCC_APB2ENR_USART1EN_bb
-
-#define USARTx_BAUDRATE						115200
-
-#define RCC_AHBENR_DMAxEN_bb				RCC_AHBENR_DMA1EN_bb
-#define USARTx_DMAx_TX_CH					DMA1_Channel4
-#define USARTx_DMAx_TX_CH_IRQn				DMA1_Channel4_IRQn
-#define USARTx_DMAx_TX_CH_IRQHandler		DMA1_Channel4_IRQHandler
-#define USARTx_DMAx_TX_IFCR_CTCIFx_bb		DMA1_IFCR_CTCIF4_bb
-
-#define USARTx_RX_QUEUE_LENGTH				16
-#define USARTx_RX_QUEUE_BUFFER_LENGTH		16
-#define USARTx_TX_QUEUE_LENGTH				16
-#define USARTx_BUF_READ_QUEUE_LENGTH		16
-
-#define USARTx_IRQn							USART1_IRQn
-#define USARTx_IRQHandler					USART1_IRQHandler
+#define USART_PORT_COUNT					3		///< number of USART instances - USART1, USART2, USART3
+#define USART_DEBUG_PORT					0		///< port used by usart_low_level_put(), must be enabled
+#define USART_TX_PRINTF_LENGTH_MAX			128		///< size of TX ring region reserved by usartPrintf(), bytes
+
+// USART1 - port 0, /dev/uart0, DMA1 channels 4 (TX) and 5 (RX)
+#define USART1_ENABLED						1
+#define USART1_TX_GPIO						GPIOA
+#define USART1_TX_PIN						GPIO_PIN9
+#define USART1_RX_GPIO						GPIOA
+#define USART1_RX_PIN						GPIO_PIN10
+#define USART1_PIN_CONFIGURATION			GPIO_AF7_PP_40MHz_PULL_UP
+#define USART1_BAUDRATE						115200
+#define USART1_FLOW_CONTROL					1		///< 1 to enable hardware flow control (CTS and RTS)
+#define USART1_RX_RING_SIZE					256		///< size of RX ring buffer filled by circular DMA, bytes
+#define USART1_TX_RING_SIZE					512		///< size of TX ring buffer, bytes
+
+// USART2 - port 1, /dev/uart1, DMA1 channels 7 (TX) and 6 (RX)
+#define USART2_ENABLED						1
+#define USART2_TX_GPIO						GPIOA
+#define USART2_TX_PIN						GPIO_PIN2
+#define USART2_RX_GPIO						GPIOA
+#define USART2_RX_PIN						GPIO_PIN3
+#define USART2_PIN_CONFIGURATION			GPIO_AF7_PP_40MHz_PULL_UP
+#define USART2_BAUDRATE						115200
+#define USART2_FLOW_CONTROL					0		///< 1 to enable hardware flow control (CTS and RTS)
+#define USART2_RX_RING_SIZE					128		///< size of RX ring buffer filled by circular DMA, bytes
+#define USART2_TX_RING_SIZE					256		///< size of TX ring buffer, bytes
+
+// USART3 - port 2, /dev/uart2, DMA1 channels 2 (TX) and 3 (RX) - the same as SPI1 DMA, so it's disabled by default
+#define USART3_ENABLED						0
+#define USART3_TX_GPIO						GPIOB
+#define USART3_TX_PIN						GPIO_PIN10
+#define USART3_RX_GPIO						GPIOB
+#define USART3_RX_PIN						GPIO_PIN11
+#define USART3_PIN_CONFIGURATION			GPIO_AF7_PP_40MHz_PULL_UP
+#define USART3_BAUDRATE						115200
+#define USART3_FLOW_CONTROL					0		///< 1 to enable hardware flow control (CTS and RTS)
+#define USART3_RX_RING_SIZE					128		///< size of RX ring buffer filled by circular DMA, bytes
+#define USART3_TX_RING_SIZE					256		///< size of TX ring buffer, bytes
 
 /*---------------------------------------------------------------------------------------------------------------------+
 | SERIAL-UART
@@ -126,14 +139,16 @@
 #define SPIx_DMAx_TX_CH_IRQn				DMA1_Channel3_IRQn
 #define SPIx_DMAx_TX_CH_IRQHandler			DMA1_Channel3_IRQHandler
 #define SPIx_DMAx_TX_IFCR_CTCIFx_bb			DMA1_IFCR_CTCIF3_bb
+#define SPIx_DMAx_TX_IFCR_CGIFx_bb			DMA1_IFCR_CGIF3_bb
 #define SPIx_DMAx_RX_CH						DMA1_Channel2
 #define SPIx_DMAx_RX_CH_IRQn				DMA1_Channel2_IRQn
 #define SPIx_DMAx_RX_CH_IRQHandler			DMA1_Channel2_IRQHandler
 #define SPIx_DMAx_RX_IFCR_CTCIFx_bb			DMA1_IFCR_CTCIF2_bb
+#define SPIx_DMAx_RX_IFCR_CGIFx_bb			DMA1_IFCR_CGIF2_bb
+#define SPIx_DMAx_RX_ISR_TEIFx_bb			DMA1_ISR_TEIF2_bb
 
-#define SPIx_RX_QUEUE_LENGTH				16
-#define SPIx_RX_QUEUE_BUFFER_LENGTH			16
-#define SPIx_TX_QUEUE_LENGTH				16
+/// transfers of SPI bus transactions at least that long are done with DMA, shorter ones are polled
+#define SPI_BUS_DMA_LENGTH_THRESHOLD		16
 
 #define SPIx_IRQHandler						SPI1_IRQHandler
 
@@ -169,12 +184,16 @@
 
 #define COMMAND_ARGUMENT_LENGTH				32
 
+#define COMMAND_COUNT_MAX					32		///< max number of registered commands, including "help"
+#define COMMAND_ARGUMENTS_COUNT_MAX			16		///< max number of arguments of single command
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | interript priorities
 +---------------------------------------------------------------------------------------------------------------------*/
 
-#define USARTx_DMAx_TX_CH_IRQ_PRIORITY		10
-#define USARTx_IRQ_PRIORITY					10
+#define USART_DMA_TX_CH_IRQ_PRIORITY		10
+#define USART_DMA_RX_CH_IRQ_PRIORITY		10
+#define USART_IRQ_PRIORITY					10
 #define TIM6_IRQ_PRIORITY					10
 #define SPIx_DMAx_TX_CH_IRQ_PRIORITY		10
 #define SPIx_DMAx_RX_CH_IRQ_PRIORITY		10
@@ -78,6 +78,13 @@ enum Error
 	ERROR_MAINBUSS_DATA_NOT_READY,
 	ERROR_MAINBUSS_BUS_CORRUPTION,
 
+	// --- USART errors ---
+	ERROR_USART_PORT_NOT_AVAILABLE,
+
+	// --- SPI errors ---
+	ERROR_SPI_TIMEOUT,
+	ERROR_SPI_TRANSFER_FAILED,
+
 	// --- END OF PERIPHERALS
 
 	// --- positive values ---
@@ -13,11 +13,13 @@
 
 #include "io_syscalls.h"
 #include "sys_fd.h"
+#include "sys_sd.h"
 #include "usart.h"
 
 #include "config.h"
 
 #include "FreeRTOS.h"
+#include "task.h"
 #include "semphr.h"
 
 #include <stdio.h>
@@ -34,18 +36,19 @@
 #define IO_SYSCALLS_HAVE_EXECVE_R_		0
 #define IO_SYSCALLS_HAVE_EXIT_			0
 #define IO_SYSCALLS_HAVE_FORK_R_		0
-#define IO_SYSCALLS_HAVE_FSTAT_R_		0
+#define IO_SYSCALLS_HAVE_FSTAT_R_			1
 #define IO_SYSCALLS_HAVE_GETPID_R_		0
-#define IO_SYSCALLS_HAVE_ISATTY_R_		0
+#define IO_SYSCALLS_HAVE_ISATTY_R_			1
 #define IO_SYSCALLS_HAVE_KILL_R_		0
 #define IO_SYSCALLS_HAVE_LINK_R_		0
-#define IO_SYSCALLS_HAVE_LSEEK_R_		0
+#define IO_SYSCALLS_HAVE_LSEEK_R_			1
 #define IO_SYSCALLS_HAVE_OPEN_R_			1
+#define IO_SYSCALLS_HAVE_POLL_				1
 #define IO_SYSCALLS_HAVE_READ_R_			1
 #define IO_SYSCALLS_HAVE_SBRK_R_		0
 #define IO_SYSCALLS_HAVE_STAT_R_		0
 #define IO_SYSCALLS_HAVE_TIMES_R_		0
-#define IO_SYSCALLS_HAVE_UNLINK_R_		0
+#define IO_SYSCALLS_HAVE_UNLINK_R_			1
 #define IO_SYSCALLS_HAVE_WAIT_R_		0
 #define IO_SYSCALLS_HAVE_WRITE_R_			1
 
@@ -85,6 +88,12 @@
 #	define SET_OPEN_R_(f)
 #endif
 
+#if IO_SYSCALLS_HAVE_POLL_ == 1
+#	define SET_POLL_(f)						._poll = f,
+#else
+#	define SET_POLL_(f)
+#endif
+
 #if IO_SYSCALLS_HAVE_READ_R_ == 1
 #	define SET_READ_R_(f)					._read_r = f,
 #else
@@ -110,19 +119,58 @@
 #endif
 
 /// macro used to setup entries in _drivers[] and for 3 standard *_driver
-#define SET_DRIVER_(filename, close, fstat, isatty, link, lseek, open, read, stat, unlink, write)				\
-	{filename, SET_CLOSE_R_(close) SET_FSTAT_R_(fstat) SET_ISATTY_R_(isatty) SET_LINK_R_(link)			\
-	SET_LSEEK_R_(lseek) SET_OPEN_R_(open) SET_READ_R_(read) SET_STAT_R_(stat) SET_UNLINK_R_(unlink) SET_WRITE_R_(write)}
+#define SET_DRIVER_(filename, buffering, close, fstat, isatty, link, lseek, open, poll, read, stat, unlink, write)	\
+	{filename, buffering, SET_CLOSE_R_(close) SET_FSTAT_R_(fstat) SET_ISATTY_R_(isatty) SET_LINK_R_(link)		\
+	SET_LSEEK_R_(lseek) SET_OPEN_R_(open) SET_POLL_(poll) SET_READ_R_(read) SET_STAT_R_(stat) SET_UNLINK_R_(unlink)	\
+	SET_WRITE_R_(write)}
+
+#if FOPEN_MAX > 32
+#	error "FOPEN_MAX must not exceed 32 - free file descriptors are tracked in uint32_t bitmask!"
+#endif
+
+/// initial bitmask of free file descriptors - all except 0, 1 and 2, which are always open
+#define FREE_FILEDESES_INITIAL_				((UINT32_MAX >> (32 - FOPEN_MAX)) & ~UINT32_C(7))
+
+/// index of "/dev/null" driver in drivers_[]
+#define NULL_DRIVER_INDEX_					0
+
+/// index of "/dev/uart" driver in drivers_[]
+#define UART_DRIVER_INDEX_					1
+
+/// index of "/sd/" driver in drivers_[]
+#define SD_DRIVER_INDEX_					2
 
 /*---------------------------------------------------------------------------------------------------------------------+
 | local variables' types
 +---------------------------------------------------------------------------------------------------------------------*/
 
+/// buffering policy of streams opened with ioFopen()
+struct Buffering_
+{
+	/// mode of buffering - _IOFBF, _IOLBF or _IONBF
+	int mode;
+
+	/// size of buffer, also reported by fstat() as st_blksize
+	size_t size;
+
+	/// pool of count static buffers, each size bytes long, NULL if buffers are always allocated from heap
+	char *buffers;
+
+	/// number of buffers in pool, at most 32
+	uint8_t count;
+
+	/// bitmask of buffers from pool which are used by opened streams, guarded by mutex_
+	uint32_t used;
+};
+
 /// describes an I/O driver
 struct Driver_
 {
 	const char *filename;
 
+	/// buffering policy of streams, NULL if default buffering of newlib should be used
+	struct Buffering_ *buffering;
+
 #if IO_SYSCALLS_HAVE_CLOSE_R_ == 1
 	int (*_close_r)(struct _reent *r, int filedes);
 #endif
@@ -147,6 +195,10 @@ struct Driver_
 	int (*_open_r)(struct _reent *r, const char *filename, int flags, int mode);
 #endif
 
+#if IO_SYSCALLS_HAVE_POLL_ == 1
+	int (*_poll)(int filedes, int events);
+#endif
+
 #if IO_SYSCALLS_HAVE_READ_R_ == 1
 	ssize_t (*_read_r)(struct _reent *r, int filedes, void *buffer, size_t size);
 #endif
@@ -169,44 +221,82 @@ struct OpenedFiledes_
 {
 	const struct Driver_ *driver;
 	int privateFiledes;
+
+	/// static buffer from pool of driver used by stream of this file descriptor, NULL if none
+	char *staticBuffer;
 };
 
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+static const struct Driver_ * findDriver_(const char *filename);
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | local variables
 +---------------------------------------------------------------------------------------------------------------------*/
 
+/// pool of static buffers for UART streams
+static char uartStreamBuffers_[UART_STREAM_BUFFERS_COUNT][STREAM_BUFFER_SIZE];
+
+/// buffering policy of UART streams - line buffering flushes prompts and responses as soon as they are complete
+static struct Buffering_ uartBuffering_ =
+		{_IOLBF, STREAM_BUFFER_SIZE, &uartStreamBuffers_[0][0], UART_STREAM_BUFFERS_COUNT, 0};
+
+/// pool of static buffers for streams of files on SD card
+static char sdStreamBuffers_[SD_STREAM_BUFFERS_COUNT][SD_STREAM_BUFFER_SIZE];
+
+/// buffering policy of streams of files on SD card - full buffering with sector-sized buffers
+static struct Buffering_ sdBuffering_ =
+		{_IOFBF, SD_STREAM_BUFFER_SIZE, &sdStreamBuffers_[0][0], SD_STREAM_BUFFERS_COUNT, 0};
+
 /// table with all supported I/O drivers
 static const struct Driver_ drivers_[] =
 {
-		// filename, _close_r, _fstat_r, _isatty_t, _link_r, _lseek_r, _open_r, _read_r, _stat_r, _unlink_r, _write_r
-		SET_DRIVER_("/dev/null", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL),
-		SET_DRIVER_("/dev/uart", NULL, NULL, NULL, NULL, NULL, &uart_open_r, &uart_read_r, NULL, NULL, &uart_write_r),
+		// filename, buffering, _close_r, _fstat_r, _isatty_r, _link_r, _lseek_r, _open_r, _poll, _read_r, _stat_r,
+		// _unlink_r, _write_r
+		[NULL_DRIVER_INDEX_] = SET_DRIVER_("/dev/null", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+				NULL),
+		[UART_DRIVER_INDEX_] = SET_DRIVER_("/dev/uart", &uartBuffering_, NULL, NULL, &uart_isatty_r, NULL, NULL,
+				&uart_open_r, &uart_poll, &uart_read_r, NULL, NULL, &uart_write_r),
+		[SD_DRIVER_INDEX_] = SET_DRIVER_("/sd/", &sdBuffering_, &sd_close_r, &sd_fstat_r, NULL, NULL, &sd_lseek_r,
+				&sd_open_r, NULL, &sd_read_r, NULL, &sd_unlink_r, &sd_write_r),
 };
 
 /// standard input
 static const struct Driver_ stdinDriver_ =
-		SET_DRIVER_("stdin", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+		SET_DRIVER_("stdin", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
 /// standard output
 static const struct Driver_ stdoutDriver_ =
-		SET_DRIVER_("stdout", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+		SET_DRIVER_("stdout", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
 /// standard error
 static const struct Driver_ stderrDriver_ =
-		SET_DRIVER_("stderr", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+		SET_DRIVER_("stderr", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
 
-/// table which holds all currently open file descriptors
+/// table which holds all currently open file descriptors, indexed directly with file descriptor
 static struct OpenedFiledes_ openedFiledeses_[FOPEN_MAX] =
 {
-		{&stdinDriver_, 0},		// 0
-		{&stdoutDriver_, 0},	// 1
-		{&stderrDriver_, 0},	// 2
+		{&stdinDriver_, 0, NULL},	// 0
+		{&stdoutDriver_, 0, NULL},	// 1
+		{&stderrDriver_, 0, NULL},	// 2
 };
 
-/// holds the number of opened file descriptors
-static uint8_t totalOpenedFiledeses_ = 3;
+/// bitmask of free indexes in openedFiledeses_[], the lowest set bit is the next file descriptor
+static uint32_t freeFiledeses_ = FREE_FILEDESES_INITIAL_;
 
-/// mutex for guarding openedFiledeses_[] and totalOpenedFiledeses_
+/// mutex for guarding openedFiledeses_[], freeFiledeses_ and used buffers of drivers
 static xSemaphoreHandle mutex_;
 
+#if IO_SYSCALLS_HAVE_POLL_ == 1
+
+/// semaphores of tasks waiting in ioPoll(), given by ioSyscallsNotifyFromISR()
+static xSemaphoreHandle pollSemaphores_[IO_POLL_WAITERS_MAX];
+
+/// bitmask of pollSemaphores_[] used by waiting tasks
+static volatile uint32_t pollWaiters_;
+
+#endif
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | global functions
 +---------------------------------------------------------------------------------------------------------------------*/
@@ -226,9 +316,168 @@ int ioSyscallsInitialize(void)
 	if (mutex_ == NULL)
 		ret = -ENOMEM;
 
+#if IO_SYSCALLS_HAVE_POLL_ == 1
+
+	for (size_t i = 0; ret == 0 && i < IO_POLL_WAITERS_MAX; i++)
+	{
+		vSemaphoreCreateBinary(pollSemaphores_[i]);
+		if (pollSemaphores_[i] == NULL)
+			ret = -ENOMEM;
+	}
+
+#endif
+
 	return ret;
 }
 
+/**
+ * \brief Opens a stream with buffering policy of the device.
+ *
+ * Works like fopen(), but buffering mode and size of the stream are taken from the driver. If the driver has a pool of
+ * static buffers and one of them is free, it is used for the stream, so no heap is needed - the buffer returns to the
+ * pool when the file descriptor is closed. Otherwise newlib allocates the buffer of declared size from heap.
+ *
+ * \param [in] filename is the name of the file to open
+ * \param [in] mode is the mode of the stream, same as for fopen()
+ *
+ * \return pointer to opened stream on success, NULL otherwise (errno set by fopen())
+ */
+
+FILE * ioFopen(const char * const filename, const char * const mode)
+{
+	FILE * const stream = fopen(filename, mode);
+	if (stream == NULL)
+		return NULL;
+
+	const int filedes = fileno(stream);
+	struct Buffering_ * const buffering = openedFiledeses_[filedes].driver->buffering;
+	if (buffering == NULL)	// no policy - leave default buffering of newlib
+		return stream;
+
+	char *buffer = NULL;
+
+	if (buffering->mode != _IONBF && buffering->count != 0 &&
+			xSemaphoreTake(mutex_, STREAM_MUTEX_TICKS_TO_WAIT) == pdTRUE)
+	{
+		const uint32_t free_buffers = ~buffering->used & (UINT32_MAX >> (32 - buffering->count));
+
+		if (free_buffers != 0)
+		{
+			const size_t index = __builtin_ctz(free_buffers);
+			buffering->used |= 1 << index;
+			buffer = &buffering->buffers[index * buffering->size];
+			openedFiledeses_[filedes].staticBuffer = buffer;
+		}
+
+		xSemaphoreGive(mutex_);
+	}
+
+	// without static buffer newlib allocates buffer of declared size from heap
+	setvbuf(stream, buffer, buffering->mode, buffering->size);
+	return stream;
+}
+
+#if IO_SYSCALLS_HAVE_POLL_ == 1
+
+/**
+ * \brief Waits until any of file descriptors is ready.
+ *
+ * Single task can wait for several devices, instead of having one blocking task per device. Readiness is checked with
+ * _poll function of driver - file descriptors of drivers without it are always ready. Drivers call
+ * ioSyscallsNotifyFromISR() when their state changes, so waiting is not done by polling.
+ *
+ * Readiness refers to file descriptors - data already buffered in stdio streams is not taken into account, so streams
+ * used with this function should be unbuffered.
+ *
+ * \param [in,out] descriptors is the array with watched file descriptors, revents of each element is set
+ * \param [in] count is the number of elements in descriptors array
+ * \param [in] ticks_to_wait is the amount of time the call should block while waiting for readiness, use
+ * portMAX_DELAY to suspend
+ *
+ * \return -1 for failure, 0 if timeout expired or number of descriptors with non-zero revents for success
+ */
+
+int ioPoll(struct IoPollDescriptor * const descriptors, const size_t count, const portTickType ticks_to_wait)
+{
+	size_t slot = 0;
+
+	// register as waiter before checking readiness, so that no notification is lost
+	taskENTER_CRITICAL();
+	while (slot < IO_POLL_WAITERS_MAX && (pollWaiters_ & (1 << slot)) != 0)
+		slot++;
+	if (slot < IO_POLL_WAITERS_MAX)
+		pollWaiters_ |= 1 << slot;
+	taskEXIT_CRITICAL();
+
+	if (slot == IO_POLL_WAITERS_MAX)	// too many waiting tasks?
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+
+	xSemaphoreTake(pollSemaphores_[slot], 0);	// discard stale notification
+
+	const portTickType start = xTaskGetTickCount();
+	int ready;
+
+	while (1)
+	{
+		ready = 0;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			struct IoPollDescriptor * const descriptor = &descriptors[i];
+			const int filedes = descriptor->filedes;
+			const int events = descriptor->events & (IO_POLL_IN | IO_POLL_OUT);
+
+			if (filedes < 0 || filedes >= FOPEN_MAX || openedFiledeses_[filedes].driver == NULL)
+				descriptor->revents = IO_POLL_NVAL;
+			else if (openedFiledeses_[filedes].driver->_poll == NULL)	// no "poll" function - always ready
+				descriptor->revents = events;
+			else
+				descriptor->revents = openedFiledeses_[filedes].driver->_poll(
+						openedFiledeses_[filedes].privateFiledes, events) & events;
+
+			if (descriptor->revents != 0)
+				ready++;
+		}
+
+		if (ready != 0)
+			break;
+
+		const portTickType elapsed = xTaskGetTickCount() - start;
+
+		if (elapsed >= ticks_to_wait || xSemaphoreTake(pollSemaphores_[slot], ticks_to_wait - elapsed) != pdTRUE)
+			break;
+	}
+
+	taskENTER_CRITICAL();
+	pollWaiters_ &= ~(1 << slot);
+	taskEXIT_CRITICAL();
+
+	return ready;
+}
+
+/**
+ * \brief Notifies tasks waiting in ioPoll() that state of some device has changed.
+ *
+ * Called by drivers from interrupts, when data is received or space for writing is freed.
+ *
+ * \param [out] higher_priority_task_woken is a pointer to variable which will be set to pdTRUE if notification
+ * unblocked a task with higher priority
+ */
+
+void ioSyscallsNotifyFromISR(portBASE_TYPE * const higher_priority_task_woken)
+{
+	const uint32_t waiters = pollWaiters_;
+
+	for (size_t i = 0; i < IO_POLL_WAITERS_MAX; i++)
+		if ((waiters & (1 << i)) != 0)
+			xSemaphoreGiveFromISR(pollSemaphores_[i], higher_priority_task_woken);
+}
+
+#endif
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | global functions - I/O syscalls
 +---------------------------------------------------------------------------------------------------------------------*/
@@ -245,6 +494,12 @@ int ioSyscallsInitialize(void)
 
 int _close_r(struct _reent * const r, const int filedes)
 {
+	if (filedes < 0 || filedes >= FOPEN_MAX)
+	{
+		errno = EBADF;	// "The filedes argument is not a valid file descriptor."
+		return -1;
+	}
+
 	if (xSemaphoreTake(mutex_, STREAM_MUTEX_TICKS_TO_WAIT) == pdFALSE)
 	{
 		errno = ENOTRECOVERABLE;
@@ -252,8 +507,20 @@ int _close_r(struct _reent * const r, const int filedes)
 	}
 
 	struct OpenedFiledes_ opened_filedes = openedFiledeses_[filedes];	// save current filedes configuration locally
-	openedFiledeses_[filedes].driver = NULL;	// delete filedes configuration from table
-	totalOpenedFiledeses_--;
+
+	if (opened_filedes.driver != NULL)
+	{
+		openedFiledeses_[filedes].driver = NULL;	// delete filedes configuration from table
+		openedFiledeses_[filedes].staticBuffer = NULL;
+		freeFiledeses_ |= 1 << filedes;
+
+		if (opened_filedes.staticBuffer != NULL)	// return static buffer of the stream to the pool
+		{
+			struct Buffering_ * const buffering = opened_filedes.driver->buffering;
+			const size_t index = (opened_filedes.staticBuffer - buffering->buffers) / buffering->size;
+			buffering->used &= ~(1 << index);
+		}
+	}
 
 	if (xSemaphoreGive(mutex_) == pdFALSE)
 	{
@@ -292,14 +559,20 @@ int _close_r(struct _reent * const r, const int filedes)
 
 int _fstat_r(struct _reent * const r, const int filedes, struct stat * const buf)
 {
-	if (openedFiledeses_[filedes].driver != NULL)	// is such file descriptor opened?
+	// is such file descriptor opened?
+	if (filedes >= 0 && filedes < FOPEN_MAX && openedFiledeses_[filedes].driver != NULL)
 	{
 		if (openedFiledeses_[filedes].driver->_fstat_r != NULL)	// does it have "fstat" function?
 			// yes - execute
 			return openedFiledeses_[filedes].driver->_fstat_r(r, openedFiledeses_[filedes].privateFiledes, buf);
 		else
 		{
+			const struct Buffering_ * const buffering = openedFiledeses_[filedes].driver->buffering;
+
+			memset(buf, 0, sizeof(*buf));
 			buf->st_mode = S_IFCHR;	// it's a character-oriented device file
+			// newlib uses st_blksize as the size of buffer allocated for the stream
+			buf->st_blksize = buffering != NULL ? buffering->size : 0;
 			return 0;
 		}
 	}
@@ -312,6 +585,41 @@ int _fstat_r(struct _reent * const r, const int filedes, struct stat * const buf
 
 #endif
 
+#if IO_SYSCALLS_HAVE_ISATTY_R_ == 1
+
+/**
+ * \brief Query whether file descriptor is a terminal.
+ *
+ * newlib uses line buffering for streams of terminals.
+ *
+ * \param [in] filedes is the file descriptor to check.
+ *
+ * \return 1 if file descriptor is a terminal, 0 otherwise
+ */
+
+int _isatty_r(struct _reent * const r, const int filedes)
+{
+	// is such file descriptor opened?
+	if (filedes >= 0 && filedes < FOPEN_MAX && openedFiledeses_[filedes].driver != NULL)
+	{
+		if (openedFiledeses_[filedes].driver->_isatty_r != NULL)	// does it have "isatty" function?
+			// yes - execute
+			return openedFiledeses_[filedes].driver->_isatty_r(r, openedFiledeses_[filedes].privateFiledes);
+		else
+		{
+			errno = ENOTTY;	// "The filedes is not associated with a terminal device."
+			return 0;
+		}
+	}
+	else
+	{
+		errno = EBADF;	// "The filedes is not a valid file descriptor."
+		return 0;
+	}
+}
+
+#endif
+
 #if IO_SYSCALLS_HAVE_LINK_R_ == 1
 
 /**
@@ -327,21 +635,17 @@ int _link_r(struct _reent * const r, const char * const oldname, const char * co
 {
 	(void)r;	// suppress warning
 
-	// search for "oldname" in _drivers[]
-	size_t i = 0;
-	while ((i < sizeof(drivers_) / sizeof(drivers_[0])) &&
-			(strncmp(oldname, drivers_[i].filename, strlen(drivers_[i].filename)) != 0))
-		i++;
+	const struct Driver_ * const driver = findDriver_(oldname);
 
-	if (i == sizeof(drivers_) / sizeof(drivers_[0]))	// nothing found?
+	if (driver == NULL)	// nothing found?
 	{
 		errno = ENOENT;	// "The named file does not exist"
 		return -1;
 	}
 	else
 	{
-		if (drivers_[i]._link_r != NULL)
-			return drivers_[i]._link_r(r, oldname, newname);
+		if (driver->_link_r != NULL)
+			return driver->_link_r(r, oldname, newname);
 		else
 		{
 			errno = EACCES;
@@ -402,46 +706,43 @@ off_t _lseek_r(struct _reent * const r, const int filedes, const off_t offset, c
 
 int _open_r(struct _reent * const r, const char * const filename, const int flags, const int mode)
 {
+	const struct Driver_ * const driver = findDriver_(filename);
+
+	if (driver == NULL)	// nothing found?
+	{
+		errno = ENOENT;	// "The named file does not exist, and O_CREAT is not specified."
+		return -1;
+	}
+
 	if (xSemaphoreTake(mutex_, STREAM_MUTEX_TICKS_TO_WAIT) == pdFALSE)
 	{
 		errno = ENOTRECOVERABLE;
 		return -1;
 	}
 
-	int ret = 0;
+	int filedes = -1;
 
-	if (totalOpenedFiledeses_ >= FOPEN_MAX)
-	{
+	if (freeFiledeses_ == 0)
 		errno = EMFILE;	// "The process has too many files open."
-		ret = -1;
-	}
 	else
-		totalOpenedFiledeses_++;
+	{
+		filedes = __builtin_ctz(freeFiledeses_);	// the lowest free file descriptor, reserved until open completes
+		freeFiledeses_ &= ~(1 << filedes);
+	}
 
 	if (xSemaphoreGive(mutex_) == pdFALSE)
 	{
 		errno = ENOTRECOVERABLE;
-		ret = -1;
+		return -1;
 	}
 
-	if (ret == -1)
-		return ret;
-
-	// search for "filename" in _drivers[]
-	size_t i = 0;
-	while ((i < sizeof(drivers_) / sizeof(drivers_[0])) &&
-			(strncmp(filename, drivers_[i].filename, strlen(drivers_[i].filename)) != 0))
-		i++;
+	if (filedes == -1)
+		return -1;
 
-	if (i == sizeof(drivers_) / sizeof(drivers_[0]))	// nothing found?
-	{
-		errno = ENOENT;	// "The named file does not exist, and O_CREAT is not specified."
-		ret = -1;
-	}
+	int ret = 0;
 
-	if (ret != -1)
-		if (drivers_[i]._open_r != NULL)	// is there an "open" function?
-			ret = drivers_[i]._open_r(r, filename, flags, mode);	// try executing it
+	if (driver->_open_r != NULL)	// is there an "open" function?
+		ret = driver->_open_r(r, filename, flags, mode);	// try executing it
 
 	if (xSemaphoreTake(mutex_, STREAM_MUTEX_TICKS_TO_WAIT) == pdFALSE)
 	{
@@ -449,20 +750,15 @@ int _open_r(struct _reent * const r, const char * const filename, const int flag
 		return -1;
 	}
 
-	// search for free index in openedFiledeses_[] - the search cannot fail, as totalOpenedFiledeses_ was updated before
-	size_t j = 3;	// start with 3, as 0, 1 and 2 are always open
-	while ((j < sizeof(openedFiledeses_) / sizeof(openedFiledeses_[0])) &&
-			(openedFiledeses_[j].driver != NULL))
-		j++;
-
 	if (ret != -1)	// open succeeded?
 	{
-		openedFiledeses_[j].driver = &drivers_[i];	// assign opened file descriptor to free index in openedFiledeses_[]
-		openedFiledeses_[j].privateFiledes = ret;
-		ret = j;	// success - return file descriptor
+		openedFiledeses_[filedes].privateFiledes = ret;
+		openedFiledeses_[filedes].staticBuffer = NULL;
+		openedFiledeses_[filedes].driver = driver;	// assign opened file descriptor to reserved index
+		ret = filedes;	// success - return file descriptor
 	}
 	else
-		totalOpenedFiledeses_--;	// on fail - decrement number of open files
+		freeFiledeses_ |= 1 << filedes;	// on fail - release reserved file descriptor
 
 	if (xSemaphoreGive(mutex_) == pdFALSE)
 	{
@@ -517,21 +813,17 @@ int _stat_r(struct _reent * const r, const char * const filename, struct stat *
 {
 	(void)r;	// suppress warning
 
-	// search for "filename" in _drivers[]
-	size_t i = 0;
-	while ((i < sizeof(drivers_) / sizeof(drivers_[0])) &&
-			(strncmp(filename, drivers_[i].filename, strlen(drivers_[i].filename)) != 0))
-		i++;
+	const struct Driver_ * const driver = findDriver_(filename);
 
-	if (i == sizeof(drivers_) / sizeof(drivers_[0]))	// nothing found?
+	if (driver == NULL)	// nothing found?
 	{
 		errno = ENOENT;	// "The named file does not exist"
 		return -1;
 	}
 	else
 	{
-		if (drivers_[i]._stat_r)
-			return drivers_[i]._stat_r(r, filename, buf);
+		if (driver->_stat_r)
+			return driver->_stat_r(r, filename, buf);
 		else
 		{
 			buf->st_mode = S_IFCHR;
@@ -556,21 +848,17 @@ int _unlink_r(struct _reent * const r, const char * const filename)
 {
 	(void)r;	// suppress warning
 
-	// search for "filename" in _drivers[]
-	size_t i = 0;
-	while ((i < sizeof(drivers_) / sizeof(drivers_[0])) &&
-			(strncmp(filename, drivers_[i].filename, strlen(drivers_[i].filename)) != 0))
-		i++;
+	const struct Driver_ * const driver = findDriver_(filename);
 
-	if (i == sizeof(drivers_) / sizeof(drivers_[0]))	// nothing found?
+	if (driver == NULL)	// nothing found?
 	{
 		errno = ENOENT;	// "The named file does not exist"
 		return -1;
 	}
 	else
 	{
-		if (drivers_[i]._unlink_r)
-			return drivers_[i]._unlink_r(r, filename);
+		if (driver->_unlink_r)
+			return driver->_unlink_r(r, filename);
 		else
 		{
 			errno = EACCES;
@@ -607,3 +895,36 @@ ssize_t _write_r(struct _reent * const r, const int filedes, const void * const
 }
 
 #endif
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Finds driver of the file.
+ *
+ * Prefixes of drivers differ at fixed positions - "/dev/..." or "/sd/" at the second character, "/dev/null" or
+ * "/dev/uart" at the sixth - so the driver is selected directly and only its prefix is compared, instead of scanning
+ * drivers_[] with a comparison of each prefix.
+ *
+ * \param [in] filename is the name of the file
+ *
+ * \return pointer to driver of the file, NULL if there's no such driver
+ */
+
+static const struct Driver_ * findDriver_(const char * const filename)
+{
+	size_t index;
+
+	if (filename[0] == '/' && filename[1] == 's')
+		index = SD_DRIVER_INDEX_;
+	else if (strncmp(filename, "/dev/", 5) == 0 && filename[5] == 'u')
+		index = UART_DRIVER_INDEX_;
+	else if (strncmp(filename, "/dev/", 5) == 0 && filename[5] == 'n')
+		index = NULL_DRIVER_INDEX_;
+	else
+		return NULL;
+
+	const struct Driver_ * const driver = &drivers_[index];
+	return strncmp(filename, driver->filename, strlen(driver->filename)) == 0 ? driver : NULL;
+}
@@ -10,6 +10,40 @@
 #ifndef SYS_IO_SYSCALLS_H_
 #define SYS_IO_SYSCALLS_H_
 
+#include "FreeRTOS.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global defines
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// data can be read without blocking
+#define IO_POLL_IN							(1 << 0)
+/// data can be written without blocking
+#define IO_POLL_OUT							(1 << 1)
+/// file descriptor is not open, only returned in revents
+#define IO_POLL_NVAL						(1 << 2)
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// file descriptor watched by ioPoll()
+struct IoPollDescriptor
+{
+	/// file descriptor
+	int filedes;
+
+	/// requested events - bitwise OR of IO_POLL_IN and IO_POLL_OUT
+	uint8_t events;
+
+	/// returned events - subset of requested events which are ready, IO_POLL_NVAL for invalid file descriptor
+	uint8_t revents;
+};
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | global functions' declarations
 +---------------------------------------------------------------------------------------------------------------------*/
@@ -20,6 +54,9 @@ extern "C"
 #endif	// __cplusplus
 
 int ioSyscallsInitialize(void);
+FILE * ioFopen(const char *filename, const char *mode);
+int ioPoll(struct IoPollDescriptor *descriptors, size_t count, portTickType ticks_to_wait);
+void ioSyscallsNotifyFromISR(portBASE_TYPE *higher_priority_task_woken);
 
 #ifdef __cplusplus
 }	// extern "C"
@@ -23,16 +23,22 @@
 
 /* Private variables ---------------------------------------------------------*/
 #include "command.hpp"
+#include "console.hpp"
 #include "etrx2.hpp"
 #include "etrx2_cli.hpp"
 #include "data_producer.hpp"
+#include "output_sink.hpp"
 #include "usart.h"
+#include "usart_cli.hpp"
+#include "mmc_cli.hpp"
+#include "storage_service.h"
 
 #include <new>
 
 #include <cstdio>
 #include <cstring>
 #include <cassert>
+#include <cerrno>
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -56,10 +62,14 @@ static void _startPLL(void);
 
 static void _heartbeatTask(void *parameters);
 static enum Error _initializeHeartbeatTask(void);
+static int _consoleWrite(const char *data, size_t length);
 
-//FILE *  uart1_rx;
+FILE *  uart1_rx;
 FILE *  uart1_tx;
 
+/// sink for console output - streams command output to USART in chunks
+static OutputSink _consoleOutputSink(_consoleWrite);
+
 //extern const usart_driver_t usart1_handler;
 //extern const usart_def_t usart1_t;
 
@@ -74,11 +84,15 @@ int main(void)
 
 //  usart_initialize(&usart1_t, &usart1_handler);
 
-	uart1_tx = fopen("/dev/uart0", "w");
-	setvbuf(uart1_tx, nullptr, _IOFBF, STREAM_BUFFER_SIZE);
-//
-//	uart1_rx = fopen("/dev/uart0", "r");
-//	setvbuf(uart1_rx, nullptr, _IOLBF, STREAM_BUFFER_SIZE);
+	// console task is the only writer of /dev/uart0 - RPC response frames are sent in several chunks, output of any
+	// other task could land between them, so heartbeat goes to /dev/uart1
+	uart1_tx = ioFopen("/dev/uart1", "w");
+	uart1_rx = ioFopen("/dev/uart0", "r");
+
+	consoleInitialize(uart1_rx, _consoleOutputSink.open());
+	usartCliInitialize();
+	mmcCliInitialize();
+	storageServiceInitialize();
 
   _initializeHeartbeatTask();
 
@@ -108,7 +122,7 @@ static void _heartbeatTask(void *parameters)
 		size_t i = strlen(x);
 
 //		usart1_handler.write(&usart1_handler, portMAX_DELAY, x);
-        fwrite(x, sizeof(x[0]), sizeof(x)/sizeof(x[0]), uart1_tx);
+        fwrite(x, sizeof(x[0]), i, uart1_tx);	// without terminating '\0' - uart_write_r is binary-safe
 		fflush(uart1_tx);
 		buffer[0] = i;
 		vTaskDelay(40/portTICK_RATE_MS);	//Then go sleep
@@ -116,6 +130,23 @@ static void _heartbeatTask(void *parameters)
 
 }
 
+/**
+ * \brief Write function of console's OutputSink.
+ *
+ * Blocks until USART accepts the whole chunk. No other task may write to CONSOLE_UART_PORT, otherwise its output could
+ * be interleaved with chunks of RPC response frame.
+ *
+ * \param [in] data is a pointer to chunk
+ * \param [in] length is the length of chunk, bytes
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+static int _consoleWrite(const char *data, size_t length)
+{
+	return usartSendBytes(CONSOLE_UART_PORT, data, length, portMAX_DELAY) == ERROR_NONE ? 0 : -EIO;
+}
+
 static enum Error _initializeHeartbeatTask(void)
 {
 	portBASE_TYPE ret = xTaskCreate(_heartbeatTask, (signed char*)"heartbeat", 256, NULL,
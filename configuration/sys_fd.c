@@ -15,40 +15,33 @@
 #include <sys/stat.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
 
 
 #include "sys_fd.h"
+#include "io_syscalls.h"
 #include "bsp.h"
 #include "usart.h"
+#include "config.h"
 
-
-//#include <cstring>
-//#include <fcntl.h>
+#include "FreeRTOS.h"
 
 /*---------------------------------------------------------------------------------------------------------------------+
-| local variables
+| local defines
 +---------------------------------------------------------------------------------------------------------------------*/
 
-// object for UART0
-
-// object for UART1
-//extern const usart_driver_t usart1_handler;
-//extern const usart_def_t usart1_t;
+/// bit of private file descriptor set when device was opened with O_NONBLOCK
+#define UART_FILE_DESCRIPTOR_NONBLOCK_		(1 << 8)
 
-/// array with available UARTs
-uint32_t *uarts_[] =
-{
-		0,
-};
+/// mask of private file descriptor with UART port number
+#define UART_FILE_DESCRIPTOR_PORT_MASK_		(UART_FILE_DESCRIPTOR_NONBLOCK_ - 1)
 
-/// array with available UARTs
-uint32_t *uarts_confs[] =
-{
-		0,
-};
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
 
-// true if given device is already initialized - it's not re-initialized in that case
-bool initialized_[sizeof(uarts_) / sizeof(*uarts_)];
+// true if given UART port is already initialized - it's not re-initialized in that case
+bool initialized_[USART_PORT_COUNT];
 
 /*---------------------------------------------------------------------------------------------------------------------+
 | global functions
@@ -57,60 +50,128 @@ bool initialized_[sizeof(uarts_) / sizeof(*uarts_)];
 /**
  * \brief Opens a file.
  *
- * Last character of filename must contain the UART port number - '0' or '1'.
+ * Last character of filename must contain the UART port number - '0' for USART1, '1' for USART2 or '2' for USART3. If O_NONBLOCK is set in flags, reads
+ * from returned file descriptor don't block.
  *
  * \param [in] filename is the name of the file to open.
+ * \param [in] flags is the bitwise inclusive-OR of the file access modes and file status flags.
  *
  * \return -1 for failure or file descriptor on success
  */
 
 int uart_open_r(struct _reent *r, const char *filename, int flags, int mode)
 {
+	(void)r;	// suppress warning
+	(void)mode;	// suppress warning
+
 	int ret = -1;
 	const int file_descriptor = filename[strlen(filename) - 1] - '0';	// get UART port from last character
 
 	// found descriptor must be in valid range
-	if (file_descriptor < 0 || (unsigned int)(file_descriptor) >= sizeof(uarts_) / sizeof(*uarts_))
+	if (file_descriptor < 0 || (unsigned int)(file_descriptor) >= USART_PORT_COUNT)
 		errno = ENOENT;
 	else
 	{
 		if (!initialized_[file_descriptor])	// device not yet initialized?
 		{
-			errno = usartInitialize();
+			const enum Error error = usartInitialize(file_descriptor);
 
-			if (errno != 0)	// initialize() failed?
+			if (error != ERROR_NONE)	// initialize() failed?
+			{
+				errno = error == ERROR_USART_PORT_NOT_AVAILABLE ? ENOENT : ENOMEM;
 				return ret;
+			}
 			else
 			{
 				initialized_[file_descriptor] = true;	// mark device as initialized
+				usartSetEventCallback(ioSyscallsNotifyFromISR);	// wake tasks waiting in ioPoll()
 				ret = file_descriptor;	// open() successful
 			}
 		}
 		else	// device already initialized
 			ret = file_descriptor;
+
+		if ((flags & O_NONBLOCK) != 0)
+			ret |= UART_FILE_DESCRIPTOR_NONBLOCK_;
 	}
 
 	return ret;
 }
 
+/**
+ * \brief Query whether file is a terminal.
+ *
+ * \param [in] file_descriptor is the file descriptor to test.
+ *
+ * \return 1 - UART is always a terminal
+ */
+
+int uart_isatty_r(struct _reent *r, int file_descriptor)
+{
+	(void)r;								// suppress warning
+	(void)file_descriptor;					// suppress warning
+
+	return 1;
+}
+
+/**
+ * \brief Checks readiness of a file.
+ *
+ * \param [in] file_descriptor is the file descriptor that references an open file.
+ * \param [in] events is the bitwise OR of IO_POLL_IN and IO_POLL_OUT.
+ *
+ * \return requested events which are ready
+ */
+
+int uart_poll(int file_descriptor, int events)
+{
+	const size_t port = file_descriptor & UART_FILE_DESCRIPTOR_PORT_MASK_;
+	int revents = 0;
+
+	if ((events & IO_POLL_IN) != 0 && usartGetRxAvailable(port) != 0)
+		revents |= IO_POLL_IN;
+
+	if ((events & IO_POLL_OUT) != 0 && usartGetTxSpace(port) != 0)
+		revents |= IO_POLL_OUT;
+
+	return revents;
+}
+
 /**
  * \brief Read from a file.
  *
- * Read of first character is blocking, following reads are non-blocking.
+ * Read waits for the first character (without waiting if device was opened with O_NONBLOCK, at most
+ * UART_READ_TIMEOUT_MS if it's not 0) and then returns all data that was already received, up to size bytes. Data is
+ * copied directly from RX ring buffer of UART.
  *
  * \param [in] file_descriptor is the file descriptor that references an open file.
  * \param [in] buffer points to the buffer to place the read information into.
  * \param [in] size specifies the maximum number of bytes to attempt to read.
  *
- * \return -1 for failure or number of read bytes for success
+ * \return -1 for failure (errno is EAGAIN if there's no data for non-blocking read), 0 for end-of-file when timeout
+ * expired or number of read bytes for success
  */
 
 ssize_t uart_read_r(struct _reent * r, int file_descriptor, void * buffer, size_t size)
 {
-	size_t count = 0;
-//	portTickType ticks_to_wait = portMAX_DELAY;
-//	usart_driver_t * d = uarts_[file_descriptor];
-//	count = d->read(d, ticks_to_wait, buffer, size);
+	(void)r;	// suppress warning
+
+	const bool nonblocking = (file_descriptor & UART_FILE_DESCRIPTOR_NONBLOCK_) != 0;
+	portTickType ticks_to_wait = portMAX_DELAY;
+
+	if (nonblocking == true)
+		ticks_to_wait = 0;
+	else if (UART_READ_TIMEOUT_MS != 0)
+		ticks_to_wait = UART_READ_TIMEOUT_MS / portTICK_RATE_MS;
+
+	const size_t count = usartReceiveBytes(file_descriptor & UART_FILE_DESCRIPTOR_PORT_MASK_, buffer, size,
+			ticks_to_wait);
+
+	if (count == 0 && size != 0 && nonblocking == true)
+	{
+		errno = EAGAIN;	// "There is no data available right now."
+		return -1;
+	}
 
 	return count;
 }
@@ -118,7 +179,9 @@ ssize_t uart_read_r(struct _reent * r, int file_descriptor, void * buffer, size_
 /**
  * \brief Write to a file.
  *
- * Write of first character is blocking, following writes are non-blocking.
+ * Data is copied directly from stdio buffer to TX ring buffer of UART, from which it is sent by DMA - this is the only
+ * copy made. Data is treated as binary, so it may contain any bytes, including '\0'. Write blocks until all data is
+ * placed in TX ring buffer.
  *
  * \param [in] file_descriptor is the file descriptor that references an open file.
  * \param [in] buffer is an array of data to write to the open file.
@@ -129,23 +192,16 @@ ssize_t uart_read_r(struct _reent * r, int file_descriptor, void * buffer, size_
 
 ssize_t uart_write_r(struct _reent * r, int file_descriptor, const void * buffer, size_t size)
 {
-	portTickType ticks_to_wait = portMAX_DELAY;
-	uint32_t uart_nr = uarts_[file_descriptor];
-	size_t length = strlen(buffer);
-
-	if(uart_nr == 0){
-		if(size == length){
-			usartSendString(buffer, ticks_to_wait);
-		} else {
-			char * new_str = pvPortMalloc((size+1)*sizeof(char));
-			memcpy(new_str, buffer, size);
-			*(new_str+length) = '\0';
-
-			usartSendBytes(new_str, size, ticks_to_wait);
-			vPortFree(new_str);
-		}
+	(void)r;	// suppress warning
+
+	const enum Error error = usartSendBytes(file_descriptor & UART_FILE_DESCRIPTOR_PORT_MASK_, buffer, size,
+			portMAX_DELAY);
+
+	if (error != ERROR_NONE)
+	{
+		errno = EIO;	// "There was a hardware error."
+		return -1;
 	}
+
 	return size;
 }
-
-
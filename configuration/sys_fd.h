@@ -19,7 +19,9 @@
 | global functions' declarations
 +---------------------------------------------------------------------------------------------------------------------*/
 
+int uart_isatty_r(struct _reent *r, int filedes);
 int uart_open_r(struct _reent *r, const char *filename, int flags, int mode);
+int uart_poll(int filedes, int events);
 ssize_t uart_read_r(struct _reent *r, int filedes, void *buffer, size_t size);
 ssize_t uart_write_r(struct _reent *r, int filedes, const void *buffer, size_t size);
 
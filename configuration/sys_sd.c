@@ -0,0 +1,432 @@
+/**
+ * \file sys_sd.c
+ * \brief Low-level I/O syscalls for files on SD card.
+ *
+ * Files on FatFS volume are available as "/sd/<path>". Volume is mounted when the first file is opened, the card
+ * itself is initialized by FatFS on first access.
+ *
+ * FatFS transfers whole sectors directly between disk and caller's buffer when file pointer is sector-aligned, so
+ * stdio buffers of streams are multiple of sector size (see SD_STREAM_BUFFER_SIZE) - flushes of full buffers and large
+ * fwrite()/fread() calls go straight to disk_write()/disk_read() without copying through FatFS buffers.
+ *
+ * errno values are based on:
+ * http://www.gnu.org/software/libc/manual/html_node/Low_002dLevel-I_002fO.html#Low_002dLevel-I_002fO
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "sys_sd.h"
+
+#include "ff.h"
+#include "disk_cache.h"
+
+#include "config.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local defines
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// length of "/sd" prefix, which is removed from filenames passed to FatFS
+#define SD_PREFIX_LENGTH_					3
+
+_Static_assert(SD_FILES_MAX <= 32, "SD_FILES_MAX must not exceed 32 - free files are tracked in uint32_t bitmask!");
+_Static_assert(SD_STREAM_BUFFER_SIZE % _MAX_SS == 0, "SD_STREAM_BUFFER_SIZE must be a multiple of sector size!");
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+static int checkFile_(int file_descriptor);
+static int errnoFromResult_(FRESULT result);
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// FatFS volume
+static FATFS fatfs_;
+
+/// true if volume is mounted
+static bool mounted_;
+
+/// file objects of opened files, private file descriptor is the index in this array
+static FIL files_[SD_FILES_MAX];
+
+/// bitmask of used elements of files_[]
+static uint32_t filesUsed_;
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Close a file.
+ *
+ * \param [in] file_descriptor is the file descriptor to close.
+ *
+ * \return -1 for failure or 0 for success
+ */
+
+int sd_close_r(struct _reent *r, int file_descriptor)
+{
+	(void)r;	// suppress warning
+
+	if (checkFile_(file_descriptor) != 0)
+		return -1;
+
+	const FRESULT result = f_close(&files_[file_descriptor]);
+
+	taskENTER_CRITICAL();
+	filesUsed_ &= ~(1 << file_descriptor);
+	taskEXIT_CRITICAL();
+
+	if (result != FR_OK)
+	{
+		errno = errnoFromResult_(result);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Status of an open file.
+ *
+ * \param [in] file_descriptor is a file descriptor referring to a file for which status is returned.
+ * \param [out] st points to a stat structure where status information about the file is to be placed.
+ *
+ * \return 0 for success, -1 for failure
+ */
+
+int sd_fstat_r(struct _reent *r, int file_descriptor, struct stat *st)
+{
+	(void)r;	// suppress warning
+
+	if (checkFile_(file_descriptor) != 0)
+		return -1;
+
+	memset(st, 0, sizeof(*st));
+	st->st_mode = S_IFREG;
+	st->st_size = f_size(&files_[file_descriptor]);
+	st->st_blksize = SD_STREAM_BUFFER_SIZE;	// newlib uses it as the size of buffer allocated for the stream
+	return 0;
+}
+
+/**
+ * \brief Set position in a file.
+ *
+ * Position past the end of file opened for writing extends the file.
+ *
+ * \param [in] file_descriptor is the file descriptor of an open file.
+ * \param [in] offset specifies the number of bytes to offset the file pointer from a specified file origin.
+ * \param [in] whence specifies the location from which to start seeking.
+ *
+ * \return -1 for failure, resulting file position, measured in bytes from the beginning of the file for success
+ */
+
+off_t sd_lseek_r(struct _reent *r, int file_descriptor, off_t offset, int whence)
+{
+	(void)r;	// suppress warning
+
+	if (checkFile_(file_descriptor) != 0)
+		return -1;
+
+	FIL * const file = &files_[file_descriptor];
+	off_t position = offset;
+
+	if (whence == SEEK_CUR)
+		position += f_tell(file);
+	else if (whence == SEEK_END)
+		position += f_size(file);
+	else if (whence != SEEK_SET)
+	{
+		errno = EINVAL;	// "The whence argument value is not valid."
+		return -1;
+	}
+
+	if (position < 0)
+	{
+		errno = EINVAL;	// "The resulting file offset would be negative."
+		return -1;
+	}
+
+	if (position == (off_t)f_tell(file))	// ftell() doesn't need to touch the card
+		return position;
+
+	const FRESULT result = f_lseek(file, position);
+	if (result != FR_OK)
+	{
+		errno = errnoFromResult_(result);
+		return -1;
+	}
+
+	return f_tell(file);
+}
+
+/**
+ * \brief Mounts FatFS volume if it's not mounted yet.
+ *
+ * Volume is registered and read right away (FatFS would read it only on first access), so that FAT sectors can be
+ * passed to disk cache.
+ *
+ * \return true if volume is mounted, false otherwise
+ */
+
+bool sd_mount(void)
+{
+	if (mounted_ == true)
+		return true;
+
+	if (f_mount(0, &fatfs_) != FR_OK)
+		return false;
+
+	DIR directory;
+	if (f_opendir(&directory, "") != FR_OK)	// read the volume
+		return false;
+
+	diskCacheSetFatSectors(fatfs_.fatbase, fatfs_.fsize * fatfs_.n_fats);
+	mounted_ = true;
+	return true;
+}
+
+/**
+ * \brief Opens a file.
+ *
+ * \param [in] filename is the name of the file to open, "/sd/<path>".
+ * \param [in] flags is the bitwise inclusive-OR of the file access modes and file status flags.
+ * \param [in] mode specifies what permissions the file has when it is created, ignored.
+ *
+ * \return -1 for failure or file descriptor on success
+ */
+
+int sd_open_r(struct _reent *r, const char *filename, int flags, int mode)
+{
+	(void)r;	// suppress warning
+	(void)mode;	// suppress warning
+
+	if (sd_mount() == false)
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+
+	int file_descriptor = -1;
+
+	taskENTER_CRITICAL();
+	const uint32_t free_files = ~filesUsed_ & (UINT32_MAX >> (32 - SD_FILES_MAX));
+	if (free_files != 0)
+	{
+		file_descriptor = __builtin_ctz(free_files);
+		filesUsed_ |= 1 << file_descriptor;
+	}
+	taskEXIT_CRITICAL();
+
+	if (file_descriptor == -1)
+	{
+		errno = EMFILE;	// "The process has too many files open."
+		return -1;
+	}
+
+	BYTE fatfs_mode = 0;
+
+	if ((flags & O_ACCMODE) == O_RDONLY || (flags & O_ACCMODE) == O_RDWR)
+		fatfs_mode |= FA_READ;
+	if ((flags & O_ACCMODE) == O_WRONLY || (flags & O_ACCMODE) == O_RDWR)
+		fatfs_mode |= FA_WRITE;
+
+	if ((flags & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL))
+		fatfs_mode |= FA_CREATE_NEW;
+	else if ((flags & (O_CREAT | O_TRUNC)) == (O_CREAT | O_TRUNC))
+		fatfs_mode |= FA_CREATE_ALWAYS;
+	else if ((flags & O_CREAT) != 0)
+		fatfs_mode |= FA_OPEN_ALWAYS;
+	else
+		fatfs_mode |= FA_OPEN_EXISTING;
+
+	FIL * const file = &files_[file_descriptor];
+	FRESULT result = f_open(file, &filename[SD_PREFIX_LENGTH_], fatfs_mode);
+
+	// O_TRUNC without O_CREAT
+	if (result == FR_OK && (flags & (O_CREAT | O_TRUNC)) == O_TRUNC && (fatfs_mode & FA_WRITE) != 0)
+		result = f_truncate(file);
+
+	if (result != FR_OK)
+	{
+		taskENTER_CRITICAL();
+		filesUsed_ &= ~(1 << file_descriptor);
+		taskEXIT_CRITICAL();
+
+		errno = errnoFromResult_(result);
+		return -1;
+	}
+
+	diskCacheSetFatSectors(fatfs_.fatbase, fatfs_.fsize * fatfs_.n_fats);	// volume may have been remounted (card change)
+
+	return file_descriptor;
+}
+
+/**
+ * \brief Read from a file.
+ *
+ * \param [in] file_descriptor is the file descriptor that references an open file.
+ * \param [in] buffer points to the buffer to place the read information into.
+ * \param [in] size specifies the maximum number of bytes to attempt to read.
+ *
+ * \return -1 for failure or number of read bytes for success, 0 at the end of file
+ */
+
+ssize_t sd_read_r(struct _reent *r, int file_descriptor, void *buffer, size_t size)
+{
+	(void)r;	// suppress warning
+
+	if (checkFile_(file_descriptor) != 0)
+		return -1;
+
+	UINT count;
+	const FRESULT result = f_read(&files_[file_descriptor], buffer, size, &count);
+
+	if (result != FR_OK)
+	{
+		errno = errnoFromResult_(result);
+		return -1;
+	}
+
+	return count;
+}
+
+/**
+ * \brief Remove a file's directory entry.
+ *
+ * \param [in] filename points to the path name that names the file to be unlinked, "/sd/<path>".
+ *
+ * \return 0 for success, -1 for failure
+ */
+
+int sd_unlink_r(struct _reent *r, const char *filename)
+{
+	(void)r;	// suppress warning
+
+	if (sd_mount() == false)
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+
+	const FRESULT result = f_unlink(&filename[SD_PREFIX_LENGTH_]);
+
+	if (result != FR_OK)
+	{
+		errno = errnoFromResult_(result);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Write to a file.
+ *
+ * \param [in] file_descriptor is the file descriptor of an open file to write to.
+ * \param [in] buffer is an array of data to write to the open file.
+ * \param [in] size is the number of bytes to write to the file.
+ *
+ * \return -1 for failure or number of written bytes for success
+ */
+
+ssize_t sd_write_r(struct _reent *r, int file_descriptor, const void *buffer, size_t size)
+{
+	(void)r;	// suppress warning
+
+	if (checkFile_(file_descriptor) != 0)
+		return -1;
+
+	UINT count;
+	const FRESULT result = f_write(&files_[file_descriptor], buffer, size, &count);
+
+	if (result != FR_OK)
+	{
+		errno = errnoFromResult_(result);
+		return -1;
+	}
+
+	if (count == 0 && size != 0)
+	{
+		errno = ENOSPC;	// "The device containing the file is full."
+		return -1;
+	}
+
+	return count;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Checks whether private file descriptor refers to opened file.
+ *
+ * \param [in] file_descriptor is the private file descriptor
+ *
+ * \return 0 if file is opened, -1 otherwise (errno set to EBADF)
+ */
+
+static int checkFile_(int file_descriptor)
+{
+	if (file_descriptor < 0 || file_descriptor >= SD_FILES_MAX || (filesUsed_ & (1 << file_descriptor)) == 0)
+	{
+		errno = EBADF;	// "The filedes argument is not a valid file descriptor."
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Converts result of FatFS function to errno code.
+ *
+ * \param [in] result is the result of FatFS function, must not be FR_OK
+ *
+ * \return errno code
+ */
+
+static int errnoFromResult_(FRESULT result)
+{
+	switch (result)
+	{
+	case FR_NO_FILE:
+	case FR_NO_PATH:
+	case FR_INVALID_DRIVE:
+		return ENOENT;
+	case FR_INVALID_NAME:
+		return EINVAL;
+	case FR_DENIED:
+	case FR_WRITE_PROTECTED:
+		return EACCES;
+	case FR_EXIST:
+		return EEXIST;
+	case FR_INVALID_OBJECT:
+		return EBADF;
+	case FR_NOT_READY:
+	case FR_NOT_ENABLED:
+	case FR_NO_FILESYSTEM:
+		return ENODEV;
+	case FR_TIMEOUT:
+	case FR_LOCKED:
+		return EBUSY;
+	case FR_NOT_ENOUGH_CORE:
+		return ENOMEM;
+	case FR_TOO_MANY_OPEN_FILES:
+		return EMFILE;
+	default:
+		return EIO;
+	}
+}
@@ -0,0 +1,37 @@
+/**
+ * \file sys_sd.h
+ * \brief Header for sys_sd.c
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef SYS_SD_H_
+#define SYS_SD_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' declarations
++---------------------------------------------------------------------------------------------------------------------*/
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif	// __cplusplus
+
+int sd_close_r(struct _reent *r, int filedes);
+int sd_fstat_r(struct _reent *r, int filedes, struct stat *st);
+off_t sd_lseek_r(struct _reent *r, int filedes, off_t offset, int whence);
+bool sd_mount(void);
+int sd_open_r(struct _reent *r, const char *filename, int flags, int mode);
+ssize_t sd_read_r(struct _reent *r, int filedes, void *buffer, size_t size);
+int sd_unlink_r(struct _reent *r, const char *filename);
+ssize_t sd_write_r(struct _reent *r, int filedes, const void *buffer, size_t size);
+
+#ifdef __cplusplus
+}	// extern "C"
+#endif	// __cplusplus
+
+#endif	// SYS_SD_H_
@@ -0,0 +1,438 @@
+/**
+ * \file disk_image.cpp
+ * \brief SD card driver backed by disk image file, for host build of the storage stack
+ *
+ * Implements the same interface as FatFS/mmc.cpp - disk_initialize(), disk_status(), mmcDiskRead(), mmcDiskWrite() and
+ * mmcDiskIoctl() - so that FatFS and disk cache run unmodified on top of regular file.
+ *
+ * Optional latency model calculates the time the operations would take on SD card in SPI mode. It follows the policy
+ * of mmc.cpp - multi-block transfers are left open and sequential accesses in the same direction continue them without
+ * any command, single-sector accesses which don't continue open transfer use single-block commands. Write which starts
+ * among sectors hinted with MMC_SET_PRE_ERASE opens new multi-block write preceded by ACMD23 with the number of hinted
+ * sectors, which is counted in statistics. Time is only accumulated (nothing sleeps), so results are reproducible and
+ * benchmarks run at full speed.
+ *
+ * prefix: diskImage
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "disk_image.hpp"
+
+#include "mmc.h"
+
+#include "diskio.h"
+#include "ff.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local defines
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// size of sector, bytes
+#define DISK_IMAGE_SECTOR_SIZE_				512
+
+/// bytes on the bus for command with R1 response
+#define DISK_IMAGE_COMMAND_BYTES_			8
+
+/// bytes on the bus for read block - data token, data and CRC
+#define DISK_IMAGE_READ_BLOCK_BYTES_		(1 + DISK_IMAGE_SECTOR_SIZE_ + 2)
+
+/// bytes on the bus for written block - data token, data, CRC and data response
+#define DISK_IMAGE_WRITE_BLOCK_BYTES_		(1 + DISK_IMAGE_SECTOR_SIZE_ + 2 + 1)
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// direction of last access of the card
+enum class Access_
+{
+	NONE,
+	READ,
+	WRITE,
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+void access_(Access_ access, DWORD sector, BYTE count, DWORD erase_count);
+void addBusTime_(uint32_t bytes);
+void closeStream_();
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// file descriptor of disk image, -1 if no image is opened
+int fileDescriptor_ = -1;
+
+/// number of sectors in disk image
+DWORD sectors_;
+
+/// allocation unit reported by GET_BLOCK_SIZE, sectors
+DWORD allocationUnit_;
+
+/// latency model, all zeros if disabled
+DiskImageLatencyModel model_;
+
+/// statistics of disk image
+DiskImageStatistics statistics_;
+
+/// modeled time which is less than 1 us, ns
+uint32_t modeledNsRemainder_;
+
+/// direction of last access
+Access_ lastAccess_ = Access_::NONE;
+
+/// sector following the last accessed one
+DWORD nextSector_;
+
+/// true if multi-block transfer in direction of lastAccess_ is still open
+bool streamOpen_;
+
+/// first sector of pre-erase hint
+DWORD preEraseSector_;
+
+/// number of sectors of pre-erase hint, 0 if there's no hint
+DWORD preEraseCount_;
+
+}	// namespace
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Closes disk image.
+ */
+
+void diskImageClose()
+{
+	if (fileDescriptor_ != -1)
+		close(fileDescriptor_);
+
+	fileDescriptor_ = -1;
+}
+
+/**
+ * \brief Gets statistics of disk image.
+ *
+ * \param [out] statistics is a pointer to struct for statistics
+ */
+
+void diskImageGetStatistics(DiskImageStatistics * const statistics)
+{
+	*statistics = statistics_;
+}
+
+/**
+ * \brief Creates (or truncates) disk image file.
+ *
+ * Contents of the image are zeroed, so it must be formatted with f_mkfs() before use.
+ *
+ * \param [in] path is the path of disk image file
+ * \param [in] sectors is the size of disk image, sectors
+ * \param [in] allocation_unit is the allocation unit reported to FatFS (used by f_mkfs() for alignment of data area),
+ * sectors
+ *
+ * \return 0 on success, -1 otherwise (errno set)
+ */
+
+int diskImageOpen(const char * const path, const DWORD sectors, const DWORD allocation_unit)
+{
+	diskImageClose();
+
+	const int file_descriptor = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file_descriptor == -1)
+		return -1;
+
+	if (ftruncate(file_descriptor, static_cast<off_t>(sectors) * DISK_IMAGE_SECTOR_SIZE_) != 0)
+	{
+		close(file_descriptor);
+		return -1;
+	}
+
+	fileDescriptor_ = file_descriptor;
+	sectors_ = sectors;
+	allocationUnit_ = allocation_unit;
+	lastAccess_ = Access_::NONE;
+	streamOpen_ = false;
+	preEraseCount_ = 0;
+	return 0;
+}
+
+/**
+ * \brief Resets statistics of disk image.
+ */
+
+void diskImageResetStatistics()
+{
+	memset(&statistics_, 0, sizeof(statistics_));
+	modeledNsRemainder_ = 0;
+}
+
+/**
+ * \brief Sets latency model.
+ *
+ * \param [in] model is a pointer to latency model, nullptr to disable modeling
+ */
+
+void diskImageSetLatencyModel(const DiskImageLatencyModel * const model)
+{
+	if (model != nullptr)
+		model_ = *model;
+	else
+		memset(&model_, 0, sizeof(model_));
+}
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| FatFS disk interface
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Initializes the drive.
+ *
+ * \param [in] drive is the number of drive, only 0 is supported
+ *
+ * \return status of the drive
+ */
+
+DSTATUS disk_initialize(const BYTE drive)
+{
+	return disk_status(drive);
+}
+
+/**
+ * \brief Gets status of the drive.
+ *
+ * \param [in] drive is the number of drive, only 0 is supported
+ *
+ * \return status of the drive - STA_NOINIT if no image is opened
+ */
+
+DSTATUS disk_status(const BYTE drive)
+{
+	return drive == 0 && fileDescriptor_ != -1 ? 0 : STA_NOINIT;
+}
+
+/**
+ * \brief Reads sectors from disk image.
+ *
+ * \param [in] drive is the number of drive, only 0 is supported
+ * \param [out] buffer is the buffer for read data
+ * \param [in] sector is the first sector to read
+ * \param [in] count is the number of sectors to read
+ *
+ * \return RES_OK on success, error code otherwise
+ */
+
+DRESULT mmcDiskRead(const BYTE drive, BYTE * const buffer, const DWORD sector, const BYTE count)
+{
+	if (disk_status(drive) != 0)
+		return RES_NOTRDY;
+	if (count == 0 || sector >= sectors_ || count > sectors_ - sector)
+		return RES_PARERR;
+
+	const size_t size = count * DISK_IMAGE_SECTOR_SIZE_;
+	if (pread(fileDescriptor_, buffer, size, static_cast<off_t>(sector) * DISK_IMAGE_SECTOR_SIZE_) !=
+			static_cast<ssize_t>(size))
+		return RES_ERROR;
+
+	access_(Access_::READ, sector, count, 0);
+	statistics_.readSectors += count;
+	return RES_OK;
+}
+
+/**
+ * \brief Writes sectors to disk image.
+ *
+ * \param [in] drive is the number of drive, only 0 is supported
+ * \param [in] buffer is the data to write
+ * \param [in] sector is the first sector to write
+ * \param [in] count is the number of sectors to write
+ *
+ * \return RES_OK on success, error code otherwise
+ */
+
+DRESULT mmcDiskWrite(const BYTE drive, const BYTE * const buffer, const DWORD sector, const BYTE count)
+{
+	if (disk_status(drive) != 0)
+		return RES_NOTRDY;
+	if (count == 0 || sector >= sectors_ || count > sectors_ - sector)
+		return RES_PARERR;
+
+	const size_t size = count * DISK_IMAGE_SECTOR_SIZE_;
+	if (pwrite(fileDescriptor_, buffer, size, static_cast<off_t>(sector) * DISK_IMAGE_SECTOR_SIZE_) !=
+			static_cast<ssize_t>(size))
+		return RES_ERROR;
+
+	DWORD erase_count = 0;
+	if (preEraseCount_ != 0 && sector - preEraseSector_ < preEraseCount_)	// hint is used by write starting in it...
+	{
+		erase_count = preEraseCount_ - (sector - preEraseSector_);
+		preEraseCount_ = 0;
+	}
+	else if (preEraseCount_ != 0 && preEraseSector_ - sector < count)	// ... and made stale by overlapping write
+		preEraseCount_ = 0;
+
+	access_(Access_::WRITE, sector, count, erase_count);
+	statistics_.writeSectors += count;
+	return RES_OK;
+}
+
+/**
+ * \brief Miscellaneous functions of the drive.
+ *
+ * Any control code except MMC_SET_PRE_ERASE ends open multi-block transfer, like in mmc.cpp.
+ *
+ * \param [in] drive is the number of drive, only 0 is supported
+ * \param [in] control_code is the control code
+ * \param [in,out] buffer is the buffer for data of control code
+ *
+ * \return RES_OK on success, error code otherwise
+ */
+
+DRESULT mmcDiskIoctl(const BYTE drive, const BYTE control_code, void * const buffer)
+{
+	if (disk_status(drive) != 0)
+		return RES_NOTRDY;
+
+	if (control_code == MMC_SET_PRE_ERASE)	// only remembered, card is not accessed
+	{
+		preEraseSector_ = static_cast<DWORD *>(buffer)[0];
+		preEraseCount_ = static_cast<DWORD *>(buffer)[1] & 0x7FFFFF;
+		return RES_OK;
+	}
+
+	closeStream_();
+
+	switch (control_code)
+	{
+	case CTRL_SYNC:
+		return RES_OK;
+	case GET_SECTOR_COUNT:
+		*static_cast<DWORD *>(buffer) = sectors_;
+		return RES_OK;
+	case GET_SECTOR_SIZE:
+		*static_cast<WORD *>(buffer) = DISK_IMAGE_SECTOR_SIZE_;
+		return RES_OK;
+	case GET_BLOCK_SIZE:
+		*static_cast<DWORD *>(buffer) = allocationUnit_;
+		return RES_OK;
+	default:
+		return RES_PARERR;
+	}
+}
+
+/**
+ * \brief Gets current time for FatFS.
+ *
+ * \return 0 - no time is implemented, like on the target
+ */
+
+DWORD get_fattime(void)
+{
+	return 0;
+}
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Counts commands and models time of access.
+ *
+ * \param [in] access is the direction of access
+ * \param [in] sector is the first accessed sector
+ * \param [in] count is the number of accessed sectors
+ * \param [in] erase_count is the number of sectors which may be pre-erased by write starting at sector, 0 if none
+ */
+
+void access_(const Access_ access, const DWORD sector, const BYTE count, const DWORD erase_count)
+{
+	// write with pre-erase hint needs new multi-block write, as ACMD23 precedes CMD25
+	const bool continuation = streamOpen_ == true && lastAccess_ == access && nextSector_ == sector &&
+			erase_count == 0;
+
+	if (continuation == false)
+	{
+		closeStream_();
+
+		if (access == Access_::READ)
+			statistics_.readCommands++;
+		else
+			statistics_.writeCommands++;
+
+		if (model_.clockHz != 0)
+		{
+			statistics_.modeledUs += model_.commandUs;
+			addBusTime_(DISK_IMAGE_COMMAND_BYTES_);
+		}
+
+		const bool sequential = lastAccess_ == access && nextSector_ == sector;
+		streamOpen_ = count > 1 || sequential == true || erase_count != 0;	// single-block command otherwise
+		statistics_.preEraseSectors += erase_count;
+	}
+
+	lastAccess_ = access;
+	nextSector_ = sector + count;
+
+	if (model_.clockHz == 0)
+		return;
+
+	if (access == Access_::READ)
+	{
+		statistics_.modeledUs += static_cast<uint64_t>(model_.readBlockUs) * count;
+		addBusTime_(DISK_IMAGE_READ_BLOCK_BYTES_ * count);
+	}
+	else
+	{
+		statistics_.modeledUs += static_cast<uint64_t>(model_.writeBlockUs) * count;
+		addBusTime_(DISK_IMAGE_WRITE_BLOCK_BYTES_ * count);
+	}
+}
+
+/**
+ * \brief Adds time of transfer of bytes through SPI to modeled time.
+ *
+ * \param [in] bytes is the number of transferred bytes
+ */
+
+void addBusTime_(const uint32_t bytes)
+{
+	const uint64_t ns = static_cast<uint64_t>(bytes) * 8 * 1000000000 / model_.clockHz + modeledNsRemainder_;
+	statistics_.modeledUs += ns / 1000;
+	modeledNsRemainder_ = ns % 1000;
+}
+
+/**
+ * \brief Closes open multi-block transfer - CMD12 for read, stop token for write.
+ */
+
+void closeStream_()
+{
+	if (streamOpen_ == false)
+		return;
+
+	streamOpen_ = false;
+
+	if (model_.clockHz != 0)
+	{
+		statistics_.modeledUs += model_.stopUs;
+		addBusTime_(DISK_IMAGE_COMMAND_BYTES_);
+	}
+}
+
+}	// namespace
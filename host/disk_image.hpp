@@ -0,0 +1,49 @@
+/**
+ * \file disk_image.hpp
+ * \brief Header for disk_image.cpp
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef DISK_IMAGE_HPP_
+#define DISK_IMAGE_HPP_
+
+#include <cstdint>
+
+#include "diskio.h"
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// timings of SD card in SPI mode used to calculate modeled time of disk operations
+struct DiskImageLatencyModel
+{
+	uint32_t clockHz;						///< SPI clock, Hz
+	uint32_t commandUs;						///< command with response and card's access time before first block, us
+	uint32_t readBlockUs;					///< wait for data token of each read block, us
+	uint32_t writeBlockUs;					///< busy time after each written block, us
+	uint32_t stopUs;						///< stop of multi-block transfer, including busy time, us
+};
+
+/// statistics of disk image
+struct DiskImageStatistics
+{
+	uint32_t readSectors;					///< number of read sectors
+	uint32_t writeSectors;					///< number of written sectors
+	uint32_t readCommands;					///< number of read commands - single-block and multi-block
+	uint32_t writeCommands;					///< number of write commands - single-block and multi-block
+	uint32_t preEraseSectors;				///< number of sectors announced with ACMD23 from MMC_SET_PRE_ERASE hints
+	uint64_t modeledUs;						///< modeled time of all operations, 0 if latency model is disabled, us
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+void diskImageClose();
+void diskImageGetStatistics(DiskImageStatistics *statistics);
+int diskImageOpen(const char *path, DWORD sectors, DWORD allocation_unit);
+void diskImageResetStatistics();
+void diskImageSetLatencyModel(const DiskImageLatencyModel *model);
+
+#endif	// DISK_IMAGE_HPP_
@@ -0,0 +1,617 @@
+/**
+ * \file fatfs_bench.cpp
+ * \brief Benchmark suite of the storage stack running on the host
+ *
+ * FatFS with disk cache runs on top of disk image file (see disk_image.cpp). Fresh image is created and formatted on
+ * each run, then workloads are executed in order:
+ * - seq_append - appending records to a file with f_write(),
+ * - log_append - appending records to preallocated append-log,
+ * - random_read - reading records from random offsets of the file written by seq_append,
+ * - small_create, small_read, small_unlink - creating, reading and removing many small files in a directory,
+ * - getfree - f_getfree() on freshly mounted volume,
+ * - first_append - appending records to a new file after getfree - without FSInfo (FAT12/16) the first allocation
+ * after mount searches for free cluster from the beginning of FAT.
+ *
+ * For each workload wall time, sector and command counts at the driver, number of sectors announced for pre-erase
+ * and - with latency model enabled - modeled time on SD card in SPI mode are displayed. log_append fails if pre-erase
+ * hints of the append-log don't reach the driver as ACMD23 covering the whole log.
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "disk_image.hpp"
+
+#include "append_log.h"
+#include "disk_cache.h"
+#include "ff.h"
+
+#include <chrono>
+#include <memory>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// parameters of benchmark
+struct Parameters_
+{
+	const char *imagePath;					///< path of disk image file
+	uint32_t imageMegabytes;				///< size of disk image, MB
+	uint32_t allocationUnit;				///< allocation unit of disk image, sectors
+	uint32_t kilobytes;						///< amount of data written by append workloads, KB
+	uint32_t recordSize;					///< size of single record, bytes
+	uint32_t reads;							///< number of reads of random_read workload
+	uint32_t files;							///< number of files of small_* workloads
+	uint32_t fileSize;						///< size of single file of small_* workloads, bytes
+	bool latencyModel;						///< true if latency model is enabled
+	DiskImageLatencyModel model;			///< latency model
+};
+
+/// measurement of single workload
+class Measurement_
+{
+public:
+
+	/**
+	 * \brief Measurement_'s constructor - starts the measurement.
+	 *
+	 * \param [in] name is the name of workload
+	 */
+
+	explicit Measurement_(const char *name);
+
+	/**
+	 * \brief Stops the measurement and displays results.
+	 *
+	 * \param [in] result is the result of workload
+	 * \param [in] operations is the number of operations done by workload
+	 * \param [in] bytes is the number of bytes transferred by workload
+	 *
+	 * \return result
+	 */
+
+	FRESULT finish(FRESULT result, uint32_t operations, uint64_t bytes);
+
+private:
+
+	/// name of workload
+	const char *name_;
+
+	/// wall time of start
+	std::chrono::steady_clock::time_point start_;
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+FRESULT fileAppend_(const char *name, const char *path, uint32_t length, uint32_t record_size);
+FRESULT firstAppendBench_(const Parameters_ &parameters);
+FRESULT getfreeBench_(FATFS *fs);
+FRESULT logAppendBench_(const Parameters_ &parameters);
+FRESULT mount_(FATFS *fs);
+int parseArguments_(int argc, char *argv[], Parameters_ &parameters);
+FRESULT randomReadBench_(const Parameters_ &parameters);
+uint32_t random_();
+FRESULT seqAppendBench_(const Parameters_ &parameters);
+FRESULT smallFilesBench_(const Parameters_ &parameters);
+void usage_(const char *program);
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// file written by seq_append and read by random_read
+const char seqAppendPath_[] = "seq.bin";
+
+/// file written by log_append
+const char logAppendPath_[] = "log.bin";
+
+/// file written by first_append
+const char firstAppendPath_[] = "first.bin";
+
+/// directory of small_* workloads
+const char smallFilesDirectory_[] = "small";
+
+/// data of records, filled with pattern in main()
+BYTE buffer_[_MAX_SS];
+
+/// state of pseudo-random generator - fixed seed, so that runs are reproducible
+uint32_t randomState_ = 1;
+
+}	// namespace
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Main code block of benchmark.
+ *
+ * \return 0 on success, 1 on invalid arguments, 2 if any workload failed
+ */
+
+int main(int argc, char *argv[])
+{
+	Parameters_ parameters {};
+	parameters.imagePath = "fatfs_bench.img";
+	parameters.imageMegabytes = 64;
+	parameters.allocationUnit = 8192;		// 4 MB, typical for SDHC
+	parameters.kilobytes = 1024;
+	parameters.recordSize = _MAX_SS;
+	parameters.reads = 1000;
+	parameters.files = 100;
+	parameters.fileSize = 200;
+	parameters.model = {20000000, 100, 50, 250, 500};	// 20 MHz, like mmcSD_INTERFACE_FAST_CLOCK
+
+	if (parseArguments_(argc, argv, parameters) != 0)
+	{
+		usage_(argv[0]);
+		return 1;
+	}
+
+	for (size_t i = 0; i < sizeof(buffer_); i++)
+		buffer_[i] = i;
+
+	if (diskImageOpen(parameters.imagePath, parameters.imageMegabytes * 2048, parameters.allocationUnit) != 0)
+	{
+		perror(parameters.imagePath);
+		return 2;
+	}
+
+	diskImageSetLatencyModel(parameters.latencyModel == true ? &parameters.model : nullptr);
+
+	std::unique_ptr<FATFS> fs(new FATFS);
+	FRESULT result = f_mount(0, fs.get());
+	if (result == FR_OK)
+		result = f_mkfs(0, 0, 0);
+	if (result == FR_OK)
+		result = mount_(fs.get());
+	if (result != FR_OK)
+	{
+		fprintf(stderr, "Formatting of disk image failed - FatFS error %d\n", result);
+		diskImageClose();
+		return 2;
+	}
+
+	printf("%-14s %8s %10s %10s %10s %8s %8s %8s %8s %8s\n", "workload", "ops", "KB", "wall_ms", "model_ms", "rd_sect",
+			"wr_sect", "rd_cmd", "wr_cmd", "pe_sect");
+
+	if (result == FR_OK)
+		result = seqAppendBench_(parameters);
+	if (result == FR_OK)
+		result = logAppendBench_(parameters);
+	if (result == FR_OK)
+		result = randomReadBench_(parameters);
+	if (result == FR_OK)
+		result = smallFilesBench_(parameters);
+	if (result == FR_OK)
+		result = getfreeBench_(fs.get());
+	if (result == FR_OK)
+		result = firstAppendBench_(parameters);
+
+	f_mount(0, nullptr);
+	diskImageClose();
+
+	if (result != FR_OK)
+	{
+		fprintf(stderr, "Workload failed - FatFS error %d\n", result);
+		return 2;
+	}
+
+	return 0;
+}
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| Measurement_'s public methods
++---------------------------------------------------------------------------------------------------------------------*/
+
+Measurement_::Measurement_(const char * const name) :
+		name_{name},
+		start_{}
+{
+	disk_ioctl(0, CTRL_SYNC, nullptr);		// previous workload must not leave anything to this one
+	diskImageResetStatistics();
+	start_ = std::chrono::steady_clock::now();
+}
+
+FRESULT Measurement_::finish(const FRESULT result, const uint32_t operations, const uint64_t bytes)
+{
+	const auto wall = std::chrono::steady_clock::now() - start_;
+	DiskImageStatistics statistics;
+	diskImageGetStatistics(&statistics);
+
+	if (result != FR_OK)
+		return result;
+
+	printf("%-14s %8" PRIu32 " %10" PRIu64 " %10.3f %10.3f %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32
+			"\n", name_, operations, bytes / 1024,
+			std::chrono::duration_cast<std::chrono::microseconds>(wall).count() / 1000.0,
+			statistics.modeledUs / 1000.0, statistics.readSectors, statistics.writeSectors, statistics.readCommands,
+			statistics.writeCommands, statistics.preEraseSectors);
+
+	return result;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Appends records to a new file with f_write() as a measured workload.
+ *
+ * \param [in] name is the name of workload
+ * \param [in] path is the path of file
+ * \param [in] length is the amount of data to write, bytes
+ * \param [in] record_size is the size of single record, bytes
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT fileAppend_(const char * const name, const char * const path, const uint32_t length,
+		const uint32_t record_size)
+{
+	std::unique_ptr<FIL> file(new FIL);
+	uint32_t operations = 0;
+
+	Measurement_ measurement {name};
+
+	FRESULT result = f_open(file.get(), path, FA_WRITE | FA_CREATE_ALWAYS);
+	if (result != FR_OK)
+		return measurement.finish(result, 0, 0);
+
+	for (uint32_t written = 0; written < length && result == FR_OK; written += record_size, operations++)
+	{
+		const UINT size = length - written < record_size ? length - written : record_size;
+		UINT count;
+		result = f_write(file.get(), buffer_, size, &count);
+		if (result == FR_OK && count != size)
+			result = FR_DENIED;				// volume full
+	}
+
+	const FRESULT close_result = f_close(file.get());
+	return measurement.finish(result != FR_OK ? result : close_result, operations, length);
+}
+
+/**
+ * \brief first_append workload - appending records to a new file right after getfree workload.
+ *
+ * Volume is freshly mounted, so allocation starts from the hint in FSInfo (FAT32) or from the beginning of FAT.
+ *
+ * \param [in] parameters is a reference to parameters of benchmark
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT firstAppendBench_(const Parameters_ &parameters)
+{
+	return fileAppend_("first_append", firstAppendPath_, parameters.kilobytes * 1024 / 4, parameters.recordSize);
+}
+
+/**
+ * \brief getfree workload - f_getfree() on freshly mounted volume.
+ *
+ * \param [in] fs is a pointer to file system object of the volume
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT getfreeBench_(FATFS * const fs)
+{
+	FRESULT result = f_mount(0, nullptr);	// forget free cluster count
+	if (result == FR_OK)
+		result = mount_(fs);
+	if (result != FR_OK)
+		return result;
+
+	Measurement_ measurement {"getfree"};
+	DWORD free_clusters;
+	FATFS *fs_pointer;
+	result = f_getfree("", &free_clusters, &fs_pointer);
+	return measurement.finish(result, 1, 0);
+}
+
+/**
+ * \brief log_append workload - appending records to preallocated append-log.
+ *
+ * Time includes allocation of the log. Each allocation unit of the log must be announced for pre-erase once, with all
+ * its sectors within the log, so ACMD23 must cover exactly the whole log.
+ *
+ * \param [in] parameters is a reference to parameters of benchmark
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT logAppendBench_(const Parameters_ &parameters)
+{
+	const uint32_t length = parameters.kilobytes * 1024;
+	std::unique_ptr<AppendLog> log(new AppendLog);
+	uint32_t operations = 0;
+
+	Measurement_ measurement {"log_append"};
+
+	FRESULT result = appendLogOpen(log.get(), logAppendPath_, length);
+	if (result != FR_OK)
+		return measurement.finish(result, 0, 0);
+
+	for (uint32_t written = 0; written < length && result == FR_OK; written += parameters.recordSize, operations++)
+	{
+		const UINT size = length - written < parameters.recordSize ? length - written : parameters.recordSize;
+		result = appendLogWrite(log.get(), buffer_, size);
+	}
+
+	const FRESULT close_result = appendLogClose(log.get());
+	if (result == FR_OK)
+		result = close_result;
+
+	DiskImageStatistics statistics;
+	diskImageGetStatistics(&statistics);
+	const uint32_t pre_erase_sectors = parameters.allocationUnit > 1 ? (length + _MAX_SS - 1) / _MAX_SS : 0;
+	if (result == FR_OK && statistics.preEraseSectors != pre_erase_sectors)
+	{
+		fprintf(stderr, "log_append: %" PRIu32 " sectors announced for pre-erase, expected %" PRIu32 "\n",
+				statistics.preEraseSectors, pre_erase_sectors);
+		result = FR_INT_ERR;
+	}
+
+	return measurement.finish(result, operations, length);
+}
+
+/**
+ * \brief Mounts the volume and loads it, so that disk cache knows where FAT is.
+ *
+ * \param [in] fs is a pointer to file system object of the volume
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT mount_(FATFS * const fs)
+{
+	FRESULT result = f_mount(0, fs);
+	if (result != FR_OK)
+		return result;
+
+	DIR directory;
+	result = f_opendir(&directory, "");		// volume is loaded on first access
+	if (result == FR_OK)
+		diskCacheSetFatSectors(fs->fatbase, fs->fsize * fs->n_fats);
+
+	return result;
+}
+
+/**
+ * \brief Parses command line arguments.
+ *
+ * \param [in] argc is the number of arguments
+ * \param [in] argv is the array with arguments
+ * \param [in,out] parameters is a reference to parameters of benchmark, initialized with defaults
+ *
+ * \return 0 on success, -1 on invalid arguments
+ */
+
+int parseArguments_(const int argc, char *argv[], Parameters_ &parameters)
+{
+	int option;
+	while ((option = getopt(argc, argv, "i:m:a:k:r:n:f:s:lc:h")) != -1)
+	{
+		switch (option)
+		{
+		case 'i':
+			parameters.imagePath = optarg;
+			break;
+		case 'm':
+			parameters.imageMegabytes = strtoul(optarg, nullptr, 0);
+			break;
+		case 'a':
+			parameters.allocationUnit = strtoul(optarg, nullptr, 0);
+			break;
+		case 'k':
+			parameters.kilobytes = strtoul(optarg, nullptr, 0);
+			break;
+		case 'r':
+			parameters.recordSize = strtoul(optarg, nullptr, 0);
+			break;
+		case 'n':
+			parameters.reads = strtoul(optarg, nullptr, 0);
+			break;
+		case 'f':
+			parameters.files = strtoul(optarg, nullptr, 0);
+			break;
+		case 's':
+			parameters.fileSize = strtoul(optarg, nullptr, 0);
+			break;
+		case 'l':
+			parameters.latencyModel = true;
+			break;
+		case 'c':
+			parameters.model.clockHz = strtoul(optarg, nullptr, 0);
+			break;
+		default:
+			return -1;
+		}
+	}
+
+	if (optind != argc || parameters.imageMegabytes == 0 || parameters.imageMegabytes > 2048 ||
+			parameters.allocationUnit == 0 ||
+			parameters.kilobytes == 0 || parameters.kilobytes > parameters.imageMegabytes * 1024 / 4 ||
+			parameters.recordSize == 0 || parameters.recordSize > _MAX_SS || parameters.files > 9999 ||
+			parameters.fileSize > _MAX_SS || parameters.model.clockHz == 0)
+		return -1;
+
+	return 0;
+}
+
+/**
+ * \brief random_read workload - reading records from random offsets of the file written by seq_append.
+ *
+ * \param [in] parameters is a reference to parameters of benchmark
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT randomReadBench_(const Parameters_ &parameters)
+{
+	std::unique_ptr<FIL> file(new FIL);
+	const uint32_t records = parameters.kilobytes * 1024 / parameters.recordSize;
+	uint32_t operations = 0;
+
+	Measurement_ measurement {"random_read"};
+
+	FRESULT result = f_open(file.get(), seqAppendPath_, FA_READ);
+	if (result != FR_OK)
+		return measurement.finish(result, 0, 0);
+
+	for (; operations < parameters.reads && records != 0 && result == FR_OK; operations++)
+	{
+		result = f_lseek(file.get(), (random_() % records) * parameters.recordSize);
+		UINT count;
+		if (result == FR_OK)
+			result = f_read(file.get(), buffer_, parameters.recordSize, &count);
+	}
+
+	const FRESULT close_result = f_close(file.get());
+	return measurement.finish(result != FR_OK ? result : close_result, operations,
+			static_cast<uint64_t>(operations) * parameters.recordSize);
+}
+
+/**
+ * \brief Pseudo-random generator (LCG), independent of host's C library.
+ *
+ * \return next pseudo-random value, 31 bits
+ */
+
+uint32_t random_()
+{
+	randomState_ = randomState_ * 1103515245 + 12345;
+	return randomState_ >> 1;
+}
+
+/**
+ * \brief seq_append workload - appending records to a file with f_write().
+ *
+ * \param [in] parameters is a reference to parameters of benchmark
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT seqAppendBench_(const Parameters_ &parameters)
+{
+	return fileAppend_("seq_append", seqAppendPath_, parameters.kilobytes * 1024, parameters.recordSize);
+}
+
+/**
+ * \brief small_create, small_read and small_unlink workloads - many small files in a directory.
+ *
+ * \param [in] parameters is a reference to parameters of benchmark
+ *
+ * \return FR_OK on success, error code otherwise
+ */
+
+FRESULT smallFilesBench_(const Parameters_ &parameters)
+{
+	FRESULT result = f_mkdir(smallFilesDirectory_);
+	if (result != FR_OK)
+		return result;
+
+	std::unique_ptr<FIL> file(new FIL);
+	char path[sizeof(smallFilesDirectory_) + sizeof("/f4294967295.bin")];	// size for any uint32_t
+	const uint64_t bytes = static_cast<uint64_t>(parameters.files) * parameters.fileSize;
+
+	{
+		Measurement_ measurement {"small_create"};
+
+		for (uint32_t i = 0; i < parameters.files && result == FR_OK; i++)
+		{
+			snprintf(path, sizeof(path), "%s/f%04" PRIu32 ".bin", smallFilesDirectory_, i);
+			result = f_open(file.get(), path, FA_WRITE | FA_CREATE_NEW);
+			if (result != FR_OK)
+				break;
+
+			UINT count;
+			result = f_write(file.get(), buffer_, parameters.fileSize, &count);
+			const FRESULT close_result = f_close(file.get());
+			if (result == FR_OK)
+				result = close_result;
+		}
+
+		result = measurement.finish(result, parameters.files, bytes);
+	}
+
+	if (result == FR_OK)
+	{
+		Measurement_ measurement {"small_read"};
+
+		for (uint32_t i = 0; i < parameters.files && result == FR_OK; i++)
+		{
+			snprintf(path, sizeof(path), "%s/f%04" PRIu32 ".bin", smallFilesDirectory_, i);
+			result = f_open(file.get(), path, FA_READ);
+			if (result != FR_OK)
+				break;
+
+			UINT count;
+			result = f_read(file.get(), buffer_, parameters.fileSize, &count);
+			const FRESULT close_result = f_close(file.get());
+			if (result == FR_OK)
+				result = close_result;
+		}
+
+		result = measurement.finish(result, parameters.files, bytes);
+	}
+
+	if (result == FR_OK)
+	{
+		Measurement_ measurement {"small_unlink"};
+
+		for (uint32_t i = 0; i < parameters.files && result == FR_OK; i++)
+		{
+			snprintf(path, sizeof(path), "%s/f%04" PRIu32 ".bin", smallFilesDirectory_, i);
+			result = f_unlink(path);
+		}
+
+		if (result == FR_OK)
+			result = f_unlink(smallFilesDirectory_);
+
+		result = measurement.finish(result, parameters.files, 0);
+	}
+
+	return result;
+}
+
+/**
+ * \brief Displays usage of benchmark.
+ *
+ * \param [in] program is the name of program
+ */
+
+void usage_(const char * const program)
+{
+	fprintf(stderr, "usage: %s [-i image] [-m megabytes] [-a sectors] [-k kilobytes] [-r record_size] [-n reads] "
+			"[-f files] [-s file_size] [-l] [-c clock]\n"
+			"\t-i image - path of disk image file, created on each run, default = fatfs_bench.img\n"
+			"\t-m megabytes - size of disk image, [1; 2048], default = 64\n"
+			"\t-a sectors - allocation unit of disk image, default = 8192 (4 MB)\n"
+			"\t-k kilobytes - amount of data written by seq_append and log_append (1/4 of it by first_append), at most "
+			"1/4 of image, default = 1024\n"
+			"\t-r record_size - size of record of seq_append, log_append, random_read and first_append in bytes, "
+			"[1; 512], default = 512\n"
+			"\t-n reads - number of reads of random_read, default = 1000\n"
+			"\t-f files - number of files of small_* workloads, [0; 9999], default = 100\n"
+			"\t-s file_size - size of each file of small_* workloads in bytes, [0; 512], default = 200\n"
+			"\t-l - enable latency model of SD card in SPI mode\n"
+			"\t-c clock - SPI clock of latency model in Hz, default = 20000000\n", program);
+}
+
+}	// namespace
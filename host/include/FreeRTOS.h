@@ -0,0 +1,56 @@
+/**
+ * \file FreeRTOS.h
+ * \brief Minimal replacement of FreeRTOS.h for host build of the storage stack
+ *
+ * Host build is single-threaded - only types, constants and configuration used by FatFS, disk cache and UART syscalls
+ * are provided. Storage tunables mirror configuration/FreeRTOSConfig.h and can be overridden from make command line.
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef FREERTOS_HOST_H_
+#define FREERTOS_HOST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global defines
++---------------------------------------------------------------------------------------------------------------------*/
+
+#define pdFALSE								0
+#define pdTRUE								1
+
+#define configTICK_RATE_HZ					1000
+#define portTICK_RATE_MS					(1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY						UINT32_MAX
+
+#ifndef HOST_SD_CACHE_SECTORS
+#define HOST_SD_CACHE_SECTORS				2
+#endif
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global types
++---------------------------------------------------------------------------------------------------------------------*/
+
+typedef uint32_t portTickType;
+typedef long portBASE_TYPE;
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| UART stream
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// how long blocking read from UART waits for data before returning end-of-file, milliseconds, 0 - wait forever
+enum { UART_READ_TIMEOUT_MS = 0 };
+
+/// size of buffer of UART streams, bytes
+enum { STREAM_BUFFER_SIZE = 128 };
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| SD card files
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// number of sectors in write-back cache between FatFS and SD card, FAT sectors are kept in preference to others
+enum { SD_CACHE_SECTORS = HOST_SD_CACHE_SECTORS };
+
+#endif	// FREERTOS_HOST_H_
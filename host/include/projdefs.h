@@ -0,0 +1,20 @@
+/**
+ * \file projdefs.h
+ * \brief Minimal replacement of projdefs.h for host build of UART syscalls
+ *
+ * Only constants used by configuration/error.h are provided.
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef PROJDEFS_HOST_H_
+#define PROJDEFS_HOST_H_
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global defines
++---------------------------------------------------------------------------------------------------------------------*/
+
+#define pdPASS								pdTRUE
+#define pdFAIL								pdFALSE
+
+#endif	// PROJDEFS_HOST_H_
@@ -0,0 +1,21 @@
+/**
+ * \file reent.h
+ * \brief Replacement of newlib's reent.h for host build of UART syscalls
+ *
+ * Syscalls of the target take newlib's reentrancy structure, which glibc doesn't have. It is only passed by pointer,
+ * so forward declaration is enough - this header is force-included (-include reent.h), as configuration/sys_fd.h
+ * relies on stdio.h of newlib to declare the structure.
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef REENT_HOST_H_
+#define REENT_HOST_H_
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global types
++---------------------------------------------------------------------------------------------------------------------*/
+
+struct _reent;
+
+#endif	// REENT_HOST_H_
@@ -0,0 +1,64 @@
+/**
+ * \file semphr.h
+ * \brief Minimal replacement of semphr.h for host build of the storage stack
+ *
+ * Host build is single-threaded, so mutexes are always free.
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef SEMPHR_HOST_H_
+#define SEMPHR_HOST_H_
+
+#include "FreeRTOS.h"
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global types
++---------------------------------------------------------------------------------------------------------------------*/
+
+typedef void * xSemaphoreHandle;
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Creates mutex.
+ *
+ * \return handle of mutex, never NULL
+ */
+
+static inline xSemaphoreHandle xSemaphoreCreateMutex(void)
+{
+	static char mutex;
+	return &mutex;
+}
+
+/**
+ * \brief Takes semaphore.
+ *
+ * \return pdTRUE
+ */
+
+static inline portBASE_TYPE xSemaphoreTake(xSemaphoreHandle semaphore, portTickType ticks_to_wait)
+{
+	(void)semaphore;	// suppress warning
+	(void)ticks_to_wait;	// suppress warning
+
+	return pdTRUE;
+}
+
+/**
+ * \brief Gives semaphore.
+ *
+ * \return pdTRUE
+ */
+
+static inline portBASE_TYPE xSemaphoreGive(xSemaphoreHandle semaphore)
+{
+	(void)semaphore;	// suppress warning
+
+	return pdTRUE;
+}
+
+#endif	// SEMPHR_HOST_H_
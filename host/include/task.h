@@ -0,0 +1,22 @@
+/**
+ * \file task.h
+ * \brief Minimal replacement of task.h for host build of the storage stack
+ *
+ * Host build is single-threaded, so critical sections are empty.
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef TASK_HOST_H_
+#define TASK_HOST_H_
+
+#include "FreeRTOS.h"
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global defines
++---------------------------------------------------------------------------------------------------------------------*/
+
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+#endif	// TASK_HOST_H_
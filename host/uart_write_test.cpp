@@ -0,0 +1,254 @@
+/**
+ * \file uart_write_test.cpp
+ * \brief Test of copies made by uart_write_r() on the host
+ *
+ * configuration/sys_fd.c runs unmodified on top of stub USART driver, which models TX ring buffer of the target -
+ * usartSendBytes() reserves at most half of the ring at once and copies data into it, DMA drains the ring when there's
+ * no space. Stub counts bytes copied by the CPU - copies into the ring and bytes passed from any buffer other than the
+ * caller's one, which must have been copied there by uart_write_r() - and collects drained data. For each written
+ * buffer - text, binary with embedded '\0' bytes, all zeros, longer than the ring - the test checks that all bytes
+ * reach the ring unchanged (including '\0') and that exactly one byte is copied per byte written.
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "config.h"
+#include "io_syscalls.h"
+#include "usart.h"
+
+extern "C"
+{
+#include "sys_fd.h"
+}
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local defines
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// tested port - USART2, /dev/uart1
+#define UART_WRITE_TEST_PORT_				1
+
+/// size of TX ring buffer of tested port, bytes
+#define UART_WRITE_TEST_TX_RING_SIZE_		USART2_TX_RING_SIZE
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// single test case
+struct Case_
+{
+	const char *name;						///< name of test case
+	std::vector<char> data;					///< data written with single uart_write_r() call
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+void drain_();
+bool runCase_(int file_descriptor, const Case_ &test_case);
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// TX ring buffer
+char txRing_[UART_WRITE_TEST_TX_RING_SIZE_];
+
+/// number of bytes in TX ring buffer waiting for "DMA"
+size_t txUsed_;
+
+/// data drained from TX ring buffer by "DMA"
+std::vector<char> sent_;
+
+/// number of bytes copied by the CPU - into TX ring buffer and to intermediate buffers
+size_t copiedBytes_;
+
+/// buffer passed to uart_write_r()
+const char *writeBuffer_;
+
+/// size of buffer passed to uart_write_r(), bytes
+size_t writeSize_;
+
+}	// namespace
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Main code block of test.
+ *
+ * \return 0 if all test cases passed, 1 otherwise
+ */
+
+int main()
+{
+	std::vector<Case_> cases;
+
+	const char text[] = "sd_stats\r\nRead: 2048 sectors in 120 ms = 8533 KB/s\r\n";
+	cases.push_back({"text", std::vector<char>(text, text + sizeof(text) - 1)});
+
+	const char binary[] = {'\x7e', '\x00', '\x01', '\x00', '\x00', 'a', '\x00', '\xff', '\x00'};
+	cases.push_back({"binary", std::vector<char>(binary, binary + sizeof(binary))});
+
+	cases.push_back({"zeros", std::vector<char>(STREAM_BUFFER_SIZE, '\0')});
+
+	std::vector<char> long_data(UART_WRITE_TEST_TX_RING_SIZE_ * 3 + 7);
+	for (size_t i = 0; i < long_data.size(); i++)
+		long_data[i] = i % 7 == 0 ? '\0' : i;
+	cases.push_back({"longer_than_ring", long_data});
+
+	const int file_descriptor = uart_open_r(nullptr, "/dev/uart1", O_WRONLY | O_NONBLOCK, 0);
+	if (file_descriptor == -1)
+	{
+		fprintf(stderr, "uart_open_r() failed\n");
+		return 1;
+	}
+
+	printf("%-18s %8s %8s %12s %s\n", "case", "written", "copied", "copies/byte", "result");
+
+	bool passed = true;
+	for (const Case_ &test_case : cases)
+		passed = runCase_(file_descriptor, test_case) == true && passed == true;
+
+	return passed == true ? 0 : 1;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| stub USART driver and I/O syscalls
++---------------------------------------------------------------------------------------------------------------------*/
+
+enum Error usartInitialize(size_t)
+{
+	return ERROR_NONE;
+}
+
+void usartSetEventCallback(UsartEventCallback)
+{
+
+}
+
+size_t usartGetRxAvailable(size_t)
+{
+	return 0;
+}
+
+size_t usartGetTxSpace(const size_t port)
+{
+	return port == UART_WRITE_TEST_PORT_ ? sizeof(txRing_) - txUsed_ : 0;
+}
+
+size_t usartReceiveBytes(size_t, char *, size_t, portTickType)
+{
+	return 0;
+}
+
+/**
+ * \brief Copies data to TX ring buffer, like usartSendBytes() of the target.
+ *
+ * At most half of the ring is reserved at once, "DMA" drains the ring when there's not enough space.
+ */
+
+enum Error usartSendBytes(const size_t port, const char *data, size_t length, portTickType)
+{
+	if (port != UART_WRITE_TEST_PORT_)
+		return ERROR_USART_PORT_NOT_AVAILABLE;
+
+	if (data < writeBuffer_ || data + length > writeBuffer_ + writeSize_)	// intermediate copy of caller's data?
+		copiedBytes_ += length;
+
+	while (length != 0)
+	{
+		const size_t chunk = length < sizeof(txRing_) / 2 ? length : sizeof(txRing_) / 2;
+
+		if (sizeof(txRing_) - txUsed_ < chunk)
+			drain_();
+
+		memcpy(&txRing_[txUsed_], data, chunk);
+		txUsed_ += chunk;
+		copiedBytes_ += chunk;
+
+		data += chunk;
+		length -= chunk;
+	}
+
+	return ERROR_NONE;
+}
+
+/**
+ * \brief Sends zero terminated string, like usartSendString() of the target.
+ */
+
+enum Error usartSendString(const size_t port, const char * const string, const portTickType ticks_to_wait)
+{
+	return usartSendBytes(port, string, strlen(string), ticks_to_wait);
+}
+
+void ioSyscallsNotifyFromISR(portBASE_TYPE *)
+{
+
+}
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Moves contents of TX ring buffer to sent data, like DMA of the target - not counted as CPU copy.
+ */
+
+void drain_()
+{
+	sent_.insert(sent_.end(), txRing_, txRing_ + txUsed_);
+	txUsed_ = 0;
+}
+
+/**
+ * \brief Writes data of test case with single uart_write_r() call and checks the result.
+ *
+ * \param [in] file_descriptor is the private file descriptor returned by uart_open_r()
+ * \param [in] test_case is a reference to test case
+ *
+ * \return true if test case passed, false otherwise
+ */
+
+bool runCase_(const int file_descriptor, const Case_ &test_case)
+{
+	sent_.clear();
+	txUsed_ = 0;
+	copiedBytes_ = 0;
+	writeBuffer_ = test_case.data.data();
+	writeSize_ = test_case.data.size();
+
+	const ssize_t ret = uart_write_r(nullptr, file_descriptor, test_case.data.data(), test_case.data.size());
+	drain_();
+
+	const char *error = nullptr;
+	if (ret != static_cast<ssize_t>(test_case.data.size()))
+		error = "wrong return value";
+	else if (sent_ != test_case.data)
+		error = "sent data differs from written data";
+	else if (copiedBytes_ != test_case.data.size())
+		error = "more than one copy per byte";
+
+	printf("%-18s %8zu %8zu %12.3f %s\n", test_case.name, test_case.data.size(), copiedBytes_,
+			static_cast<double>(copiedBytes_) / test_case.data.size(), error == nullptr ? "ok" : error);
+
+	return error == nullptr;
+}
+
+}	// namespace
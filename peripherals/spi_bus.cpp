@@ -0,0 +1,301 @@
+/**
+ * \file spi_bus.cpp
+ * \brief SPI bus manager
+ *
+ * Owns SPI peripheral shared by several devices. Each device is described by SpiDevice struct with its chip select
+ * pin, baud rate and mode. Task acquires the bus for the device, does any number of transfers and releases the bus -
+ * everything between acquire and release is atomic with respect to other tasks, which wait for the bus in order of
+ * their priorities. SPI is reconfigured only when the bus is acquired for a different device than previously.
+ *
+ * Device may release the bus and stay selected (e.g. SD card in the middle of multi-block transfer), so that it can
+ * continue its operation later. If the bus is acquired for other device in the meantime, deselect hook of the device
+ * is called first.
+ *
+ * chip: STM32L1xx; prefix: spiBus
+ *
+ * \author: Mazeryt Freager
+ */
+
+#include <cstdint>
+#include <cstddef>
+
+#include "stm32l152xc.h"
+
+#include "hdr/hdr_spi.h"
+
+#include "config.h"
+
+#include "gpio.h"
+#include "rcc.h"
+#include "spi.h"
+#include "spi_dma_rtos.h"
+#include "spi_bus.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+static void _configure(const SpiDevice *device);
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// mutex guarding the bus
+static xSemaphoreHandle _mutex;
+
+/// device which currently owns the bus, nullptr if none
+static const SpiDevice *_owner;
+
+/// device for which SPI is currently configured, nullptr if none
+static const SpiDevice *_configured;
+
+/// device which released the bus and stayed selected, nullptr if none
+static const SpiDevice *_selected;
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Initializes SPI bus.
+ *
+ * Initializes SPI with DMA and creates mutex of the bus. Can be called several times - by each driver of device on the
+ * bus - only the first call has any effect.
+ *
+ * \return ERROR_NONE on success, error code otherwise
+ */
+
+enum Error spiBusInitialize(void)
+{
+	if (_mutex != nullptr)					// already initialized?
+		return ERROR_NONE;
+
+	const enum Error error = spiDmaInitialize();
+	if (error != ERROR_NONE)
+		return error;
+
+	_configured = nullptr;
+
+	_mutex = xSemaphoreCreateMutex();
+	if (_mutex == nullptr)
+		return ERROR_FreeRTOS_errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+
+	return ERROR_NONE;
+}
+
+/**
+ * \brief Configures chip select pin of device and deselects the device.
+ *
+ * \param [in] device is a pointer to descriptor of device
+ */
+
+void spiBusDeviceInitialize(const SpiDevice * const device)
+{
+	device->csGpio->BSRR = 1 << device->csPin;	// deselect first, so that there's no glitch on the line
+	gpioConfigurePin(device->csGpio, device->csPin, GPIO_OUT_PP_10MHz_PULL_UP);
+}
+
+/**
+ * \brief Acquires the bus for the device.
+ *
+ * If other device was left selected by spiBusReleaseSelected(), its deselect hook is called and it is deselected. If the
+ * device is different than the one for which SPI is currently configured, SPI is reconfigured with device's baud rate
+ * and mode. Device is not selected - use spiBusSelect() - unless it was left selected by itself.
+ *
+ * \param [in] device is a pointer to descriptor of device, it must be available until spiBusRelease() is called
+ * \param [in] ticks_to_wait is the amount of time to wait for the bus, use portMAX_DELAY to suspend
+ *
+ * \return ERROR_NONE on success, ERROR_SPI_TIMEOUT if bus could not be acquired
+ */
+
+enum Error spiBusAcquire(const SpiDevice * const device, const portTickType ticks_to_wait)
+{
+	if (xSemaphoreTake(_mutex, ticks_to_wait) != pdTRUE)
+		return ERROR_SPI_TIMEOUT;
+
+	if (_selected != nullptr && _selected != device)
+	{
+		_owner = _selected;					// SPI is still configured for this device
+		_owner->deselectHook();
+		spiBusDeselect();
+	}
+
+	_selected = nullptr;
+	_owner = device;
+
+	if (_configured != device)
+		_configure(device);
+
+	return ERROR_NONE;
+}
+
+/**
+ * \brief Deselects the device which owns the bus and releases the bus.
+ */
+
+void spiBusRelease(void)
+{
+	spiBusDeselect();
+	_owner = nullptr;
+	xSemaphoreGive(_mutex);
+}
+
+/**
+ * \brief Releases the bus, but leaves the device which owns it selected.
+ *
+ * Device must have deselect hook.
+ */
+
+void spiBusReleaseSelected(void)
+{
+	_selected = _owner;
+	_owner = nullptr;
+	xSemaphoreGive(_mutex);
+}
+
+/**
+ * \brief Selects the device which owns the bus - drives its chip select low.
+ */
+
+void spiBusSelect(void)
+{
+	_owner->csGpio->BSRR = 1 << (_owner->csPin + 16);
+}
+
+/**
+ * \brief Deselects the device which owns the bus - drives its chip select high.
+ */
+
+void spiBusDeselect(void)
+{
+	_owner->csGpio->BSRR = 1 << _owner->csPin;
+}
+
+/**
+ * \brief Changes baud rate of device.
+ *
+ * If the device owns the bus, SPI is reconfigured immediately, otherwise new baud rate is used when the bus is acquired
+ * for the device.
+ *
+ * \param [in,out] device is a pointer to descriptor of device
+ * \param [in] baud_rate is new max baud rate of device, Hz
+ */
+
+void spiBusSetBaudRate(SpiDevice * const device, const uint32_t baud_rate)
+{
+	device->baudRate = baud_rate;
+
+	if (_owner == device)
+		_configure(device);
+	else if (_configured == device)
+		_configured = nullptr;				// force reconfiguration on next acquire
+}
+
+/**
+ * \brief Transfers data through SPI with polling.
+ *
+ * Best for short transfers, like commands and responses. Bus must be acquired.
+ *
+ * \param [in] tx is the pointer to transferred data buffer, nullptr if blank bytes should be transferred (0xFF)
+ * \param [out] rx is the pointer to received data buffer, nullptr if received data should be discarded
+ * \param [in] length is the length of transfer in bytes
+ *
+ * \return transfer length in bytes, should be equal to parameter length
+ */
+
+size_t spiBusTransfer(const uint8_t * const tx, uint8_t * const rx, const size_t length)
+{
+	return spiTransfer(tx, rx, length);
+}
+
+/**
+ * \brief Transfers data through SPI with DMA.
+ *
+ * Calling task is blocked until the transfer is finished, so it's best for long transfers. Bus must be acquired.
+ *
+ * \param [in] tx is the pointer to transferred data buffer, nullptr if blank bytes should be transferred (0xFF)
+ * \param [out] rx is the pointer to received data buffer, nullptr if received data should be discarded
+ * \param [in] length is the length of transfer in bytes
+ * \param [in] ticks_to_wait is the amount of time to wait for the transfer to finish
+ *
+ * \return ERROR_NONE on success, error code otherwise
+ */
+
+enum Error spiBusTransferDma(const uint8_t * const tx, uint8_t * const rx, const size_t length,
+		const portTickType ticks_to_wait)
+{
+	return spiDmaTransfer(tx, rx, length, ticks_to_wait);
+}
+
+/**
+ * \brief Executes transaction - sequence of transfers with the device selected.
+ *
+ * Bus is acquired, device is selected, transfers are executed (with DMA if they are at least
+ * SPI_BUS_DMA_LENGTH_THRESHOLD bytes long), device is deselected and bus is released.
+ *
+ * \param [in] device is a pointer to descriptor of device
+ * \param [in] transfers is the array with transfers
+ * \param [in] count is the number of elements in transfers array
+ * \param [in] ticks_to_wait is the amount of time to wait for the bus and for each DMA transfer
+ *
+ * \return ERROR_NONE on success, error code otherwise
+ */
+
+enum Error spiBusTransaction(const SpiDevice * const device, const SpiTransfer * const transfers, const size_t count,
+		const portTickType ticks_to_wait)
+{
+	enum Error error = spiBusAcquire(device, ticks_to_wait);
+	if (error != ERROR_NONE)
+		return error;
+
+	spiBusSelect();
+
+	for (size_t i = 0; i < count && error == ERROR_NONE; i++)
+	{
+		const SpiTransfer &transfer = transfers[i];
+
+		if (transfer.length >= SPI_BUS_DMA_LENGTH_THRESHOLD)
+			error = spiBusTransferDma(transfer.tx, transfer.rx, transfer.length, ticks_to_wait);
+		else
+			spiBusTransfer(transfer.tx, transfer.rx, transfer.length);
+	}
+
+	spiBusRelease();
+
+	return error;
+}
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Configures SPI for the device.
+ *
+ * Baud rate is the highest one which doesn't exceed baud rate of device.
+ *
+ * \param [in] device is a pointer to descriptor of device
+ */
+
+static void _configure(const SpiDevice * const device)
+{
+	uint32_t real_baud_rate = rccGetCoreFrequency() / 2;	// max baud rate is f_PCLK / 2
+	uint32_t br = 0;
+
+	while (real_baud_rate > device->baudRate && br < 7)	// max br value is 7, so enter the loop only if br is lower
+	{
+		real_baud_rate /= 2;
+		br++;
+	}
+
+	while (SPIx_SR_BSY_bb(SPIx));			// wait for the end of last transfer
+
+	SPIx->CR1 &= ~SPI_CR1_SPE;				// clock polarity and phase can be changed only when SPI is disabled
+	SPIx->CR1 = (SPIx->CR1 & ~(SPI_CR1_BR | SPI_CR1_CPOL | SPI_CR1_CPHA)) | (br << SPI_CR1_BR_bit) | device->mode;
+	SPIx->CR1 |= SPI_CR1_SPE;
+
+	_configured = device;
+}
@@ -0,0 +1,78 @@
+/**
+ * \file spi_bus.h
+ * \brief Header for spi_bus.cpp
+ * \author: Mazeryt Freager
+ */
+
+#ifndef SPI_BUS_H_
+#define SPI_BUS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "stm32l152xc.h"
+
+#include "FreeRTOS.h"
+
+#include "gpio.h"
+#include "error.h"
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global defines
++---------------------------------------------------------------------------------------------------------------------*/
+
+#define spiBusRead(rx, length)				spiBusTransfer(nullptr, (rx), (length))
+#define spiBusWrite(tx, length)				spiBusTransfer((tx), nullptr, (length))
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// SPI mode - clock polarity and phase, values are bits of SPI_CR1
+enum SpiMode
+{
+	SPI_MODE_0 = 0,								///< CPOL = 0, CPHA = 0
+	SPI_MODE_1 = SPI_CR1_CPHA,					///< CPOL = 0, CPHA = 1
+	SPI_MODE_2 = SPI_CR1_CPOL,					///< CPOL = 1, CPHA = 0
+	SPI_MODE_3 = SPI_CR1_CPOL | SPI_CR1_CPHA,	///< CPOL = 1, CPHA = 1
+};
+
+/// descriptor of device on SPI bus
+struct SpiDevice
+{
+	GPIO_TypeDef *csGpio;					///< port of chip select pin
+	enum GpioPin csPin;						///< chip select pin, active low
+	uint32_t baudRate;						///< max baud rate of device, Hz
+	enum SpiMode mode;						///< clock polarity and phase
+	/// called when the bus is acquired for other device while this device was left selected with
+	/// spiBusReleaseSelected() - should end the operation of device, which is deselected afterwards; nullptr if device
+	/// is never left selected
+	void (*deselectHook)(void);
+};
+
+/// single transfer of transaction
+struct SpiTransfer
+{
+	const uint8_t *tx;						///< data to send, nullptr if blank bytes should be sent (0xFF)
+	uint8_t *rx;							///< buffer for received data, nullptr if data should be discarded
+	size_t length;							///< length of transfer in bytes
+};
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+enum Error spiBusInitialize(void);
+void spiBusDeviceInitialize(const SpiDevice *device);
+enum Error spiBusAcquire(const SpiDevice *device, portTickType ticks_to_wait);
+void spiBusRelease(void);
+void spiBusReleaseSelected(void);
+void spiBusSelect(void);
+void spiBusDeselect(void);
+void spiBusSetBaudRate(SpiDevice *device, uint32_t baud_rate);
+size_t spiBusTransfer(const uint8_t *tx, uint8_t *rx, size_t length);
+enum Error spiBusTransferDma(const uint8_t *tx, uint8_t *rx, size_t length, portTickType ticks_to_wait);
+enum Error spiBusTransaction(const SpiDevice *device, const SpiTransfer *transfers, size_t count,
+		portTickType ticks_to_wait);
+
+#endif /* SPI_BUS_H_ */
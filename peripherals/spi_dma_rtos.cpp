@@ -1,9 +1,17 @@
+/**
+ * \file spi_dma_rtos.cpp
+ * \brief SPI driver with DMA transfers
+ *
+ * Full-duplex transfers are done by TX and RX DMA channels directly on caller's buffers - no copies are made. Calling
+ * task is blocked until the transfer completes, so other tasks can run in the meantime.
+ *
+ * chip: STM32L1xx; prefix: spiDma
+ *
+ * \author: Mazeryt Freager
+ */
+
 #include <cstdint>
 #include <cstddef>
-#include <stdint.h>
-#include <string.h>
-#include <stdarg.h>
-#include <stdio.h>
 
 #include "stm32l152xc.h"
 
@@ -13,359 +21,209 @@
 
 #include "config.h"
 
-#include "portmacro.h"
 #include "gpio.h"
-#include "rcc.h"
-#include "spi.h"
 #include "FreeRTOS.h"
-#include "queue.h"
 #include "semphr.h"
 #include "error.h"
-#include "task.h"
 #include "spi_dma_rtos.h"
 
 /*---------------------------------------------------------------------------------------------------------------------+
-| local functions' declarations
+| local defines
 +---------------------------------------------------------------------------------------------------------------------*/
 
-static void spiTxTask(void *parameters);
-static void spiTestTask(void *parameters);
-static void spiTransferTask(void *parameters);
-
-/*---------------------------------------------------------------------------------------------------------------------+
- | local variables' types
- +---------------------------------------------------------------------------------------------------------------------*/
-
-struct spiRxMessage
-{
-	uint8_t *rx;
-	uint32_t length;
-};
+/// max length of single DMA transfer - CNDTR register is 16-bit
+#define SPI_DMA_TRANSFER_LENGTH_MAX_			UINT16_MAX
 
-struct spiMessage
-{
-	uint32_t length;
-	uint8_t * data;
-	uint8_t direction;
-};
+/// byte sent when transfer has no TX buffer
+#define SPI_DMA_TX_FILL_						0xFF
 
 /*---------------------------------------------------------------------------------------------------------------------+
- | local defines
- +---------------------------------------------------------------------------------------------------------------------*/
-
-#define SPI_INPUT_BUFFER_SIZE					128
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
 
+static enum Error _transferChunk(const uint8_t *tx, uint8_t *rx, size_t length, portTickType ticks_to_wait);
 
 /*---------------------------------------------------------------------------------------------------------------------+
- | local variables
- +---------------------------------------------------------------------------------------------------------------------*/
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
 
-extern char __ram_start[];					// imported from linker script
+/// source of TX DMA channel when transfer has no TX buffer
+static const uint8_t _txFill = SPI_DMA_TX_FILL_;
 
-static uint8_t spiInputBuffer[SPI_INPUT_BUFFER_SIZE];
-static uint8_t spiInputBufferIndex=0;
+/// destination of RX DMA channel when transfer has no RX buffer
+static uint8_t _rxDiscard;
 
-static xQueueHandle spiRxQueue;
-static xQueueHandle spiMessageQueue;
+/// mutex guarding access to SPI and its DMA channels
+static xSemaphoreHandle _mutex;
 
-static xSemaphoreHandle spiTxDmaSemaphore;
-static xSemaphoreHandle spiRxDmaSemaphore;
+/// semaphore given by RX DMA channel interrupt when transfer is finished
+static xSemaphoreHandle _transferSemaphore;
 
+/// true if last transfer finished with DMA error
+static volatile bool _transferError;
 
 /*---------------------------------------------------------------------------------------------------------------------+
- | global functions
- +---------------------------------------------------------------------------------------------------------------------*/
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Initializes SPI with DMA transfers.
+ *
+ * Chip selects of devices are not handled here - they are driven by spi_bus. SPI clock is set to max value, spi_bus
+ * configures clock and mode of each device when the device acquires the bus (see spiBusSetBaudRate()).
+ *
+ * \return ERROR_NONE on success, error code otherwise
+ */
 
-void spiDmaInitialize(void)
+enum Error spiDmaInitialize(void)
 {
-	// Configuring GPIO
-	gpioConfigurePin(SPIx_CS_GPIO, SPIx_CS_PIN, SPIx_CS_CONFIGURATION);
 	gpioConfigurePin(SPIx_MISO_GPIO, SPIx_MISO_PIN, SPIx_MISO_CONFIGURATION);
 	gpioConfigurePin(SPIx_MOSI_GPIO, SPIx_MOSI_PIN, SPIx_MOSI_CONFIGURATION);
 	gpioConfigurePin(SPIx_SCK_GPIO, SPIx_SCK_PIN, SPIx_SCK_CONFIGURATION);
 
-	// Configuring SPI
-	RCC_APBxENR_SPIxEN_bb = 1;
-
-	SPIx->CR1 |= /*SPI_CR1_SSM | SPI_CR1_SSI |*/ SPI_CR1_SPE | SPI_CR1_MSTR;	// enable SPI, master mode
-	SPIx->CR2 |= SPI_CR2_TXDMAEN | SPI_CR2_RXDMAEN | SPI_CR2_SSOE;  	// enable Tx buffer DMA and Rx buffer DMA
-
-	for(int i=0;i<1000;i++);
+	_mutex = xSemaphoreCreateMutex();
+	if (_mutex == NULL)
+		return ERROR_FreeRTOS_errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
 
-	// DMA
-	RCC_AHBENR_SPIx_DMAxEN_bb = 1;				// enable DMA
+	vSemaphoreCreateBinary(_transferSemaphore);
+	if (_transferSemaphore == NULL)
+		return ERROR_FreeRTOS_errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
 
-	// DMA interrupts
-	NVIC_SetPriority(SPIx_DMAx_TX_CH_IRQn, SPIx_DMAx_TX_CH_IRQ_PRIORITY);	// set DMA IRQ priority
-	NVIC_EnableIRQ(SPIx_DMAx_TX_CH_IRQn);				// enable DMA TX IRQ
+	xSemaphoreTake(_transferSemaphore, 0);	// semaphore is created "given"
 
-	NVIC_SetPriority(SPIx_DMAx_RX_CH_IRQn, SPIx_DMAx_RX_CH_IRQ_PRIORITY);	// set DMA IRQ priority
-	NVIC_EnableIRQ(SPIx_DMAx_RX_CH_IRQn);				// enable DMA RX IRQ
+	RCC_APBxENR_SPIxEN_bb = 1;
 
-	vSemaphoreCreateBinary(spiTxDmaSemaphore);
-	vSemaphoreCreateBinary(spiRxDmaSemaphore);
+	SPIx->CR1 = SPI_CR1_SSM | SPI_CR1_SSI | SPI_CR1_SPE | SPI_CR1_MSTR;	// software slave management, enable SPI, master mode
 
-	spiRxQueue = xQueueCreate(SPIx_RX_QUEUE_LENGTH, sizeof(struct spiRxMessage));
-	spiMessageQueue = xQueueCreate(SPIx_TX_QUEUE_LENGTH, sizeof(struct spiMessage));
+	RCC_AHBENR_SPIx_DMAxEN_bb = 1;
 
-	xTaskCreate(spiTestTask, (signed char* )"SPI TEST", SPI_TX_STACK_SIZE,
-					NULL, SPI_TX_TASK_PRIORITY, NULL);
+	// only RX channel interrupt is used - RX channel finishes last, when all bytes are clocked in
+	NVIC_SetPriority(SPIx_DMAx_RX_CH_IRQn, SPIx_DMAx_RX_CH_IRQ_PRIORITY);
+	NVIC_EnableIRQ(SPIx_DMAx_RX_CH_IRQn);
 
-	xTaskCreate(spiTransferTask, (signed char* )"SPI TRANSFER", SPI_TX_STACK_SIZE,
-						NULL, SPI_TX_TASK_PRIORITY, NULL);
+	return ERROR_NONE;
 }
 
-uint32_t spiDmaSetBaudRate(uint32_t baud_rate)
+/**
+ * \brief Transfers data through SPI with DMA.
+ *
+ * Bidirectional transfer of data (simultaneous tx and rx) done by DMA directly on given buffers. Calling task is
+ * blocked until the whole transfer is finished. Transfers longer than 65535 bytes are split into several DMA transfers.
+ *
+ * \param [in] tx is the pointer to transferred data buffer, nullptr if blank bytes should be transferred (0xFF)
+ * \param [out] rx is the pointer to received data buffer, nullptr if received data should be discarded
+ * \param [in] length is the length of transfer in bytes
+ * \param [in] ticks_to_wait is the amount of time to wait for access to SPI and then for each DMA transfer to finish,
+ * use portMAX_DELAY to suspend
+ *
+ * \return ERROR_NONE on success, error code otherwise
+ */
+
+enum Error spiDmaTransfer(const uint8_t * const tx, uint8_t * const rx, const size_t length,
+		const portTickType ticks_to_wait)
 {
-	uint32_t real_baud_rate = rccGetCoreFrequency() / 2;	// max baud rate is f_PCLK / 2
-	uint32_t br = 0;
+	if (xSemaphoreTake(_mutex, ticks_to_wait) != pdTRUE)
+		return ERROR_SPI_TIMEOUT;
+
+	enum Error error = ERROR_NONE;
 
-	while (real_baud_rate > baud_rate && br < 7)	// max br value is 7, so enter the loop only if br is lower
+	for (size_t offset = 0; offset < length && error == ERROR_NONE; offset += SPI_DMA_TRANSFER_LENGTH_MAX_)
 	{
-		real_baud_rate /= 2;
-		br++;
+		const size_t chunk = length - offset < SPI_DMA_TRANSFER_LENGTH_MAX_ ? length - offset :
+				SPI_DMA_TRANSFER_LENGTH_MAX_;
+		error = _transferChunk(tx != nullptr ? tx + offset : nullptr, rx != nullptr ? rx + offset : nullptr, chunk,
+				ticks_to_wait);
 	}
 
-	SPIx->CR1 = (SPIx->CR1 & ~SPI_CR1_BR) | (br << SPI_CR1_BR_bit);
+	xSemaphoreGive(_mutex);
 
-	return real_baud_rate;
-}
-
-void spiDmaStart()
-{
-	SPIx_CS_bb = 0;
-}
-
-void spiDmaStop()
-{
-	SPIx_CS_bb = 1;
+	return error;
 }
 
-void spiDmaSend(uint8_t *tx, uint32_t length, portTickType ticks_to_wait)
-{
-	struct spiMessage Message;
-
-	Message.length=length;
-	Message.direction=SPI_DIRECTION_SEND;
-
-	Message.data = (uint8_t*) pvPortMalloc(Message.length);
-	memcpy(Message.data, tx, Message.length);
-
-	xQueueSend(spiMessageQueue, &Message, ticks_to_wait);
-}
-
-//static void spiTxTask(void *parameters)
-//{
-//	uint8_t *previous_tx = NULL;
-//
-//	(void) parameters;						// suppress warning
-//
-//	while(1)
-//	{
-//		struct spiTxMessage Message;
-//
-//		xQueueReceive(spiTxQueue, &Message, portMAX_DELAY);	// get data to send
-//
-//		xSemaphoreTake(spiTxDmaSemaphore, portMAX_DELAY);	// wait for SPI to be free
-//
-//		if (previous_tx != NULL)	// if previous message wasn't null
-//					vPortFree(previous_tx);		// yes - free the temporary buffer
-//
-//		uint32_t temp = 0;
-//
-//		SPIx_DMAx_TX_CH->CCR = 0;			// reset dma tx channel (disabling tx channel)
-//
-//		SPIx_DMAx_TX_CH->CNDTR = Message.length; 	// nuber of data to transfer (can be written only when channel is disabled)
-//
-//		SPIx_DMAx_TX_CH->CMAR = (uint32_t)Message.tx;			// memory address
-//
-//		SPIx_DMAx_TX_CH->CPAR = (uint32_t) & SPIx->DR; 	// peripheral address
-//
-//		temp |= DMA_CCR1_PL;		// channel priority very high
-//		temp |= DMA_CCR1_MINC;		// memory increment mode enabled
-//		temp |= DMA_CCR1_DIR; 		// read from memory
-//		temp |= DMA_CCR1_TCIE;		// transfer complete interrupt enable
-//		temp |= DMA_CCR1_EN;		// channel enable
-//
-//		SPIx_DMAx_TX_CH->CCR = temp;
-//
-//		// save address for next iteration so that it could be freed after transfer
-//		previous_tx=Message.tx;
-//	}
-//}
-
-static void spiTransferTask(void *parameters)
-{
-	uint8_t *previous_tx = NULL;
-
-	(void) parameters;						// suppress warning
-
-	while(1)
-	{
-		struct spiMessage Message;
-
-		xQueueReceive(spiMessageQueue, &Message, portMAX_DELAY);	// get data to send
-
-		xSemaphoreTake(spiTxDmaSemaphore, portMAX_DELAY);	// wait for SPI TX channel to be free
-
-		if (previous_tx != NULL)  // if previous message wasn't null
-		{
-			vPortFree(previous_tx);		// yes - free the temporary buffer
-			previous_tx = NULL;
-		}
-
-
-		if(Message.direction == SPI_DIRECTION_SEND)   // when message to transmit
-		{
-			uint32_t temp = 0;
-
-			SPIx_DMAx_TX_CH->CCR = 0;			// reset dma tx channel (disabling tx channel)
-
-			SPIx_DMAx_TX_CH->CNDTR = Message.length; 	// nuber of data to transfer (can be written only when channel is disabled)
-
-			SPIx_DMAx_TX_CH->CMAR = (uint32_t)Message.data;			// memory address
-
-			SPIx_DMAx_TX_CH->CPAR = (uint32_t) & SPIx->DR; 	// peripheral address
-
-			temp |= DMA_CCR_PL;		// channel priority very high
-			temp |= DMA_CCR_MINC;		// memory increment mode enabled
-			temp |= DMA_CCR_DIR; 		// read from memory
-			temp |= DMA_CCR_TCIE;		// transfer complete interrupt enable
-			temp |= DMA_CCR_EN;		// channel enable
-
-			SPIx_DMAx_TX_CH->CCR = temp;
-
-			// save address for next iteration so that it could be freed after transfer
-			previous_tx=Message.data;
-		}
-
-		else		// when message to read
-		{
-			xSemaphoreTake(spiRxDmaSemaphore, portMAX_DELAY);	// wait for SPI DMA RX channel to be free
-
-			uint32_t temp = spiInputBufferIndex;
-			uint8_t index = 0;
-
-			if(spiInputBufferIndex + Message.length >= SPI_INPUT_BUFFER_SIZE)
-			{
-				index = 0;
-			}
-			else
-			{
-				index = spiInputBufferIndex;
-			}
-
-			SPIx_DMAx_RX_CH->CCR = 0;			// reset dma rx channel (disabling rx channel)
-
-			SPIx_DMAx_RX_CH->CNDTR = Message.length; 	// nuber of data to transfer (can be written only when channel is disabled)
-
-			SPIx_DMAx_RX_CH->CMAR = (uint32_t) &spiInputBuffer[index];			// memory address
-
-			SPIx_DMAx_RX_CH->CPAR = (uint32_t) &SPIx->DR; 	// peripheral address
-
-			temp = DMA_CCR_PL;		// channel priority very high
-			temp |= DMA_CCR_MINC;		// memory increment mode enabled
-			temp |= DMA_CCR_TCIE;		// transfer complete interrupt and transfer error interrupt enable
-			temp |= DMA_CCR_EN;		// channel enable
-
-			SPIx_DMAx_RX_CH->CCR = temp;
-
-			spiInputBufferIndex += Message.length;
-
-			static uint8_t dummy = 255;
-
-			struct spiRxMessage RxMessage;
-			RxMessage.length = Message.length;
-			RxMessage.rx = &spiInputBuffer[index];
-
-			spiDmaSendDummy(&dummy, Message.length);
-
-			xQueueSend(spiRxQueue, &RxMessage, portMAX_DELAY);
-		}
-	}
-}
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
 
-void spiDmaSendDummy(uint8_t *dummy, uint32_t length)
+/**
+ * \brief Executes single DMA transfer and waits for its end.
+ *
+ * RX channel has higher priority than TX channel, so received bytes are never overwritten in SPI's data register.
+ *
+ * \param [in] tx is the pointer to transferred data buffer, nullptr if blank bytes should be transferred
+ * \param [out] rx is the pointer to received data buffer, nullptr if received data should be discarded
+ * \param [in] length is the length of transfer in bytes, at most 65535
+ * \param [in] ticks_to_wait is the amount of time to wait for the transfer to finish
+ *
+ * \return ERROR_NONE on success, error code otherwise
+ */
+
+static enum Error _transferChunk(const uint8_t * const tx, uint8_t * const rx, const size_t length,
+		const portTickType ticks_to_wait)
 {
-	uint32_t temp = 0;
-
-	SPIx_DMAx_TX_CH->CCR = 0;			// reset dma tx channel (disabling tx channel)
-
-	SPIx_DMAx_TX_CH->CNDTR = length; 	// nuber of data to transfer (can be written only when channel is disabled)
+	SPIx_DMAx_RX_CH->CCR = 0;				// disable channels
+	SPIx_DMAx_TX_CH->CCR = 0;
+	SPIx_DMAx_RX_IFCR_CGIFx_bb = 1;			// clear all flags of channels
+	SPIx_DMAx_TX_IFCR_CGIFx_bb = 1;
 
-	SPIx_DMAx_TX_CH->CMAR = (uint32_t)dummy;			// memory address
+	(void) SPIx->DR;						// drop stale received byte
 
-	SPIx_DMAx_TX_CH->CPAR = (uint32_t) & SPIx->DR; 	// peripheral address
+	_transferError = false;
 
-	temp |= DMA_CCR_PL;		// channel priority very high
-	temp |= DMA_CCR_DIR; 		// read from memory
-	temp |= DMA_CCR_TCIE;		// transfer complete interrupt and transfer error interrupt enable
-	temp |= DMA_CCR_EN;		// channel enable
+	SPIx_DMAx_RX_CH->CPAR = (uint32_t) &SPIx->DR;	// source
+	SPIx_DMAx_RX_CH->CMAR = (uint32_t) (rx != nullptr ? rx : &_rxDiscard);	// destination
+	SPIx_DMAx_RX_CH->CNDTR = length;
+	// very high priority, 8-bit source and destination, memory increment mode only for real buffer, transfer complete
+	// and transfer error interrupt enable, enable channel
+	SPIx_DMAx_RX_CH->CCR = DMA_CCR_PL_VHIGH | DMA_CCR_MSIZE_8 | DMA_CCR_PSIZE_8 | (rx != nullptr ? DMA_CCR_MINC : 0) |
+			DMA_CCR_TCIE | DMA_CCR_TEIE | DMA_CCR_EN;
 
-	SPIx_DMAx_TX_CH->CCR = temp;
-}
-
-void spiDmaRead2Buffer(uint32_t length, portTickType ticks_to_wait)
-{
-	struct spiMessage Message;
+	SPIx_DMAx_TX_CH->CPAR = (uint32_t) &SPIx->DR;	// destination
+	SPIx_DMAx_TX_CH->CMAR = (uint32_t) (tx != nullptr ? tx : &_txFill);	// source
+	SPIx_DMAx_TX_CH->CNDTR = length;
+	// high priority, 8-bit source and destination, memory increment mode only for real buffer, memory to peripheral,
+	// enable channel
+	SPIx_DMAx_TX_CH->CCR = DMA_CCR_PL_HIGH | DMA_CCR_MSIZE_8 | DMA_CCR_PSIZE_8 | (tx != nullptr ? DMA_CCR_MINC : 0) |
+			DMA_CCR_DIR | DMA_CCR_EN;
 
-	Message.length=length;
-	Message.direction=SPI_DIRECTION_READ;
-	Message.data=NULL;
+	SPIx->CR2 |= SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN;	// start the transfer
 
-	xQueueSend(spiMessageQueue, &Message, ticks_to_wait);
-}
-
-struct spiRxMessage spiDmaReadFromBuffer()
-{
-	struct spiRxMessage Message;
+	const bool finished = xSemaphoreTake(_transferSemaphore, ticks_to_wait) == pdTRUE;
 
-	xQueueReceive(spiRxQueue, &Message, portMAX_DELAY);	// get data from queue
+	SPIx->CR2 &= ~(SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+	SPIx_DMAx_TX_CH->CCR = 0;
+	SPIx_DMAx_RX_CH->CCR = 0;
 
-	return Message;
-}
-
-static void spiTestTask(void *parameters)
-{
-	uint8_t tx[10];
-	for(int i=0;i<10;i++)
+	if (finished == false)
 	{
-		tx[i]=i+1;
+		while (SPIx_SR_BSY_bb(SPIx));		// let the byte being shifted finish
+		(void) SPIx->DR;
+		xSemaphoreTake(_transferSemaphore, 0);	// discard notification which could arrive after timeout
+		return ERROR_SPI_TIMEOUT;
 	}
 
-	struct spiRxMessage Message;
-
-	while(1)
-	{
-		spiDmaSend(tx,10,10);
-		vTaskDelay(1000/portTICK_RATE_MS);
-		spiDmaRead2Buffer(5,10);
-		vTaskDelay(1000/portTICK_RATE_MS);
-		Message = spiDmaReadFromBuffer();
-	}
+	return _transferError == false ? ERROR_NONE : ERROR_SPI_TRANSFER_FAILED;
 }
 
-extern "C" void SPIx_DMAx_TX_CH_IRQHandler(void) __attribute__ ((interrupt));
-void SPIx_DMAx_TX_CH_IRQHandler(void)
-{
-	signed portBASE_TYPE higher_priority_task_woken;
-
-	xSemaphoreGiveFromISR(spiTxDmaSemaphore, &higher_priority_task_woken);
-
-	SPIx_DMAx_TX_IFCR_CTCIFx_bb = 1; // clear interrupt flag
+/*---------------------------------------------------------------------------------------------------------------------+
+| ISRs
++---------------------------------------------------------------------------------------------------------------------*/
 
-	portEND_SWITCHING_ISR(higher_priority_task_woken);
-}
+/**
+ * \brief ISR of RX DMA channel of SPI - notifies the task waiting for the end of transfer.
+ */
 
 extern "C" void SPIx_DMAx_RX_CH_IRQHandler(void) __attribute__ ((interrupt));
 void SPIx_DMAx_RX_CH_IRQHandler(void)
 {
-	signed portBASE_TYPE higher_priority_task_woken;
+	portBASE_TYPE higher_priority_task_woken = pdFALSE;
 
-	xSemaphoreGiveFromISR(spiRxDmaSemaphore, &higher_priority_task_woken);
+	if (SPIx_DMAx_RX_ISR_TEIFx_bb != 0)
+		_transferError = true;
 
-	SPIx_DMAx_RX_IFCR_CTCIFx_bb = 1; // clear interrupt flag
+	SPIx_DMAx_RX_CH->CCR = 0;				// disable channel, so that no further interrupts are generated
+	SPIx_DMAx_RX_IFCR_CGIFx_bb = 1;			// clear all flags of channel
+
+	xSemaphoreGiveFromISR(_transferSemaphore, &higher_priority_task_woken);
 
 	portEND_SWITCHING_ISR(higher_priority_task_woken);
 }
-
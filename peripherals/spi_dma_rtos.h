@@ -1,23 +1,31 @@
+/**
+ * \file spi_dma_rtos.h
+ * \brief Header for spi_dma_rtos.cpp
+ * \author: Mazeryt Freager
+ */
+
 #ifndef SPI_DMA_RTOS_H_
 #define SPI_DMA_RTOS_H_
 
-#define SPI_DIRECTION_READ				1
-#define SPI_DIRECTION_SEND				2
-
-void spiDmaInitialize(void);
-
-uint32_t spiDmaSetBaudRate(uint32_t baud_rate);
+#include <cstddef>
+#include <cstdint>
 
-void spiDmaStart();
+#include "FreeRTOS.h"
 
-void spiDmaStop();
+#include "error.h"
 
-void spiDmaSend(uint8_t *tx, uint32_t length, portTickType ticks_to_wait);
+/*---------------------------------------------------------------------------------------------------------------------+
+| global defines
++---------------------------------------------------------------------------------------------------------------------*/
 
-void spiDmaSendDummy(uint8_t *dummy, uint32_t length);
+#define spiDmaRead(rx, length, ticks_to_wait)		spiDmaTransfer(nullptr, (rx), (length), (ticks_to_wait))
+#define spiDmaWrite(tx, length, ticks_to_wait)		spiDmaTransfer((tx), nullptr, (length), (ticks_to_wait))
 
-void spiDmaRead2Buffer(uint32_t length, portTickType ticks_to_wait);
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
 
-struct spiRxMessage spiDmaReadFromBuffer();
+enum Error spiDmaInitialize(void);
+enum Error spiDmaTransfer(const uint8_t *tx, uint8_t *rx, size_t length, portTickType ticks_to_wait);
 
 #endif /* SPI_DMA_RTOS_H_ */
@@ -2,7 +2,9 @@
  * \file usart.cpp
  * \brief USART driver
  *
- * Functions for USART control
+ * Functions for USART control. USART1, USART2 and USART3 can be used concurrently - each instance enabled in config.h
+ * has its own RX and TX ring buffers, DMA channels and synchronization objects. Instance is selected with port number,
+ * which is also the number in the name of /dev/uartN device - 0 for USART1, 1 for USART2 and 2 for USART3.
  *
  * chip: STM32L1xx; prefix: usart
  *
@@ -38,52 +40,122 @@
  | local variables' types
  +---------------------------------------------------------------------------------------------------------------------*/
 
-/// list of possible statuses of RX queue message
-enum _RxStatus {
-	RX_STATUS_HAD_NONE,						///< there was/is no "\r\n" sequence
-	RX_STATUS_HAD_CR,						///< there was/is '\r'
-	RX_STATUS_HAD_CR_LF,					///< there is a "\r\n" sequence
+/// hardware resources and buffers of USART instance
+struct _UsartDescriptor {
+	USART_TypeDef *usart;					///< USART peripheral, NULL if instance is disabled
+	volatile uint32_t *rccEnr;				///< RCC register with enable bit of USART
+	uint32_t rccEnrMask;					///< enable bit of USART in rccEnr
+	IRQn_Type irqn;							///< IRQ number of USART
+	GPIO_TypeDef *txGpio;					///< GPIO port of TX pin
+	enum GpioPin txPin;						///< TX pin
+	GPIO_TypeDef *rxGpio;					///< GPIO port of RX pin
+	enum GpioPin rxPin;						///< RX pin
+	enum GpioConfiguration pinConfiguration;	///< configuration of TX and RX pins
+	uint32_t baudrate;						///< baudrate
+	uint32_t cr3FlowControl;				///< hardware flow control bits of CR3, 0 if not used
+	DMA_Channel_TypeDef *dmaTxChannel;		///< DMA channel used for transmission
+	IRQn_Type dmaTxIrqn;					///< IRQ number of TX DMA channel
+	DMA_Channel_TypeDef *dmaRxChannel;		///< DMA channel used for reception
+	IRQn_Type dmaRxIrqn;					///< IRQ number of RX DMA channel
+	uint32_t dmaIfcrCgifTx;					///< DMA_IFCR_CGIFx bit of TX DMA channel
+	uint32_t dmaIfcrCgifRx;					///< DMA_IFCR_CGIFx bit of RX DMA channel
+	char *rxRing;							///< RX ring buffer, filled by DMA in circular mode
+	size_t rxRingSize;						///< size of RX ring buffer
+	char *txRing;							///< TX ring buffer - writers reserve, fill and commit regions in place
+	size_t txRingSize;						///< size of TX ring buffer
 };
 
-/// message for UART RX queue
-struct _RxMessage {
-	size_t length;							///< length of string
-	enum _RxStatus status;					///< status of received data
-	char string[USARTx_RX_QUEUE_BUFFER_LENGTH];	///< string buffer, not null-terminated!
-};
-
-/// message for USART TX queue
-struct _TxMessage {
-	size_t length;			///< length of string, not including trailing '\0'
-	char *string;///< pointer to null-terminated string, either in flash or in dynamic buffer
+/// state of USART instance
+struct _UsartState {
+	size_t rxPublished;						///< position in rxRing up to which received data was published to readers
+	volatile size_t rxRead;					///< position in rxRing of the first byte not yet read
+	volatile size_t rxAvailable;			///< number of published bytes not yet read
+	xSemaphoreHandle rxDataSemaphore;		///< semaphore given by interrupts each time new data is published
+	volatile size_t txWrite;				///< position in txRing at which data is committed by writers
+	volatile size_t txRead;					///< position in txRing of the first byte not yet sent by DMA
+	volatile size_t txWatermark;			///< end of data preceding the wrap of txWrite, txRingSize if not wrapped
+	volatile size_t txDmaLength;			///< length of DMA transfer in progress, 0 if DMA is idle
+	size_t txReservedOffset;				///< offset of region reserved with usartTxReserve()
+	size_t txReservedLength;				///< length of region reserved with usartTxReserve()
+	xSemaphoreHandle txMutex;				///< mutex held by writer between usartTxReserve() and usartTxCommit()
+	xSemaphoreHandle txSpaceSemaphore;		///< semaphore given by DMA interrupt each time space in txRing is freed
+	struct UsartStatistics statistics;		///< statistics of USART, updated with interrupts masked
 };
 
 /*---------------------------------------------------------------------------------------------------------------------+
  | local functions' declarations
  +---------------------------------------------------------------------------------------------------------------------*/
 
-static void _rxTask(void *parameters);
-static void _txTask(void *parameters);
+static const struct _UsartDescriptor * _getDescriptor(size_t port);
+static void _rxPublishFromISR(size_t port, portBASE_TYPE *higher_priority_task_woken);
+static size_t _txFindRegion(size_t port, size_t length);
+static void _txStart(size_t port);
+static void _usartIrqHandler(size_t port);
+static void _dmaTxIrqHandler(size_t port);
+static void _dmaRxIrqHandler(size_t port);
 
 /*---------------------------------------------------------------------------------------------------------------------+
- | local defines
+ | local variables
  +---------------------------------------------------------------------------------------------------------------------*/
 
-#define _INPUT_BUFFER_SIZE					128
-#define _OUTPUT_BUFFER_SIZE					512
+#if USART1_ENABLED == 1
+static char _usart1RxRing[USART1_RX_RING_SIZE];
+static char _usart1TxRing[USART1_TX_RING_SIZE];
+#endif
 
-/*---------------------------------------------------------------------------------------------------------------------+
- | local variables
- +---------------------------------------------------------------------------------------------------------------------*/
+#if USART2_ENABLED == 1
+static char _usart2RxRing[USART2_RX_RING_SIZE];
+static char _usart2TxRing[USART2_TX_RING_SIZE];
+#endif
 
-extern char __ram_start[];					// imported from linker script
+#if USART3_ENABLED == 1
+static char _usart3RxRing[USART3_RX_RING_SIZE];
+static char _usart3TxRing[USART3_TX_RING_SIZE];
+#endif
+
+/// descriptors of USART instances, indexed by port number
+static const struct _UsartDescriptor _descriptors[USART_PORT_COUNT] =
+{
+#if USART1_ENABLED == 1
+		{
+				USART1, &RCC->APB2ENR, RCC_APB2ENR_USART1EN, USART1_IRQn,
+				USART1_TX_GPIO, USART1_TX_PIN, USART1_RX_GPIO, USART1_RX_PIN, USART1_PIN_CONFIGURATION,
+				USART1_BAUDRATE, USART1_FLOW_CONTROL == 1 ? USART_CR3_CTSE | USART_CR3_RTSE : 0,
+				DMA1_Channel4, DMA1_Channel4_IRQn, DMA1_Channel5, DMA1_Channel5_IRQn, DMA_IFCR_CGIF4, DMA_IFCR_CGIF5,
+				_usart1RxRing, sizeof(_usart1RxRing), _usart1TxRing, sizeof(_usart1TxRing),
+		},
+#else
+		{},
+#endif
+#if USART2_ENABLED == 1
+		{
+				USART2, &RCC->APB1ENR, RCC_APB1ENR_USART2EN, USART2_IRQn,
+				USART2_TX_GPIO, USART2_TX_PIN, USART2_RX_GPIO, USART2_RX_PIN, USART2_PIN_CONFIGURATION,
+				USART2_BAUDRATE, USART2_FLOW_CONTROL == 1 ? USART_CR3_CTSE | USART_CR3_RTSE : 0,
+				DMA1_Channel7, DMA1_Channel7_IRQn, DMA1_Channel6, DMA1_Channel6_IRQn, DMA_IFCR_CGIF7, DMA_IFCR_CGIF6,
+				_usart2RxRing, sizeof(_usart2RxRing), _usart2TxRing, sizeof(_usart2TxRing),
+		},
+#else
+		{},
+#endif
+#if USART3_ENABLED == 1
+		{
+				USART3, &RCC->APB1ENR, RCC_APB1ENR_USART3EN, USART3_IRQn,
+				USART3_TX_GPIO, USART3_TX_PIN, USART3_RX_GPIO, USART3_RX_PIN, USART3_PIN_CONFIGURATION,
+				USART3_BAUDRATE, USART3_FLOW_CONTROL == 1 ? USART_CR3_CTSE | USART_CR3_RTSE : 0,
+				DMA1_Channel2, DMA1_Channel2_IRQn, DMA1_Channel3, DMA1_Channel3_IRQn, DMA_IFCR_CGIF2, DMA_IFCR_CGIF3,
+				_usart3RxRing, sizeof(_usart3RxRing), _usart3TxRing, sizeof(_usart3TxRing),
+		},
+#else
+		{},
+#endif
+};
 
-static xQueueHandle _rxQueue;
-static xQueueHandle _txQueue;
-static xSemaphoreHandle _dmaTxSemaphore;
+/// states of USART instances, indexed by port number
+static struct _UsartState _states[USART_PORT_COUNT];
 
-static char _inputBuffer[_INPUT_BUFFER_SIZE];
-static char _outputBuffer[_OUTPUT_BUFFER_SIZE];
+/// callback called from interrupts on received data and freed TX space, NULL if not set
+static volatile UsartEventCallback _eventCallback;
 
 /*---------------------------------------------------------------------------------------------------------------------+
  | global functions
@@ -92,337 +164,759 @@ static char _outputBuffer[_OUTPUT_BUFFER_SIZE];
 /**
  * \brief Initializes USART
  *
- * Initializes USART
+ * Initializes USART instance - pins, peripheral, DMA channels and synchronization objects.
+ *
+ * \param [in] port is the port number of USART instance
  *
- * \return ERROR_NONE if the semaphore and queues were successfully created and
- * tasks were successfully created and added to a ready list, otherwise an error
- * code defined in the file error.h
+ * \return ERROR_NONE if the mutex and semaphores were successfully created, otherwise an error code defined in the
+ * file error.h
  */
-enum Error usartInitialize(void)
+enum Error usartInitialize(size_t port)
 {
-	gpioConfigurePin(USARTx_TX_GPIO, USARTx_TX_PIN, USARTx_TX_CONFIGURATION);
-	gpioConfigurePin(USARTx_RX_GPIO, USARTx_RX_PIN, USARTx_RX_CONFIGURATION);
+	if (port >= USART_PORT_COUNT || _descriptors[port].usart == NULL)	// no such instance or instance disabled?
+		return ERROR_USART_PORT_NOT_AVAILABLE;
 
-	RCC_APBxENR_USARTxEN_bb = 1;			// enable USART in RCC
+	const struct _UsartDescriptor *descriptor = &_descriptors[port];
+	struct _UsartState *state = &_states[port];
 
-	USARTx->BRR = (rccGetCoreFrequency() + USARTx_BAUDRATE / 2)
-			/ USARTx_BAUDRATE;	// calculate baudrate (with rounding)
-	// enable peripheral, transmitter and receiver, enable RXNE interrupt
-	USARTx->CR1 = USART_CR1_UE | USART_CR1_RXNEIE | USART_CR1_TE | USART_CR1_RE;
-	USARTx->CR3 = USART_CR3_DMAT | USART_CR3_CTSE | USART_CR3_RTSE; // DMA and Hardware Flow Control
+	state->txWatermark = descriptor->txRingSize;
 
-	NVIC_SetPriority(USARTx_IRQn, USARTx_IRQ_PRIORITY);	// set USART priority
-	NVIC_EnableIRQ(USARTx_IRQn);				// enable USART IRQ
+	gpioConfigurePin(descriptor->txGpio, descriptor->txPin, descriptor->pinConfiguration);
+	gpioConfigurePin(descriptor->rxGpio, descriptor->rxPin, descriptor->pinConfiguration);
 
-	RCC_AHBENR_DMAxEN_bb = 1;				// enable DMA
+	taskENTER_CRITICAL();
+	*descriptor->rccEnr |= descriptor->rccEnrMask;	// enable USART in RCC
+	RCC_AHBENR_DMA1EN_bb = 1;				// enable DMA
+	taskEXIT_CRITICAL();
 
-	NVIC_SetPriority(USARTx_DMAx_TX_CH_IRQn, USARTx_DMAx_TX_CH_IRQ_PRIORITY);// set DMA IRQ priority
-	NVIC_EnableIRQ(USARTx_DMAx_TX_CH_IRQn);	// enable IRQ
+	USART_TypeDef *usart = descriptor->usart;
 
-	vSemaphoreCreateBinary(_dmaTxSemaphore);
+	usart->BRR = (rccGetCoreFrequency() + descriptor->baudrate / 2)
+			/ descriptor->baudrate;	// calculate baudrate (with rounding), APB1 and APB2 run at core frequency
 
-	if (_dmaTxSemaphore == NULL)			// semaphore not created?
-		return ERROR_FreeRTOS_errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;// return with error
+	DMA_Channel_TypeDef *rx_channel = descriptor->dmaRxChannel;
 
-	_txQueue = xQueueCreate(USARTx_TX_QUEUE_LENGTH, sizeof(struct _TxMessage));
+	rx_channel->CCR = 0;					// disable channel
+	rx_channel->CPAR = (uint32_t) & usart->DR;	// source
+	rx_channel->CMAR = (uint32_t) descriptor->rxRing;	// destination
+	rx_channel->CNDTR = descriptor->rxRingSize;	// length
+	// low priority, 8-bit source and destination, memory increment mode, circular mode, peripheral to memory, half
+	// transfer and transfer complete interrupt enable, enable channel
+	rx_channel->CCR = DMA_CCR_PL_LOW | DMA_CCR_MSIZE_8
+			| DMA_CCR_PSIZE_8 | DMA_CCR_MINC | DMA_CCR_CIRC |
+			DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_EN;
 
-	if (_txQueue == NULL)					// queue not created?
-		return ERROR_FreeRTOS_errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;// return with error
+	// enable peripheral, transmitter and receiver, enable IDLE interrupt
+	usart->CR1 = USART_CR1_UE | USART_CR1_IDLEIE | USART_CR1_TE | USART_CR1_RE;
+	usart->CR3 = USART_CR3_DMAT | USART_CR3_DMAR | descriptor->cr3FlowControl; // DMA and Hardware Flow Control
 
-	_rxQueue = xQueueCreate(USARTx_RX_QUEUE_LENGTH, sizeof(struct _RxMessage));
+	NVIC_SetPriority(descriptor->irqn, USART_IRQ_PRIORITY);	// set USART priority
+	NVIC_EnableIRQ(descriptor->irqn);		// enable USART IRQ
 
-	if (_rxQueue == NULL)					// queue not created?
+	NVIC_SetPriority(descriptor->dmaTxIrqn, USART_DMA_TX_CH_IRQ_PRIORITY);// set DMA IRQ priority
+	NVIC_EnableIRQ(descriptor->dmaTxIrqn);	// enable IRQ
+
+	NVIC_SetPriority(descriptor->dmaRxIrqn, USART_DMA_RX_CH_IRQ_PRIORITY);// set DMA IRQ priority
+	NVIC_EnableIRQ(descriptor->dmaRxIrqn);	// enable IRQ
+
+	state->txMutex = xSemaphoreCreateMutex();
+
+	if (state->txMutex == NULL)				// mutex not created?
 		return ERROR_FreeRTOS_errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;// return with error
 
-	portBASE_TYPE ret = xTaskCreate(_txTask, (signed char* )"USART TX",
-			USART_TX_STACK_SIZE, NULL, USART_TX_TASK_PRIORITY, NULL);
+	vSemaphoreCreateBinary(state->txSpaceSemaphore);
+
+	if (state->txSpaceSemaphore == NULL)	// semaphore not created?
+		return ERROR_FreeRTOS_errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;// return with error
 
-	enum Error error = errorConvert_portBASE_TYPE(ret);
+	xSemaphoreTake(state->txSpaceSemaphore, 0);	// semaphore is created "given"
 
-	if (error != ERROR_NONE)
-		return error;
+	vSemaphoreCreateBinary(state->rxDataSemaphore);
 
-	ret = xTaskCreate(_rxTask, (signed char* )"USART RX", USART_RX_STACK_SIZE,
-			NULL, USART_RX_TASK_PRIORITY, NULL);
+	if (state->rxDataSemaphore == NULL)		// semaphore not created?
+		return ERROR_FreeRTOS_errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;// return with error
 
-	error = errorConvert_portBASE_TYPE(ret);
+	xSemaphoreTake(state->rxDataSemaphore, 0);	// semaphore is created "given"
 
-	return error;
+	return ERROR_NONE;
 }
 
 /**
  * \brief Sends one formatted string via USART.
  *
- * Sends one formatted string via USART.
+ * String is formatted directly into region reserved in TX ring buffer - no dynamic memory and no additional copies are
+ * used. Output longer than USART_TX_PRINTF_LENGTH_MAX - 1 characters is truncated, but the truncated part is still
+ * sent.
  *
+ * \param [in] port is the port number of USART instance
  * \param [in] ticks_to_wait is the amount of time the call should block while waiting for the operation to finish, use
  * portMAX_DELAY to suspend
  * \param [in] string is a format string, printf() style
  *
- * \return ERROR_NONE on success, otherwise an error code defined in the file error.h
+ * \return ERROR_NONE on success, ERROR_BUFFER_OVERFLOW if output was truncated, otherwise an error code defined in the
+ * file error.h
  */
-enum Error usartPrintf(portTickType ticks_to_wait, const char *format, ...)
+enum Error usartPrintf(size_t port, portTickType ticks_to_wait, const char *format, ...)
 {
-	char *buffer = (char*) pvPortMalloc(strlen(format) * 2);
+	char *region;
+
+	enum Error error = usartTxReserve(port, &region, USART_TX_PRINTF_LENGTH_MAX, ticks_to_wait);
 
-	if (buffer == NULL)
-		return ERROR_FreeRTOS_errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+	if (error != ERROR_NONE)
+		return error;
 
 	va_list args;
 
 	va_start(args, format);
+	int length = vsniprintf(region, USART_TX_PRINTF_LENGTH_MAX, format, args);
+	va_end(args);
 
-	vsprintf(buffer, format, args);
+	if (length < 0)							// output length overflowed int (EOVERFLOW)?
+	{
+		usartTxCommit(port, 0);				// cancel reservation
+		return ERROR_BUFFER_OVERFLOW;
+	}
 
-	enum Error error = usartSendString(buffer, ticks_to_wait);
+	if (length >= USART_TX_PRINTF_LENGTH_MAX)	// truncated?
+	{
+		usartTxCommit(port, USART_TX_PRINTF_LENGTH_MAX - 1);	// terminating '\0' is not sent
+		return ERROR_BUFFER_OVERFLOW;
+	}
 
-	vPortFree(buffer);
+	usartTxCommit(port, length);
 
-	return error;
+	return ERROR_NONE;
 }
 
 /**
  * \brief Low-level character print.
  *
- * Low-level character print. Should be used for debugging only.
+ * Low-level character print on USART_DEBUG_PORT. Should be used for debugging only.
  *
  * \param [in] c is the character that will be printed
  */
 void usart_low_level_put(char c) {
-	while (!(USARTx_SR_TXE_bb(USARTx)));
-	USARTx->DR = c;
+	USART_TypeDef *usart = _descriptors[USART_DEBUG_PORT].usart;
+
+	while (!(USARTx_SR_TXE_bb(usart)));
+	usart->DR = c;
 }
 
 /**
- * \brief Adds specified number of bytes to UART TX queue
+ * \brief Sends specified number of bytes via USART.
+ *
+ * Data is copied to TX ring buffer, which is the only copy made - it is sent by DMA directly from there. Data longer
+ * than half of the ring is split into several regions.
  *
+ * \param [in] port is the port number of USART instance
  * \param [in] data is pointer to table of bytes
  * \param [in] length is the number of bytes to send
- * \param [in] ticks_to_wait is the amount of time the call should block while waiting for the operation to finish, use
- * 			   portMAX_DELAY to suspend
+ * \param [in] ticks_to_wait is the amount of time the call should block while waiting for space in TX ring buffer (for
+ * 			   each region), use portMAX_DELAY to suspend
  *
  * \return ERROR_NONE on success, otherwise an error code defined in the file error.h
  */
-enum Error usartSendBytes(const char *data, size_t length, portTickType ticks_to_wait)
+enum Error usartSendBytes(size_t port, const char *data, size_t length, portTickType ticks_to_wait)
 {
-	struct _TxMessage message;
-
-	message.length = length;
+	const struct _UsartDescriptor *descriptor = _getDescriptor(port);
 
-	if (message.length == 0)
-		return ERROR_NONE;
+	if (descriptor == NULL)
+		return ERROR_USART_PORT_NOT_AVAILABLE;
 
-	if (data >= __ram_start)				// is the string in RAM?
+	while (length != 0)
 	{
-		message.string = (char*) pvPortMalloc(message.length);
-		if (message.string == NULL)
-			return ERROR_FreeRTOS_errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+		const size_t chunk = length < descriptor->txRingSize / 2 ? length : descriptor->txRingSize / 2;
+		char *region;
 
-		memcpy(message.string, data, message.length);
-	}
-	else
-		message.string = (char*) data;// no, string in ROM - just use the address
+		enum Error error = usartTxReserve(port, &region, chunk, ticks_to_wait);
 
-	portBASE_TYPE ret = xQueueSend(_txQueue, &message, ticks_to_wait);
+		if (error != ERROR_NONE)
+			return error;
 
-	enum Error error = errorConvert_portBASE_TYPE(ret);
+		memcpy(region, data, chunk);
+		usartTxCommit(port, chunk);
 
-	if (error != ERROR_NONE)
-		if (message.string >= __ram_start)				// is the string in RAM?
-			vPortFree(message.string);
+		data += chunk;
+		length -= chunk;
+	}
 
-	return error;
+	return ERROR_NONE;
 }
 
 /**
- * \brief Adds one string to UART TX queue.
- *
- * Adds one string to UART TX queue. Calling task should have read-only access to shared_data section.
+ * \brief Sends one string via USART.
  *
+ * \param [in] port is the port number of USART instance
  * \param [in] string is the pointer to zero terminated string
  * \param [in] ticks_to_wait is the amount of time the call should block while waiting for the operation to finish, use
  * portMAX_DELAY to suspend
  *
  * \return ERROR_NONE on success, otherwise an error code defined in the file error.h
  */
-enum Error usartSendString(const char *string, portTickType ticks_to_wait)
+enum Error usartSendString(size_t port, const char *string, portTickType ticks_to_wait)
+{
+	return usartSendBytes(port, string, strlen(string), ticks_to_wait);
+}
+
+/**
+ * \brief Reserves contiguous region in TX ring buffer.
+ *
+ * Blocks until region of requested length is free. On success the calling task owns the TX path of this port until it
+ * calls usartTxCommit(), which must follow as soon as the region is filled.
+ *
+ * \param [in] port is the port number of USART instance
+ * \param [out] region is a pointer to variable which will hold the address of reserved region
+ * \param [in] length is the length of region, [1; size of TX ring buffer)
+ * \param [in] ticks_to_wait is the amount of time the call should block while waiting for the region, use
+ * portMAX_DELAY to suspend
+ *
+ * \return ERROR_NONE on success, otherwise an error code defined in the file error.h
+ */
+enum Error usartTxReserve(size_t port, char **region, size_t length, portTickType ticks_to_wait)
 {
-	struct _TxMessage message;
+	const struct _UsartDescriptor *descriptor = _getDescriptor(port);
 
-	message.length = strlen(string);
+	if (descriptor == NULL)
+		return ERROR_USART_PORT_NOT_AVAILABLE;
 
-	if (message.length == 0)
-		return ERROR_NONE;
+	if (length == 0 || length >= descriptor->txRingSize)
+		return ERROR_BUFFER_OVERFLOW;
 
-	if (string >= __ram_start)				// is the string in RAM?
-			{
-		message.string = (char*) pvPortMalloc(message.length);
-		if (message.string == NULL)
-			return ERROR_FreeRTOS_errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+	struct _UsartState *state = &_states[port];
+	const portTickType start = xTaskGetTickCount();
 
-		memcpy(message.string, string, message.length);
-	} else
-		message.string = (char*) string;// no, string in ROM - just use the address
+	portBASE_TYPE ret = xSemaphoreTake(state->txMutex, ticks_to_wait);
 
-	portBASE_TYPE ret = xQueueSend(_txQueue, &message, ticks_to_wait);
+	if (ret != pdTRUE)
+		return errorConvert_portBASE_TYPE(ret);
 
-	enum Error error = errorConvert_portBASE_TYPE(ret);
+	size_t offset;
 
-	if (error != ERROR_NONE)
-		if (message.string >= __ram_start)				// is the string in RAM?
-			vPortFree(message.string);
+	while ((offset = _txFindRegion(port, length)) == descriptor->txRingSize)	// no space - wait for DMA to free some
+	{
+		const portTickType elapsed = xTaskGetTickCount() - start;
 
-	return error;
+		ret = elapsed < ticks_to_wait ? xSemaphoreTake(state->txSpaceSemaphore, ticks_to_wait - elapsed) : pdFALSE;
+
+		if (ret != pdTRUE)
+		{
+			xSemaphoreGive(state->txMutex);
+			return errorConvert_portBASE_TYPE(ret);
+		}
+	}
+
+	state->txReservedOffset = offset;
+	state->txReservedLength = length;
+	*region = &descriptor->txRing[offset];
+
+	return ERROR_NONE;
 }
 
-/*---------------------------------------------------------------------------------------------------------------------+
- | local functions
- +---------------------------------------------------------------------------------------------------------------------*/
+/**
+ * \brief Commits region reserved with usartTxReserve().
+ *
+ * Committed data is sent by DMA - together with all other data committed while previous transfer was in progress.
+ *
+ * \param [in] port is the port number of USART instance, region must be reserved on this port
+ * \param [in] length is the number of bytes (from the beginning of reserved region) that should be sent, 0 cancels
+ * the reservation, values larger than reserved length are truncated
+ */
+void usartTxCommit(size_t port, size_t length)
+{
+	struct _UsartState *state = &_states[port];
+
+	if (length > state->txReservedLength)
+		length = state->txReservedLength;
+
+	if (length != 0)
+	{
+		taskENTER_CRITICAL();
+
+		if (state->txReservedOffset != state->txWrite)	// region wrapped to the beginning of ring?
+			state->txWatermark = state->txWrite;
+
+		state->txWrite = state->txReservedOffset + length;
+
+		state->statistics.txCommits++;
+		state->statistics.txBytes += length;
+
+		if (state->txDmaLength == 0)		// DMA idle?
+			_txStart(port);
+
+		taskEXIT_CRITICAL();
+	}
+
+	state->txReservedLength = 0;
+
+	xSemaphoreGive(state->txMutex);
+}
 
 /**
- * \brief USART RX task.
+ * \brief Receives data from USART.
+ *
+ * Data received by DMA is copied directly from RX ring buffer. If no data is available, the call blocks until
+ * interrupt publishes new data - there is no polling. Only one task should read from given port at a time.
+ *
+ * \param [in] port is the port number of USART instance
+ * \param [out] buffer is the buffer for received data
+ * \param [in] size is the size of buffer, bytes
+ * \param [in] ticks_to_wait is the amount of time the call should block while waiting for data, 0 for non-blocking
+ * call, use portMAX_DELAY to suspend
  *
- * USART RX task - handles input.
+ * \return number of received bytes (at most size), 0 if no data arrived in given time or port is not available
  */
-static void _rxTask(void *parameters)
+size_t usartReceiveBytes(size_t port, char *buffer, size_t size, portTickType ticks_to_wait)
 {
-	size_t input_length = 0;
+	const struct _UsartDescriptor *descriptor = _getDescriptor(port);
 
-	(void) parameters;						// suppress warning
+	if (descriptor == NULL || size == 0)
+		return 0;
 
-	while (1) {
-		struct _RxMessage message;
+	struct _UsartState *state = &_states[port];
+	const portTickType start = xTaskGetTickCount();
 
-		xQueueReceive(_rxQueue, &message, portMAX_DELAY);
+	while (1)
+	{
+		taskENTER_CRITICAL();
+		const size_t read = state->rxRead;
+		const size_t available = state->rxAvailable;
+		const uint32_t overruns = state->statistics.rxOverruns;
+		taskEXIT_CRITICAL();
+
+		if (available == 0)					// no data - wait for interrupt to publish some
+		{
+			const portTickType elapsed = xTaskGetTickCount() - start;
+
+			if (elapsed >= ticks_to_wait ||
+					xSemaphoreTake(state->rxDataSemaphore, ticks_to_wait - elapsed) != pdTRUE)
+				return 0;
 
-		if ((_INPUT_BUFFER_SIZE - 1) < (message.length + input_length))	// does input fit into buffer?
-				{									// no - reset sequence
-			usartSendString(
-					"ERROR: input is longer than buffer length! (" __FILE__ ":" STRINGIZE(__LINE__) ")\r\n",
-					0);
-			input_length = 0;
 			continue;
 		}
 
-		memcpy(&_inputBuffer[input_length], message.string, message.length);
-		input_length += message.length;
-
-		if (message.status == RX_STATUS_HAD_CR_LF)// is the message comp lete (terminated with "\r\n" sequence)?
-				{									// yes - start processing
-			_inputBuffer[input_length] = '\0';	// terminate input string
+		const size_t length = available < size ? available : size;
+		const size_t first = length < descriptor->rxRingSize - read ? length : descriptor->rxRingSize - read;
 
-//			enum Error error = BLE_commandProcessInput(_inputBuffer, _outputBuffer, _OUTPUT_BUFFER_SIZE); //BLE_Driver process input
+		memcpy(buffer, &descriptor->rxRing[read], first);
+		memcpy(buffer + first, descriptor->rxRing, length - first);	// part after the wrap of ring, if any
 
-//			if (error == ERROR_NONE)		// input processed successfully?
-				usartSendString(_outputBuffer, 0);
-//			else
-//				// input processing error
-//				usartPrintf(0,
-//						"ERROR: command handler execution failed with code %d! (" __FILE__ ":" STRINGIZE(__LINE__) ")\r\n",
-//						error);
+		taskENTER_CRITICAL();
+		const bool overrun = overruns != state->statistics.rxOverruns;
 
-			input_length = 0;				// reset sequence
+		if (overrun == false)				// data was not overwritten by DMA while it was copied?
+		{
+			state->rxRead = (read + length) % descriptor->rxRingSize;
+			state->rxAvailable -= length;
 		}
 
+		taskEXIT_CRITICAL();
+
+		if (overrun == false)
+			return length;
 	}
 }
 
 /**
- * \brief USART TX task.
+ * \brief Gets number of received bytes that can be read without blocking.
+ *
+ * \param [in] port is the port number of USART instance
  *
- * USART TX task - handles output.
+ * \return number of received bytes not yet read, 0 if port is not available
  */
-static void _txTask(void *parameters)
+size_t usartGetRxAvailable(size_t port)
 {
-	char *previous_string = NULL;
+	if (_getDescriptor(port) == NULL)
+		return 0;
 
-	(void) parameters;						// suppress warning
+	return _states[port].rxAvailable;
+}
 
-	while (1) {
-		struct _TxMessage message;
+/**
+ * \brief Gets length of the longest region that can be reserved in TX ring buffer without blocking.
+ *
+ * Region may still be reserved by other task in the meantime, so this is only a hint.
+ *
+ * \param [in] port is the port number of USART instance
+ *
+ * \return length of the longest free contiguous region in TX ring buffer, 0 if port is not available
+ */
+size_t usartGetTxSpace(size_t port)
+{
+	const struct _UsartDescriptor *descriptor = _getDescriptor(port);
 
-		xQueueReceive(_txQueue, &message, portMAX_DELAY);	// get data to send
+	if (descriptor == NULL)
+		return 0;
 
-		xSemaphoreTake(_dmaTxSemaphore, portMAX_DELAY);	// wait for DMA to be free
+	struct _UsartState *state = &_states[port];
 
-		if (previous_string >= __ram_start)	// was the previously used string in RAM?
-			vPortFree(previous_string);		// yes - free the temporary buffer
+	taskENTER_CRITICAL();
+	const size_t read = state->txRead;
+	const size_t write = state->txWrite;
+	const bool idle = state->txDmaLength == 0;
+	taskEXIT_CRITICAL();
 
-		USARTx_DMAx_TX_CH->CCR = 0;				// disable channel
-		USARTx_DMAx_TX_CH->CMAR = (uint32_t) message.string;	// source
-		USARTx_DMAx_TX_CH->CPAR = (uint32_t) & USARTx->DR;	// destination
-		USARTx_DMAx_TX_CH->CNDTR = message.length;	// length
-		// low priority, 8-bit source and destination, memory increment mode, memory to peripheral, transfer complete
-		// interrupt enable, enable channel
-		USARTx_DMAx_TX_CH->CCR = DMA_CCR_PL_LOW | DMA_CCR_MSIZE_8
-				| DMA_CCR_PSIZE_8 | DMA_CCR_MINC | DMA_CCR_DIR |
-				DMA_CCR_TCIE | DMA_CCR_EN;
+	if (idle == true && read == write)		// ring empty - it will be rewound on reservation
+		return descriptor->txRingSize - 1;
 
-		// save address for next iteration so that it could be freed after transfer (if it's in RAM);
-		previous_string = message.string;
+	if (write >= read)						// data not wrapped?
+	{
+		const size_t after = descriptor->txRingSize - write;
+		const size_t before = read > 0 ? read - 1 : 0;	// one byte is left, so that write != read
+		return after > before ? after : before;
 	}
+
+	return read - write - 1;
+}
+
+/**
+ * \brief Sets callback called from interrupts when data is received or space in TX ring buffer is freed.
+ *
+ * Callback is shared by all ports, it's used to wake tasks waiting for readiness of several devices.
+ *
+ * \param [in] callback is the callback function, NULL to disable
+ */
+void usartSetEventCallback(UsartEventCallback callback)
+{
+	_eventCallback = callback;
+}
+
+/**
+ * \brief Gets statistics of USART.
+ *
+ * Number of commits per transfer shows how well small writes are coalesced into single DMA transfers - data committed
+ * while previous transfer is in progress is sent together in the next one.
+ *
+ * \param [in] port is the port number of USART instance
+ * \param [out] statistics is a pointer to struct which will be filled with consistent snapshot of statistics
+ *
+ * \return ERROR_NONE on success, otherwise an error code defined in the file error.h
+ */
+enum Error usartGetStatistics(size_t port, struct UsartStatistics *statistics)
+{
+	if (_getDescriptor(port) == NULL)
+		return ERROR_USART_PORT_NOT_AVAILABLE;
+
+	taskENTER_CRITICAL();
+	*statistics = _states[port].statistics;
+	taskEXIT_CRITICAL();
+
+	return ERROR_NONE;
 }
 
 /*---------------------------------------------------------------------------------------------------------------------+
- | ISRs
+ | local functions
  +---------------------------------------------------------------------------------------------------------------------*/
 
 /**
- * \brief DMA channel interrupt handler
+ * \brief Gets descriptor of initialized USART instance.
  *
- * DMA channel interrupt handler
+ * \param [in] port is the port number of USART instance
+ *
+ * \return pointer to descriptor of USART instance, NULL if there is no such instance, it is disabled or it was not
+ * initialized yet
  */
-extern "C" void USARTx_DMAx_TX_CH_IRQHandler(void) __attribute__ ((interrupt));
-void USARTx_DMAx_TX_CH_IRQHandler(void)
+static const struct _UsartDescriptor * _getDescriptor(size_t port)
 {
-	signed portBASE_TYPE higher_priority_task_woken;
+	if (port >= USART_PORT_COUNT || _descriptors[port].usart == NULL || _states[port].txMutex == NULL)
+		return NULL;
 
-	xSemaphoreGiveFromISR(_dmaTxSemaphore, &higher_priority_task_woken);
+	return &_descriptors[port];
+}
 
-	USARTx_DMAx_TX_IFCR_CTCIFx_bb = 1;			// clear interrupt flag
+/**
+ * \brief Publishes data received by DMA to readers.
+ *
+ * Called from USART IDLE interrupt and from RX DMA half transfer and transfer complete interrupts, so that received
+ * data is published at least every half of the ring and at the end of each burst. If readers fall behind by more than
+ * the size of ring, all unread data is dropped, as it was already overwritten by DMA.
+ *
+ * \param [in] port is the port number of USART instance
+ * \param [out] higher_priority_task_woken is a pointer to variable which will be set to pdTRUE if giving the semaphore
+ * unblocked a task with higher priority
+ */
+static void _rxPublishFromISR(size_t port, portBASE_TYPE *higher_priority_task_woken)
+{
+	const struct _UsartDescriptor *descriptor = &_descriptors[port];
+	struct _UsartState *state = &_states[port];
+	const size_t ring_size = descriptor->rxRingSize;
 
-	portEND_SWITCHING_ISR(higher_priority_task_woken);
+	size_t position = ring_size - descriptor->dmaRxChannel->CNDTR;
+
+	if (position == ring_size)
+		position = 0;
+
+	const size_t length = (position + ring_size - state->rxPublished) % ring_size;
+
+	if (length == 0)
+		return;
+
+	state->rxPublished = position;
+	state->rxAvailable += length;
+	state->statistics.rxRanges++;
+
+	if (state->rxAvailable > ring_size)	// unread data overwritten?
+	{
+		state->rxRead = position;
+		state->rxAvailable = 0;
+		state->statistics.rxOverruns++;
+		return;
+	}
+
+	xSemaphoreGiveFromISR(state->rxDataSemaphore, higher_priority_task_woken);
+
+	const UsartEventCallback callback = _eventCallback;
+
+	if (callback != NULL)
+		callback(higher_priority_task_woken);
+}
+
+/**
+ * \brief Finds free contiguous region in TX ring buffer.
+ *
+ * Region is placed after committed data or - if it doesn't fit there - at the beginning of the ring, before data that
+ * is not yet sent. Empty ring is rewound to the beginning, so that the largest regions are available.
+ *
+ * \param [in] port is the port number of USART instance
+ * \param [in] length is the length of region
+ *
+ * \return offset of region in TX ring buffer, size of TX ring buffer if there is no space
+ */
+static size_t _txFindRegion(size_t port, size_t length)
+{
+	const size_t ring_size = _descriptors[port].txRingSize;
+	struct _UsartState *state = &_states[port];
+
+	taskENTER_CRITICAL();
+
+	if (state->txDmaLength == 0 && state->txRead == state->txWrite)	// ring empty?
+	{
+		state->txRead = 0;
+		state->txWrite = 0;
+		state->txWatermark = ring_size;
+	}
+
+	const size_t read = state->txRead;
+	const size_t write = state->txWrite;
+
+	taskEXIT_CRITICAL();
+
+	// txRead may be advanced by DMA interrupt after this point, which can only free more space
+
+	if (write >= read)						// data not wrapped?
+	{
+		if (ring_size - write >= length)	// fits after committed data?
+			return write;
+		if (read > length)					// fits at the beginning? one byte is left, so that write != read
+			return 0;
+	}
+	else if (read - write > length)			// wrapped - fits between committed data and data not yet sent?
+		return write;
+
+	return ring_size;
 }
 
 /**
- * \brief USART interrupt handler
+ * \brief Starts DMA transfer of the longest contiguous span of committed data.
+ *
+ * Must be called with interrupts masked (from critical section or from DMA interrupt).
  *
- * USART interrupt handler
+ * \param [in] port is the port number of USART instance
  */
-extern "C" void USARTx_IRQHandler(void) __attribute((interrupt));
-void USARTx_IRQHandler(void)
+static void _txStart(size_t port)
+{
+	const struct _UsartDescriptor *descriptor = &_descriptors[port];
+	struct _UsartState *state = &_states[port];
+
+	size_t read = state->txRead;
+	const size_t write = state->txWrite;
+
+	if (write < read && read == state->txWatermark)	// everything before wrap sent?
+	{
+		read = 0;
+		state->txRead = 0;
+		state->txWatermark = descriptor->txRingSize;
+	}
+
+	const size_t length = (write >= read ? write : state->txWatermark) - read;
+
+	state->txDmaLength = length;
+
+	if (length == 0)
+		return;
+
+	state->statistics.txTransfers++;
+
+	DMA_Channel_TypeDef *tx_channel = descriptor->dmaTxChannel;
+
+	tx_channel->CCR = 0;					// disable channel
+	tx_channel->CMAR = (uint32_t) &descriptor->txRing[read];	// source
+	tx_channel->CPAR = (uint32_t) & descriptor->usart->DR;	// destination
+	tx_channel->CNDTR = length;				// length
+	// low priority, 8-bit source and destination, memory increment mode, memory to peripheral, transfer complete
+	// interrupt enable, enable channel
+	tx_channel->CCR = DMA_CCR_PL_LOW | DMA_CCR_MSIZE_8
+			| DMA_CCR_PSIZE_8 | DMA_CCR_MINC | DMA_CCR_DIR |
+			DMA_CCR_TCIE | DMA_CCR_EN;
+}
+
+/**
+ * \brief Handles USART interrupt - publishes received data when the line becomes idle.
+ *
+ * \param [in] port is the port number of USART instance
+ */
+static void _usartIrqHandler(size_t port)
 {
 	portBASE_TYPE higher_priority_task_woken = pdFALSE;
-	static struct _RxMessage message;
+	USART_TypeDef *usart = _descriptors[port].usart;
 
-	while (USARTx_SR_RXNE_bb(USARTx))		// loop while data is available
+	if (USARTx_SR_IDLE_bb(usart))			// line idle?
 	{
-		char c = USARTx->DR;
-		message.string[message.length++] = c;	// get char to buffer
-
-		// check for "\r\n" sequence in the string
-		if ((message.status == RX_STATUS_HAD_CR) && (c == '\n'))
-			message.status = RX_STATUS_HAD_CR_LF;
-		else if (c == '\r')
-			message.status = RX_STATUS_HAD_CR;
-		else
-			message.status = RX_STATUS_HAD_NONE;
-
-		// transfer block only if out of space or "\r\n" sequence was found
-		if ((message.length >= USARTx_RX_QUEUE_BUFFER_LENGTH)
-				|| (message.status == RX_STATUS_HAD_CR_LF)) {
-			xQueueSendFromISR(_rxQueue, &message, &higher_priority_task_woken);
-
-			message.length = 0;
-
-			if (message.status == RX_STATUS_HAD_CR_LF)
-				message.status = RX_STATUS_HAD_NONE;
-		}
+		(void) usart->DR;					// IDLE (and ORE) flag is cleared by reading SR followed by DR
+
+		_rxPublishFromISR(port, &higher_priority_task_woken);
 	}
 
 	portEND_SWITCHING_ISR(higher_priority_task_woken);
 }
 
+/**
+ * \brief Handles TX DMA channel interrupt - frees transferred data and sends data committed in the meantime.
+ *
+ * \param [in] port is the port number of USART instance
+ */
+static void _dmaTxIrqHandler(size_t port)
+{
+	signed portBASE_TYPE higher_priority_task_woken = pdFALSE;
+	struct _UsartState *state = &_states[port];
+
+	DMA1->IFCR = _descriptors[port].dmaIfcrCgifTx;	// clear all interrupt flags of channel
+
+	state->txRead += state->txDmaLength;	// transferred data is no longer needed
+	_txStart(port);							// send everything committed in the meantime
+
+	xSemaphoreGiveFromISR(state->txSpaceSemaphore, &higher_priority_task_woken);
+
+	const UsartEventCallback callback = _eventCallback;
+
+	if (callback != NULL)
+		callback(&higher_priority_task_woken);
+
+	portEND_SWITCHING_ISR(higher_priority_task_woken);
+}
+
+/**
+ * \brief Handles RX DMA channel interrupt - publishes data when half or whole RX ring buffer is filled.
+ *
+ * \param [in] port is the port number of USART instance
+ */
+static void _dmaRxIrqHandler(size_t port)
+{
+	portBASE_TYPE higher_priority_task_woken = pdFALSE;
+
+	DMA1->IFCR = _descriptors[port].dmaIfcrCgifRx;	// clear all interrupt flags of channel
+
+	_rxPublishFromISR(port, &higher_priority_task_woken);
+
+	portEND_SWITCHING_ISR(higher_priority_task_woken);
+}
+
+/*---------------------------------------------------------------------------------------------------------------------+
+ | ISRs
+ +---------------------------------------------------------------------------------------------------------------------*/
+
+#if USART1_ENABLED == 1
+
+/**
+ * \brief USART1 interrupt handler
+ */
+extern "C" void USART1_IRQHandler(void) __attribute((interrupt));
+void USART1_IRQHandler(void)
+{
+	_usartIrqHandler(0);
+}
+
+/**
+ * \brief DMA1 channel 4 (USART1 TX) interrupt handler
+ */
+extern "C" void DMA1_Channel4_IRQHandler(void) __attribute__ ((interrupt));
+void DMA1_Channel4_IRQHandler(void)
+{
+	_dmaTxIrqHandler(0);
+}
+
+/**
+ * \brief DMA1 channel 5 (USART1 RX) interrupt handler
+ */
+extern "C" void DMA1_Channel5_IRQHandler(void) __attribute__ ((interrupt));
+void DMA1_Channel5_IRQHandler(void)
+{
+	_dmaRxIrqHandler(0);
+}
+
+#endif	// USART1_ENABLED == 1
+
+#if USART2_ENABLED == 1
+
+/**
+ * \brief USART2 interrupt handler
+ */
+extern "C" void USART2_IRQHandler(void) __attribute((interrupt));
+void USART2_IRQHandler(void)
+{
+	_usartIrqHandler(1);
+}
+
+/**
+ * \brief DMA1 channel 7 (USART2 TX) interrupt handler
+ */
+extern "C" void DMA1_Channel7_IRQHandler(void) __attribute__ ((interrupt));
+void DMA1_Channel7_IRQHandler(void)
+{
+	_dmaTxIrqHandler(1);
+}
+
+/**
+ * \brief DMA1 channel 6 (USART2 RX) interrupt handler
+ */
+extern "C" void DMA1_Channel6_IRQHandler(void) __attribute__ ((interrupt));
+void DMA1_Channel6_IRQHandler(void)
+{
+	_dmaRxIrqHandler(1);
+}
+
+#endif	// USART2_ENABLED == 1
+
+#if USART3_ENABLED == 1
+
+/**
+ * \brief USART3 interrupt handler
+ */
+extern "C" void USART3_IRQHandler(void) __attribute((interrupt));
+void USART3_IRQHandler(void)
+{
+	_usartIrqHandler(2);
+}
+
+/**
+ * \brief DMA1 channel 2 (USART3 TX) interrupt handler
+ */
+extern "C" void DMA1_Channel2_IRQHandler(void) __attribute__ ((interrupt));
+void DMA1_Channel2_IRQHandler(void)
+{
+	_dmaTxIrqHandler(2);
+}
+
+/**
+ * \brief DMA1 channel 3 (USART3 RX) interrupt handler
+ */
+extern "C" void DMA1_Channel3_IRQHandler(void) __attribute__ ((interrupt));
+void DMA1_Channel3_IRQHandler(void)
+{
+	_dmaRxIrqHandler(2);
+}
+
+#endif	// USART3_ENABLED == 1
+
 /**
  *  \brief Low-level String printing
  *
@@ -8,16 +8,36 @@
 #ifndef USART_H_
 #define USART_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "FreeRTOS.h"
 
 #include "error.h"
 
+/*---------------------------------------------------------------------------------------------------------------------+
+| global variables' types
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// statistics of USART
+struct UsartStatistics
+{
+	uint32_t txCommits;						///< number of committed writes (usartTxCommit() calls with data)
+	uint32_t txTransfers;					///< number of DMA transfers - coalesced commits
+	uint32_t txBytes;						///< number of committed bytes
+	uint32_t rxRanges;						///< number of received blocks published to readers
+	uint32_t rxOverruns;					///< number of times unread data was overwritten and dropped
+};
+
+/// callback called from interrupts when data was received or space in TX ring buffer was freed on any port
+typedef void (*UsartEventCallback)(portBASE_TYPE *higher_priority_task_woken);
+
 /*---------------------------------------------------------------------------------------------------------------------+
 | global functions' prototypes
 +---------------------------------------------------------------------------------------------------------------------*/
 
 
-enum Error usartPrintf(portTickType ticks_to_wait, const char *format, ...);
+enum Error usartPrintf(size_t port, portTickType ticks_to_wait, const char *format, ...);
 enum Error putMsgToUartQueue(const char *data, size_t length, portTickType ticks_to_wait);
 void usart_low_level_put(char c);
 
@@ -25,10 +45,17 @@ void usart_low_level_put(char c);
 extern "C" {
 #endif
 
-enum Error usartSendString(const char *string, portTickType ticks_to_wait);
-enum Error usartSendBytes(const char *data, size_t length, portTickType ticks_to_wait);
+enum Error usartSendString(size_t port, const char *string, portTickType ticks_to_wait);
+enum Error usartSendBytes(size_t port, const char *data, size_t length, portTickType ticks_to_wait);
+enum Error usartTxReserve(size_t port, char **region, size_t length, portTickType ticks_to_wait);
+void usartTxCommit(size_t port, size_t length);
+size_t usartReceiveBytes(size_t port, char *buffer, size_t size, portTickType ticks_to_wait);
+size_t usartGetRxAvailable(size_t port);
+size_t usartGetTxSpace(size_t port);
+void usartSetEventCallback(UsartEventCallback callback);
+enum Error usartGetStatistics(size_t port, struct UsartStatistics *statistics);
 void usartSendDebugMsg(const char *string);
-enum Error usartInitialize(void);
+enum Error usartInitialize(size_t port);
 
 #ifdef __cplusplus
 }
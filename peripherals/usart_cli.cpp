@@ -0,0 +1,130 @@
+/**
+ * \file usart_cli.cpp
+ * \brief USART command-line interface
+ *
+ * prefix: usartCli
+ *
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#include "usart_cli.hpp"
+
+#include "usart.h"
+#include "command.hpp"
+
+#include "config.h"
+
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+int usartStatsHandler_(const char **, uint32_t, FILE * const output_stream);
+int usartStatsStructuredHandler_(const char **, uint32_t, void * const buffer, const size_t size);
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local variables
++---------------------------------------------------------------------------------------------------------------------*/
+
+/// definition of "usart_stats" command
+const CommandDefinition usartStatsCommandDefinition_ =
+{
+		"usart_stats",			// command string
+		0,						// maximum number of arguments
+		usartStatsHandler_,		// handler function
+		"usart_stats: displays statistics of USART ports\n",	// string displayed by help function
+		usartStatsStructuredHandler_,	// structured handler function
+};
+
+}	// namespace
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Initializes USART command-line interface.
+ *
+ * Registers commands.
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int usartCliInitialize()
+{
+	return commandRegister(usartStatsCommandDefinition_);
+}
+
+namespace
+{
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| local functions
++---------------------------------------------------------------------------------------------------------------------*/
+
+/**
+ * \brief Handler of "usart_stats" command.
+ *
+ * Displays statistics of all available USART ports.
+ *
+ * \param [out] output_stream is the stream used for output
+ *
+ * \return 0 on success, negated errno code otherwise (errno not set)
+ */
+
+int usartStatsHandler_(const char **, uint32_t, FILE * const output_stream)
+{
+	for (size_t port = 0; port < USART_PORT_COUNT; port++)
+	{
+		UsartStatistics statistics;
+		if (usartGetStatistics(port, &statistics) != ERROR_NONE)	// port disabled or not opened?
+			continue;
+
+		// commits per transfer with two decimal places, 0 before first transfer
+		const uint32_t ratio = statistics.txTransfers != 0 ?
+				static_cast<uint64_t>(statistics.txCommits) * 100 / statistics.txTransfers : 0;
+
+		const int ret = fiprintf(output_stream, "/dev/uart%u:\nTX commits = %lu\nTX transfers = %lu\nTX bytes = %lu\n"
+				"Commits per transfer = %lu.%02lu\nRX ranges = %lu\nRX overruns = %lu\n", port,
+				statistics.txCommits, statistics.txTransfers, statistics.txBytes, ratio / 100, ratio % 100,
+				statistics.rxRanges, statistics.rxOverruns);
+		if (ret < 0)
+			return -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Structured handler of "usart_stats" command.
+ *
+ * Fills array of UsartStatistics (one element for each port, zeroed for ports which are disabled or not opened) with
+ * USART statistics.
+ *
+ * \param [out] buffer is the buffer for response
+ * \param [in] size is the size of buffer, bytes
+ *
+ * \return size of response on success, negated errno code otherwise (errno not set)
+ */
+
+int usartStatsStructuredHandler_(const char **, uint32_t, void * const buffer, const size_t size)
+{
+	if (size < sizeof(UsartStatistics) * USART_PORT_COUNT)
+		return -ENOSPC;
+
+	for (size_t port = 0; port < USART_PORT_COUNT; port++)
+	{
+		UsartStatistics statistics {};
+		usartGetStatistics(port, &statistics);
+		memcpy(static_cast<uint8_t *>(buffer) + port * sizeof(statistics), &statistics, sizeof(statistics));
+	}
+
+	return sizeof(UsartStatistics) * USART_PORT_COUNT;
+}
+
+}	// namespace
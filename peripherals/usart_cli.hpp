@@ -0,0 +1,16 @@
+/**
+ * \file usart_cli.hpp
+ * \brief Header for usart_cli.cpp
+ * \author: Mazeryt Freager, http://www.gotoc.co
+ */
+
+#ifndef USART_CLI_HPP_
+#define USART_CLI_HPP_
+
+/*---------------------------------------------------------------------------------------------------------------------+
+| global functions' prototypes
++---------------------------------------------------------------------------------------------------------------------*/
+
+int usartCliInitialize();
+
+#endif	// USART_CLI_HPP_